@@ -0,0 +1,129 @@
+// Empirical complexity check. Runs each engine on generated courses at doubling N, fits
+// time = c * N^k (and time = c * (N * W)^k, W being the mean successor window the engine actually
+// scanned) and fails, exiting non-zero, when an exponent exceeds the engine's documented class.
+
+#define SHEARWATER_STATS
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/scaling_fit.h"
+#include "shearwater/tuning_profile.h"
+
+/**
+    Documented scaling class of an engine, as the largest exponents the fits may show. The slack over
+    the nominal class absorbs the heap's log factor and cache effects at the larger sizes.
+*/
+struct ScalingClass
+{
+    const char *engine;
+    const char *documented;
+    double max_exponent_n;  // time against N
+    double max_exponent_nw; // time against N * W, the relaxations actually scanned
+};
+
+// Optimizer: label-setting search, O(N * W) relaxations with W <= N, each improving relaxation a
+// heap push, so O(N^2 log N) in the worst case.
+static constexpr ScalingClass kOptimizerClass = {"Optimizer", "O(N*W log N), W <= N", 2.6, 1.35};
+
+static constexpr int kMinWaypoints = 128;
+static constexpr int kMaxWaypoints = 2048;
+
+static void BM_Scaling(benchmark::State &state, CourseProfile profile)
+{
+    const int n = static_cast<int>(state.range(0));
+    CourseGenerator generator(n);
+    auto course = generator.generate(profile, n);
+
+    Optimizer optimizer;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(optimizer.findLowestTime(course));
+    }
+    state.SetComplexityN(n);
+    state.counters["window"] = optimizer.stats().meanWindow();
+}
+
+/**
+    Console output as usual, plus the per-size timings of every family for fitting afterwards.
+*/
+class ScalingReporter : public benchmark::ConsoleReporter
+{
+public:
+    struct Point
+    {
+        double n;
+        double nw;
+        double seconds;
+    };
+
+    std::map<std::string, std::vector<Point>> families;
+
+    void ReportRuns(const std::vector<Run> &runs) override
+    {
+        ConsoleReporter::ReportRuns(runs);
+        for (const Run &run : runs)
+        {
+            if (run.run_type != Run::RT_Iteration || run.error_occurred)
+            {
+                continue;
+            }
+            double n = static_cast<double>(run.complexity_n);
+            double window = run.counters.count("window") ? static_cast<double>(run.counters.at("window")) : 1.0;
+            families[run.run_name.function_name].push_back({n, n * (window < 1.0 ? 1.0 : window), run.GetAdjustedCPUTime()});
+        }
+    }
+};
+
+int main(int argc, char **argv)
+{
+    // The fits are for the heap search; a tuned crossover would hand large courses to the forward DP.
+    pinDefaultTuning();
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        benchmark::RegisterBenchmark((std::string(kOptimizerClass.engine) + "/" + profileName(profile)).c_str(), BM_Scaling, profile)
+            ->RangeMultiplier(2)
+            ->Range(kMinWaypoints, kMaxWaypoints)
+            ->Unit(benchmark::kMicrosecond)
+            ->Complexity();
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    ScalingReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    bool failed = false;
+    std::printf("\n%-28s %10s %10s %8s   %s\n", "family", "exp(N)", "exp(N*W)", "r^2", "documented class");
+    for (const auto &family : reporter.families)
+    {
+        std::vector<double> n, nw, seconds;
+        for (const auto &point : family.second)
+        {
+            n.push_back(point.n);
+            nw.push_back(point.nw);
+            seconds.push_back(point.seconds);
+        }
+        ScalingFit by_n = fitPowerLaw(n, seconds);
+        ScalingFit by_nw = fitPowerLaw(nw, seconds);
+        bool over = by_n.exponent > kOptimizerClass.max_exponent_n || by_nw.exponent > kOptimizerClass.max_exponent_nw;
+        failed |= over;
+        std::printf("%-28s %10.2f %10.2f %8.3f   %s%s\n", family.first.c_str(), by_n.exponent, by_nw.exponent, by_n.r_squared,
+                    kOptimizerClass.documented, over ? "  EXCEEDED" : "");
+    }
+    if (failed)
+    {
+        std::printf("\nScaling exceeds the documented class (limits: exp(N) <= %.2f, exp(N*W) <= %.2f)\n",
+                    kOptimizerClass.max_exponent_n, kOptimizerClass.max_exponent_nw);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,180 @@
+// The CpuKernels of include/shearwater/cpu_dispatch.h at each instruction set level (the argument:
+// 0 baseline, 1 avx2, 2 avx512; levels the host lacks are skipped), next to the code they replace:
+// per-leg std::pow/std::sqrt, stream extraction and snprintf. Run with --benchmark_filter to pick
+// a kernel.
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/cpu_dispatch.h"
+
+static bool pickLevel(benchmark::State &state, CpuLevel &level)
+{
+    level = static_cast<CpuLevel>(state.range(0));
+    if (level > detectCpuLevel())
+    {
+        state.SkipWithError("level not supported by this CPU");
+        return false;
+    }
+    state.SetLabel(cpuLevelName(level));
+    return true;
+}
+
+static std::vector<Waypoint> course(int n)
+{
+    return CourseGenerator(71).generate(CourseProfile::Uniform, n);
+}
+
+static std::string courseText()
+{
+    CourseGenerator generator(71);
+    std::vector<std::vector<Waypoint>> courses;
+    for (int c = 0; c < 200; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], 100));
+    }
+    std::ostringstream text;
+    writeCourses(text, courses);
+    return text.str();
+}
+
+static std::vector<double> answers()
+{
+    std::vector<double> values;
+    for (int i = 0; i < 10000; ++i)
+    {
+        values.push_back(200 + i * 13.0371);
+    }
+    return values;
+}
+
+static void BM_LegTimesScalarPow(benchmark::State &state)
+{
+    auto waypoints = course(1000);
+    std::vector<double> out(waypoints.size());
+    for (auto _ : state)
+    {
+        for (size_t j = 0; j < waypoints.size(); ++j)
+        {
+            out[j] = std::sqrt(std::pow(waypoints[j].x - 50, 2) + std::pow(waypoints[j].y - 50, 2)) / 2.0f + 10;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * waypoints.size());
+}
+BENCHMARK(BM_LegTimesScalarPow);
+
+static void BM_LegTimes(benchmark::State &state)
+{
+    CpuLevel level;
+    if (!pickLevel(state, level))
+    {
+        return;
+    }
+    const CpuKernels &kernels = cpuKernels(level);
+    auto waypoints = course(1000);
+    std::vector<double> out(waypoints.size());
+    for (auto _ : state)
+    {
+        kernels.leg_times(&waypoints[0].x, 0, waypoints.size(), 50, 50, 2.0, 10, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * waypoints.size());
+}
+BENCHMARK(BM_LegTimes)->DenseRange(0, kCpuLevelCount - 1);
+
+static void BM_Argmin(benchmark::State &state)
+{
+    CpuLevel level;
+    if (!pickLevel(state, level))
+    {
+        return;
+    }
+    const CpuKernels &kernels = cpuKernels(level);
+    std::vector<double> values = answers();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(kernels.argmin(values.data(), 64));
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_Argmin)->DenseRange(0, kCpuLevelCount - 1);
+
+static void BM_ParseStream(benchmark::State &state)
+{
+    const std::string text = courseText();
+    for (auto _ : state)
+    {
+        std::istringstream input(text);
+        benchmark::DoNotOptimize(readCourses(input));
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ParseStream);
+
+static void BM_ParseKernel(benchmark::State &state)
+{
+    CpuLevel level;
+    if (!pickLevel(state, level))
+    {
+        return;
+    }
+    const std::string text = courseText();
+    selectCpuLevel(level);
+    std::vector<Waypoint> waypoints;
+    for (auto _ : state)
+    {
+        CourseParser parser(text.data(), text.size());
+        while (parser.next(waypoints))
+        {
+            benchmark::DoNotOptimize(waypoints.data());
+        }
+    }
+    selectCpuLevel(detectCpuLevel());
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ParseKernel)->DenseRange(0, kCpuLevelCount - 1);
+
+static void BM_FormatSnprintf(benchmark::State &state)
+{
+    std::vector<double> values = answers();
+    for (auto _ : state)
+    {
+        std::string output;
+        for (double value : values)
+        {
+            output += formatAnswer(value);
+            output += '\n';
+        }
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_FormatSnprintf);
+
+static void BM_FormatKernel(benchmark::State &state)
+{
+    CpuLevel level;
+    if (!pickLevel(state, level))
+    {
+        return;
+    }
+    const CpuKernels &kernels = cpuKernels(level);
+    std::vector<double> values = answers();
+    for (auto _ : state)
+    {
+        std::string output;
+        kernels.format_fixed3(values.data(), values.size(), output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_FormatKernel)->DenseRange(0, kCpuLevelCount - 1);
+
+BENCHMARK_MAIN();
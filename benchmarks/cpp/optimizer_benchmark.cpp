@@ -0,0 +1,280 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shearwater/alloc_tracker.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/perf_counters.h"
+#include "shearwater/solver_engine.h"
+#include "shearwater/tuning_profile.h"
+
+namespace fs = std::filesystem;
+
+/**
+    Every engine is driven through the same harness via a small adapter: a display name, the largest
+    generated course it should be benchmarked on, a solve() call and a hook for phase counters.
+    Adding an engine means adding an adapter and one registerEngine<>() line in main().
+*/
+struct OptimizerEngine
+{
+    static constexpr const char *name = "Optimizer";
+    // The label-setting search pushes up to O(N^2) heap entries, so it stops well short of the
+    // 10^6 ceiling (N = 10^4 already takes seconds per course).
+    static constexpr int maxWaypoints = 1000;
+
+    Optimizer optimizer;
+
+    double solve(const std::vector<Waypoint> &waypoints)
+    {
+        return optimizer.findLowestTime(waypoints);
+    }
+
+    void setPhaseCounters(PhaseCounters *counters)
+    {
+        optimizer.setPhaseCounters(counters);
+    }
+};
+
+/**
+    The engines of include/shearwater/solver_engine.h. They do not report phases. Besides the common
+    benchmarks they get "<name>/batch": 1000 courses of every profile per solveBatch() call, where
+    simd_batch can fill its lanes.
+*/
+template <typename Solver, int kMaxWaypoints>
+struct SolverEngineAdapter
+{
+    static inline const std::string name = Solver().name();
+    static constexpr int maxWaypoints = kMaxWaypoints;
+
+    Solver engine;
+
+    double solve(const std::vector<Waypoint> &waypoints)
+    {
+        return engine.solve(waypoints);
+    }
+
+    void setPhaseCounters(PhaseCounters *)
+    {
+    }
+};
+
+// Built with -DSHEARWATER_TRACK_ALLOCATIONS, every benchmark also reports heap allocations and
+// bytes per course and the peak live bytes of any course.
+#ifdef SHEARWATER_TRACK_ALLOCATIONS
+SHEARWATER_DEFINE_ALLOCATION_HOOKS
+#endif
+
+static constexpr uint64_t kSeed = 0x5eed5eed;
+static constexpr int kMaxGeneratedWaypoints = 1000000;
+
+// Set by --perf_counters: attribute hardware counters to the preprocess and solve phases. The
+// counter reads are syscalls, so timings of instrumented runs are inflated for small courses.
+static bool perf_counters_enabled = false;
+
+static std::unique_ptr<PhaseCounters> startPhaseCounters()
+{
+    return perf_counters_enabled ? std::make_unique<PhaseCounters>() : nullptr;
+}
+
+static void setAllocationCounters([[maybe_unused]] benchmark::State &state, [[maybe_unused]] const AllocationScope &scope,
+                                  [[maybe_unused]] size_t courses)
+{
+#ifdef SHEARWATER_TRACK_ALLOCATIONS
+    AllocationCounts counts = scope.counts();
+    double solves = static_cast<double>(state.iterations()) * courses;
+    state.counters["allocs_per_course"] = counts.allocations / solves;
+    state.counters["bytes_per_course"] = counts.bytes_allocated / solves;
+    state.counters["peak_bytes"] = static_cast<double>(counts.peak_live_bytes);
+#endif
+}
+
+static void setPerfCounters(benchmark::State &state, PhaseCounters *phases)
+{
+    if (!phases)
+    {
+        return;
+    }
+    phases->stop();
+    const PerfCounters &perf = phases->perf();
+    for (SolvePhase phase : {SolvePhase::Preprocess, SolvePhase::Solve})
+    {
+        const PerfSample &sample = phases->total(phase);
+        const std::string prefix = std::string(solvePhaseName(phase)) + "_";
+        if (perf.available(PerfEvent::Cycles) && perf.available(PerfEvent::Instructions) && sample[PerfEvent::Cycles] > 0)
+        {
+            state.counters[prefix + "ipc"] = static_cast<double>(sample[PerfEvent::Instructions]) / sample[PerfEvent::Cycles];
+        }
+        if (perf.available(PerfEvent::Instructions) && sample[PerfEvent::Instructions] > 0)
+        {
+            for (PerfEvent miss : {PerfEvent::L1DMisses, PerfEvent::LLCMisses, PerfEvent::BranchMisses})
+            {
+                if (perf.available(miss))
+                {
+                    state.counters[prefix + perfEventName(miss) + "_pki"] = 1000.0 * sample[miss] / sample[PerfEvent::Instructions];
+                }
+            }
+        }
+        if (perf.available(PerfEvent::TaskClock))
+        {
+            state.counters[prefix + "cpu_ns"] = benchmark::Counter(static_cast<double>(sample[PerfEvent::TaskClock]), benchmark::Counter::kAvgIterations);
+        }
+    }
+}
+
+static void setThroughputCounters(benchmark::State &state, size_t courses, size_t waypoints)
+{
+    state.counters["courses_per_sec"] = benchmark::Counter(static_cast<double>(courses), benchmark::Counter::kIsIterationInvariantRate);
+    // Inverted waypoint rate: seconds per waypoint, printed with an SI prefix (e.g. "35.2ns").
+    state.counters["time_per_waypoint"] = benchmark::Counter(static_cast<double>(waypoints),
+                                                             benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["waypoints"] = static_cast<double>(waypoints);
+}
+
+template <typename Engine>
+static void BM_SampleFile(benchmark::State &state, const fs::path &path)
+{
+    std::ifstream input(path);
+    auto courses = readCourses(input);
+    if (courses.empty())
+    {
+        state.SkipWithError("sample input not found; run from the repository root");
+        return;
+    }
+
+    Engine engine;
+    auto phases = startPhaseCounters();
+    engine.setPhaseCounters(phases.get());
+    AllocationScope allocations;
+    for (auto _ : state)
+    {
+        for (const auto &course : courses)
+        {
+            benchmark::DoNotOptimize(engine.solve(course));
+        }
+    }
+    setThroughputCounters(state, courses.size(), countWaypoints(courses));
+    setAllocationCounters(state, allocations, courses.size());
+    setPerfCounters(state, phases.get());
+}
+
+template <typename Engine>
+static void BM_Generated(benchmark::State &state, CourseProfile profile)
+{
+    const int n = static_cast<int>(state.range(0));
+    CourseGenerator generator(kSeed + n);
+    auto course = generator.generate(profile, n);
+
+    Engine engine;
+    auto phases = startPhaseCounters();
+    engine.setPhaseCounters(phases.get());
+    AllocationScope allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(engine.solve(course));
+    }
+    setThroughputCounters(state, 1, n);
+    setAllocationCounters(state, allocations, 1);
+    setPerfCounters(state, phases.get());
+}
+
+template <typename Engine>
+static void BM_GeneratedBatch(benchmark::State &state)
+{
+    const int n = static_cast<int>(state.range(0));
+    CourseGenerator generator(kSeed + n);
+    std::vector<std::vector<Waypoint>> courses;
+    for (int c = 0; c < 1000; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], n));
+    }
+
+    Engine adapter;
+    std::vector<double> answers(courses.size());
+    AllocationScope allocations;
+    for (auto _ : state)
+    {
+        adapter.engine.solveBatch(courses, answers.data());
+        benchmark::DoNotOptimize(answers.data());
+    }
+    setThroughputCounters(state, courses.size(), countWaypoints(courses));
+    setAllocationCounters(state, allocations, courses.size());
+}
+
+template <typename Engine>
+static void registerBatch()
+{
+    benchmark::RegisterBenchmark((Engine::name + "/batch").c_str(), BM_GeneratedBatch<Engine>)
+        ->Unit(benchmark::kMicrosecond)
+        ->Arg(5)
+        ->Arg(10)
+        ->Arg(25)
+        ->Arg(50)
+        ->Arg(100);
+}
+
+template <typename Engine>
+static void registerEngine()
+{
+    const std::string engine = Engine::name;
+
+    for (const char *size : {"small", "medium", "large"})
+    {
+        fs::path path = fs::current_path() / "data/shearwater_challenge" / (std::string("sample_input_") + size + ".txt");
+        benchmark::RegisterBenchmark((engine + "/sample/" + size).c_str(), BM_SampleFile<Engine>, path)
+            ->Unit(benchmark::kMicrosecond);
+    }
+
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        auto *bm = benchmark::RegisterBenchmark((engine + "/" + profileName(profile)).c_str(), BM_Generated<Engine>, profile)
+                       ->Unit(benchmark::kMicrosecond);
+        for (int n = 1; n <= kMaxGeneratedWaypoints && n <= Engine::maxWaypoints; n *= 10)
+        {
+            bm->Arg(n);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    // Strip our own flags before Google Benchmark sees them.
+    int kept = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--perf_counters") == 0)
+        {
+            perf_counters_enabled = true;
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    registerEngine<OptimizerEngine>();
+    // The search is the Optimizer above; it gets only the batch benchmarks, as a baseline.
+    registerBatch<SolverEngineAdapter<SearchEngine, 1000>>();
+    registerEngine<SolverEngineAdapter<DenseEngine, 10000>>();
+    registerBatch<SolverEngineAdapter<DenseEngine, 10000>>();
+    registerEngine<SolverEngineAdapter<WindowedEngine, 100000>>();
+    registerBatch<SolverEngineAdapter<WindowedEngine, 100000>>();
+    registerEngine<SolverEngineAdapter<SimdBatchEngine, 10000>>();
+    registerBatch<SolverEngineAdapter<SimdBatchEngine, 10000>>();
+    registerEngine<SolverEngineAdapter<ApproximateEngine, 1000000>>();
+    registerBatch<SolverEngineAdapter<ApproximateEngine, 1000000>>();
+
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    ::benchmark::RunSpecifiedBenchmarks();
+    ::benchmark::Shutdown();
+    return 0;
+}
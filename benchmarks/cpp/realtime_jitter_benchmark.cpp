@@ -0,0 +1,97 @@
+// Worst-case latency of real-time mode (include/shearwater/realtime.h). Prepares a RealtimeSolver,
+// then times millions of individual solves of small generated courses and reports the latency
+// distribution out to p99.99, the jitter (max - p50) and the page faults taken while measuring.
+// Exits non-zero if any solve faulted, since then the real-time guarantee does not hold.
+//
+//   realtime_jitter_benchmark [--solves S] [--waypoints W] [--cpu C] [--priority P]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/latency_histogram.h"
+#include "shearwater/realtime.h"
+#include "shearwater/tuning_profile.h"
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    long solves = 2000000;
+    int waypoints = 10;
+    RealtimeOptions options;
+    options.cpu = 0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        long value = std::atol(argv[i + 1]);
+        if (arg == "--solves")
+        {
+            solves = value;
+        }
+        else if (arg == "--waypoints")
+        {
+            waypoints = static_cast<int>(value);
+        }
+        else if (arg == "--cpu")
+        {
+            options.cpu = static_cast<int>(value);
+        }
+        else if (arg == "--priority")
+        {
+            options.priority = static_cast<int>(value);
+        }
+    }
+    options.max_waypoints = waypoints;
+
+    CourseGenerator generator(63);
+    std::vector<std::vector<Waypoint>> courses;
+    for (int c = 0; c < 64; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], waypoints));
+    }
+
+    RealtimeSolver solver;
+    RealtimeStatus status = solver.prepare(options);
+    std::printf("memory locked: %s, pinned: %s, SCHED_FIFO: %s\n%s", status.memory_locked ? "yes" : "no",
+                status.pinned ? "yes" : "no", status.fifo ? "yes" : "no", status.problems.c_str());
+
+    // Warm-up also touches the clock's vDSO data page, which would otherwise fault in the first
+    // timed iteration. The histogram's buckets are written by its constructor.
+    LatencyHistogram latency;
+    double answer = 0.0, checksum = 0.0;
+    for (const auto &course : courses)
+    {
+        auto start = std::chrono::steady_clock::now();
+        solver.solve(course, answer);
+        benchmark::DoNotOptimize(std::chrono::steady_clock::now() - start);
+    }
+
+    long faults = threadPageFaults();
+    auto started = std::chrono::steady_clock::now();
+    for (long s = 0; s < solves; ++s)
+    {
+        const auto &course = courses[s & 63];
+        auto start = std::chrono::steady_clock::now();
+        solver.solve(course, answer);
+        auto end = std::chrono::steady_clock::now();
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        checksum += answer;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    faults = threadPageFaults() - faults;
+
+    uint64_t p50 = latency.percentile(50);
+    std::printf("%ld solves of N=%d in %.2f s (checksum %.3f)\n", solves, waypoints, seconds, checksum);
+    std::printf("latency ns: min %llu  p50 %llu  p99 %llu  p99.9 %llu  p99.99 %llu  max %llu\n",
+                static_cast<unsigned long long>(latency.min()), static_cast<unsigned long long>(p50),
+                static_cast<unsigned long long>(latency.percentile(99)), static_cast<unsigned long long>(latency.percentile(99.9)),
+                static_cast<unsigned long long>(latency.percentile(99.99)), static_cast<unsigned long long>(latency.max()));
+    std::printf("jitter (max - p50): %llu ns, page faults while solving: %ld\n",
+                static_cast<unsigned long long>(latency.max() - p50), faults);
+    return faults == 0 ? 0 : 1;
+}
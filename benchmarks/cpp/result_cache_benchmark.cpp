@@ -0,0 +1,80 @@
+// Cost of the result cache (include/shearwater/result_cache.h) against solving: hashing a course,
+// a verified hit, and a miss that solves and inserts, at N = 10, 100 and 1000.
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/result_cache.h"
+#include "shearwater/tuning_profile.h"
+
+static constexpr int kCourses = 64;
+
+static std::vector<std::vector<Waypoint>> courses(int n)
+{
+    CourseGenerator generator(65);
+    std::vector<std::vector<Waypoint>> result;
+    for (int c = 0; c < kCourses; ++c)
+    {
+        result.push_back(generator.generate(CourseProfile::Uniform, n));
+    }
+    return result;
+}
+
+static void BM_Hash(benchmark::State &state)
+{
+    auto input = courses(static_cast<int>(state.range(0)));
+    size_t c = 0;
+    for (auto _ : state)
+    {
+        const auto &course = input[c++ % kCourses];
+        benchmark::DoNotOptimize(hashWaypoints(course.data(), course.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * input[0].size() * sizeof(Waypoint));
+}
+BENCHMARK(BM_Hash)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_CacheHit(benchmark::State &state)
+{
+    auto input = courses(static_cast<int>(state.range(0)));
+    Optimizer optimizer;
+    ResultCache cache(64 << 20);
+    for (const auto &course : input)
+    {
+        cache.findLowestTime(optimizer, course);
+    }
+    size_t c = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cache.findLowestTime(optimizer, input[c++ % kCourses]));
+    }
+    state.counters["hit_rate"] = static_cast<double>(cache.stats().hits) / (cache.stats().hits + cache.stats().misses);
+}
+BENCHMARK(BM_CacheHit)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_CacheMiss(benchmark::State &state)
+{
+    auto input = courses(static_cast<int>(state.range(0)));
+    Optimizer optimizer;
+    ResultCache cache(1); // too small to keep anything: every lookup misses
+    size_t c = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cache.findLowestTime(optimizer, input[c++ % kCourses]));
+    }
+}
+BENCHMARK(BM_CacheMiss)->Arg(10)->Arg(100)->Arg(1000);
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    ::benchmark::RunSpecifiedBenchmarks();
+    ::benchmark::Shutdown();
+    return 0;
+}
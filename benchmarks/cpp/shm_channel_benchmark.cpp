@@ -0,0 +1,86 @@
+// Throughput of the shared-memory transport (include/shearwater/shm_channel.h) for small courses: a
+// solver thread serves one channel while the benchmark thread pipelines batches through it. Compare
+// courses_per_sec with BM_Direct, the same courses solved in process without a transport.
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/shm_channel.h"
+#include "shearwater/tuning_profile.h"
+
+static constexpr int kBatch = 4096;
+
+static std::vector<std::vector<Waypoint>> smallCourses(int n)
+{
+    CourseGenerator generator(n);
+    std::vector<std::vector<Waypoint>> courses;
+    for (int c = 0; c < kBatch; ++c)
+    {
+        courses.push_back(generator.generate(CourseProfile::Uniform, n));
+    }
+    return courses;
+}
+
+static void BM_Direct(benchmark::State &state)
+{
+    auto courses = smallCourses(static_cast<int>(state.range(0)));
+    Optimizer optimizer;
+    for (auto _ : state)
+    {
+        for (const auto &course : courses)
+        {
+            benchmark::DoNotOptimize(optimizer.findLowestTime(course));
+        }
+    }
+    state.counters["courses_per_sec"] = benchmark::Counter(static_cast<double>(state.iterations()) * kBatch, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Direct)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+static void BM_SharedMemory(benchmark::State &state)
+{
+    auto courses = smallCourses(static_cast<int>(state.range(0)));
+    const std::string name = "/shearwater_bench_" + std::to_string(::getpid());
+    ShmChannel server;
+    ShmChannel client;
+    if (!server.create(name) || !client.open(name))
+    {
+        state.SkipWithError((server.error() + client.error()).c_str());
+        return;
+    }
+    std::atomic<bool> stop{false};
+    std::thread solver([&]
+                       {
+        Optimizer optimizer;
+        server.serve(optimizer, stop); });
+
+    std::vector<double> answers;
+    for (auto _ : state)
+    {
+        client.solveAll(courses, answers);
+        benchmark::DoNotOptimize(answers.data());
+    }
+    stop = true;
+    solver.join();
+    state.counters["courses_per_sec"] = benchmark::Counter(static_cast<double>(state.iterations()) * kBatch, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SharedMemory)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    ::benchmark::RunSpecifiedBenchmarks();
+    ::benchmark::Shutdown();
+    return 0;
+}
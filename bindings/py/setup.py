@@ -0,0 +1,26 @@
+# Builds the "shearwater" Python extension (shearwater_module.cpp) against the headers in include/:
+#
+#   pip install ./bindings/py
+#   python3 bindings/py/setup.py build_ext --inplace
+
+import os
+
+from setuptools import Extension, setup
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+setup(
+    name="shearwater",
+    version="1.0",
+    description="Shearwater challenge solver over buffer-protocol arrays",
+    ext_modules=[
+        Extension(
+            "shearwater",
+            sources=[os.path.relpath(os.path.join(here, "shearwater_module.cpp"))],
+            include_dirs=[os.path.join(here, "..", "..", "include")],
+            extra_compile_args=["-std=c++17", "-O2"],
+            extra_link_args=["-pthread"],
+            language="c++",
+        )
+    ],
+)
@@ -0,0 +1,276 @@
+// Python extension module "shearwater": batch solving straight from buffer-protocol arrays, as in
+//
+//   import numpy as np, shearwater
+//   waypoints = np.array([[50, 50, 20], [10, 90, 5], ...], dtype=np.int32)  # (M, 3): x, y, penalty
+//   offsets = np.array([0, 3, 7, ...], dtype=np.int64)                      # course k: rows offsets[k]..offsets[k+1]
+//   answers = np.asarray(shearwater.solve_batch(waypoints, offsets, threads=4))
+//
+// Any object exporting a C-contiguous buffer works in place of NumPy (array.array, memoryview,
+// bytes). Waypoints are int32, offsets int32 or int64, both read in place. Each worker copies one
+// course at a time into its framed scratch course; the GIL is released while solving. Answers come
+// back as an array.array('d'), or are written into out= (any writable float64 buffer). With
+// with_paths=True the result is (answers, path, path_offsets), the optimal waypoint indices of
+// course k (start 0, finish N+1) being path[path_offsets[k]:path_offsets[k+1]].
+//
+// Build with bindings/py/setup.py, or directly:
+//
+//   flags="-O2 -std=c++17 -shared -fPIC -pthread -I include $(python3-config --includes)"
+//   g++ $flags bindings/py/shearwater_module.cpp -o shearwater$(python3-config --extension-suffix)
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shearwater/optimizer.h"
+
+namespace
+{
+    // Releases a Py_buffer on scope exit.
+    struct BufferView
+    {
+        Py_buffer view = {};
+        bool held = false;
+
+        ~BufferView()
+        {
+            if (held)
+            {
+                PyBuffer_Release(&view);
+            }
+        }
+
+        bool get(PyObject *object, int flags, const char *name)
+        {
+            if (PyObject_GetBuffer(object, &view, flags | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) < 0)
+            {
+                PyErr_Format(PyExc_TypeError, "%s must be a C-contiguous buffer", name);
+                return false;
+            }
+            held = true;
+            return true;
+        }
+
+        // The element format without a byte order or alignment prefix ('@', '=', '<'); '>' and '!'
+        // are kept, so big-endian data is rejected on this little-endian layout.
+        char kind() const
+        {
+            const char *format = view.format ? view.format : "B";
+            if (*format == '@' || *format == '=' || *format == '<')
+            {
+                ++format;
+            }
+            return format[0] != '\0' && format[1] == '\0' ? format[0] : '?';
+        }
+
+        bool isInteger(Py_ssize_t size) const
+        {
+            char k = kind();
+            return view.itemsize == size && (k == 'i' || k == 'l' || k == 'q' || k == 'I' || k == 'L' || k == 'Q');
+        }
+    };
+
+    struct Batch
+    {
+        const int32_t *waypoints;
+        std::vector<int64_t> offsets;
+        double *answers;
+        bool with_paths;
+        std::vector<std::vector<int>> paths;
+    };
+
+    void solveRange(Batch &batch, std::atomic<size_t> &next)
+    {
+        Optimizer optimizer;
+        std::vector<Waypoint> course;
+        const size_t count = batch.offsets.size() - 1;
+        for (size_t k = next.fetch_add(1, std::memory_order_relaxed); k < count; k = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            const int64_t first = batch.offsets[k];
+            const int64_t rows = batch.offsets[k + 1] - first;
+            course.resize(rows + 2);
+            course.front() = StandardCostModel::start();
+            std::memcpy(&course[1], batch.waypoints + 3 * first, rows * sizeof(Waypoint));
+            course.back() = StandardCostModel::finish();
+            batch.answers[k] = optimizer.findLowestTime(course);
+            if (batch.with_paths)
+            {
+                batch.paths[k] = optimizer.optimalPath();
+            }
+        }
+    }
+
+    // array.array(typecode) holding count zeroed elements.
+    PyObject *newArray(const char *typecode, Py_ssize_t count, Py_ssize_t itemsize)
+    {
+        PyObject *module = PyImport_ImportModule("array");
+        if (!module)
+        {
+            return nullptr;
+        }
+        PyObject *zeros = PyBytes_FromStringAndSize(nullptr, count * itemsize);
+        if (zeros)
+        {
+            std::memset(PyBytes_AS_STRING(zeros), 0, count * itemsize);
+        }
+        PyObject *array = zeros ? PyObject_CallMethod(module, "array", "sO", typecode, zeros) : nullptr;
+        Py_XDECREF(zeros);
+        Py_DECREF(module);
+        return array;
+    }
+
+    PyObject *solveBatch(PyObject *, PyObject *args, PyObject *kwargs)
+    {
+        static const char *keywords[] = {"waypoints", "offsets", "threads", "out", "with_paths", nullptr};
+        PyObject *waypoints_object;
+        PyObject *offsets_object;
+        int threads = 1;
+        PyObject *out_object = Py_None;
+        int with_paths = 0;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|iOp", const_cast<char **>(keywords), &waypoints_object, &offsets_object,
+                                         &threads, &out_object, &with_paths))
+        {
+            return nullptr;
+        }
+
+        BufferView waypoints;
+        BufferView offsets;
+        if (!waypoints.get(waypoints_object, PyBUF_SIMPLE, "waypoints") || !offsets.get(offsets_object, PyBUF_SIMPLE, "offsets"))
+        {
+            return nullptr;
+        }
+        if (!waypoints.isInteger(4) || waypoints.view.len % (3 * 4) != 0)
+        {
+            PyErr_SetString(PyExc_ValueError, "waypoints must be int32 (x, y, penalty) triples");
+            return nullptr;
+        }
+        if (!offsets.isInteger(8) && !offsets.isInteger(4))
+        {
+            PyErr_SetString(PyExc_ValueError, "offsets must be int32 or int64");
+            return nullptr;
+        }
+
+        Batch batch;
+        batch.waypoints = static_cast<const int32_t *>(waypoints.view.buf);
+        batch.with_paths = with_paths != 0;
+        const Py_ssize_t rows = waypoints.view.len / (3 * 4);
+        const Py_ssize_t offset_count = offsets.view.len / offsets.view.itemsize;
+        batch.offsets.resize(offset_count);
+        for (Py_ssize_t i = 0; i < offset_count; ++i)
+        {
+            batch.offsets[i] = offsets.view.itemsize == 8 ? static_cast<const int64_t *>(offsets.view.buf)[i]
+                                                          : static_cast<const int32_t *>(offsets.view.buf)[i];
+            if ((i == 0 && batch.offsets[i] != 0) || (i > 0 && batch.offsets[i] < batch.offsets[i - 1]))
+            {
+                PyErr_SetString(PyExc_ValueError, "offsets must start at 0 and never decrease");
+                return nullptr;
+            }
+        }
+        if (offset_count == 0 || batch.offsets.back() != rows)
+        {
+            PyErr_SetString(PyExc_ValueError, "offsets must end at the number of waypoint rows");
+            return nullptr;
+        }
+        const Py_ssize_t count = offset_count - 1;
+
+        PyObject *answers_object;
+        BufferView answers;
+        if (out_object == Py_None)
+        {
+            answers_object = newArray("d", count, sizeof(double));
+        }
+        else
+        {
+            answers_object = out_object;
+            Py_INCREF(answers_object);
+        }
+        if (!answers_object || !answers.get(answers_object, PyBUF_WRITABLE, "out"))
+        {
+            Py_XDECREF(answers_object);
+            return nullptr;
+        }
+        if (answers.kind() != 'd' || answers.view.len != count * static_cast<Py_ssize_t>(sizeof(double)))
+        {
+            Py_DECREF(answers_object);
+            PyErr_Format(PyExc_ValueError, "out must be a float64 buffer of %zd answers", count);
+            return nullptr;
+        }
+        batch.answers = static_cast<double *>(answers.view.buf);
+        if (batch.with_paths)
+        {
+            batch.paths.resize(count);
+        }
+
+        Py_BEGIN_ALLOW_THREADS;
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        for (int w = 1; w < threads; ++w)
+        {
+            workers.emplace_back([&]
+                                 { solveRange(batch, next); });
+        }
+        solveRange(batch, next);
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        Py_END_ALLOW_THREADS;
+
+        if (!batch.with_paths)
+        {
+            return answers_object;
+        }
+        size_t total = 0;
+        for (const auto &path : batch.paths)
+        {
+            total += path.size();
+        }
+        PyObject *path_object = newArray("i", total, sizeof(int32_t));
+        PyObject *path_offsets_object = newArray("q", count + 1, sizeof(int64_t));
+        BufferView path_view;
+        BufferView path_offsets_view;
+        if (!path_object || !path_offsets_object || !path_view.get(path_object, PyBUF_WRITABLE, "path") ||
+            !path_offsets_view.get(path_offsets_object, PyBUF_WRITABLE, "path_offsets"))
+        {
+            Py_DECREF(answers_object);
+            Py_XDECREF(path_object);
+            Py_XDECREF(path_offsets_object);
+            return nullptr;
+        }
+        int32_t *path = static_cast<int32_t *>(path_view.view.buf);
+        int64_t *path_offsets = static_cast<int64_t *>(path_offsets_view.view.buf);
+        path_offsets[0] = 0;
+        for (Py_ssize_t k = 0; k < count; ++k)
+        {
+            std::memcpy(path + path_offsets[k], batch.paths[k].data(), batch.paths[k].size() * sizeof(int32_t));
+            path_offsets[k + 1] = path_offsets[k] + batch.paths[k].size();
+        }
+        return Py_BuildValue("(NNN)", answers_object, path_object, path_offsets_object);
+    }
+
+    PyMethodDef methods[] = {
+        {"solve_batch", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(solveBatch)), METH_VARARGS | METH_KEYWORDS,
+         "solve_batch(waypoints, offsets, threads=1, out=None, with_paths=False)\n\n"
+         "Lowest time of every course. waypoints: int32 buffer of (x, y, penalty) rows; offsets: int32 or\n"
+         "int64 buffer of course boundaries, from 0 to the row count. Returns array('d') (or out), or\n"
+         "(answers, path, path_offsets) with with_paths."},
+        {nullptr, nullptr, 0, nullptr}};
+
+    PyModuleDef module = {PyModuleDef_HEAD_INIT, "shearwater", "Shearwater challenge solver.", -1, methods};
+}
+
+PyMODINIT_FUNC PyInit_shearwater()
+{
+    PyObject *m = PyModule_Create(&module);
+    if (m && (PyModule_AddIntConstant(m, "SOLVER_VERSION", kSolverVersion) < 0 ||
+              PyModule_AddIntConstant(m, "COST_MODEL_VERSION", kCostModelVersion) < 0))
+    {
+        Py_DECREF(m);
+        return nullptr;
+    }
+    return m;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+    Heap allocation accounting for tests and benchmarks. Counts are kept per thread, so a scope only
+    sees its own thread's allocations.
+
+    The counting comes from replacement global operator new/delete, which must be defined exactly
+    once per binary: put SHEARWATER_DEFINE_ALLOCATION_HOOKS at namespace scope in one translation
+    unit. Without it every count reads zero. It replaces every replaceable form together (plain,
+    array, nothrow, aligned, sized), since a block from one form may be freed through another.
+*/
+struct AllocationCounts
+{
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytes_allocated = 0;
+    int64_t live_bytes = 0;
+    int64_t peak_live_bytes = 0;
+};
+
+inline AllocationCounts &threadAllocationCounts()
+{
+    static thread_local AllocationCounts counts;
+    return counts;
+}
+
+/**
+    Allocation deltas between construction and the call to counts(). peak_live_bytes is the highest
+    number of bytes live at once in the scope, above the bytes already live when it began.
+*/
+class AllocationScope
+{
+public:
+    AllocationScope() : start(threadAllocationCounts())
+    {
+        // Restart the peak so it reflects this scope only; the enclosing peak is restored on exit.
+        threadAllocationCounts().peak_live_bytes = start.live_bytes;
+    }
+
+    ~AllocationScope()
+    {
+        AllocationCounts &now = threadAllocationCounts();
+        if (start.peak_live_bytes > now.peak_live_bytes)
+        {
+            now.peak_live_bytes = start.peak_live_bytes;
+        }
+    }
+
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+
+    AllocationCounts counts() const
+    {
+        const AllocationCounts &now = threadAllocationCounts();
+        AllocationCounts delta;
+        delta.allocations = now.allocations - start.allocations;
+        delta.deallocations = now.deallocations - start.deallocations;
+        delta.bytes_allocated = now.bytes_allocated - start.bytes_allocated;
+        delta.live_bytes = now.live_bytes - start.live_bytes;
+        delta.peak_live_bytes = now.peak_live_bytes - start.live_bytes;
+        return delta;
+    }
+
+private:
+    AllocationCounts start;
+};
+
+namespace allocation_hooks
+{
+    // Each block carries its size in a header in front of the returned pointer, so live and peak
+    // bytes are exact even when the unsized operator delete is called.
+    constexpr size_t kHeader = alignof(std::max_align_t);
+
+    inline void *allocate(size_t size, size_t alignment)
+    {
+        size_t header = alignment > kHeader ? alignment : kHeader;
+        void *block = nullptr;
+        if (posix_memalign(&block, header, header + (size == 0 ? 1 : size)) != 0)
+        {
+            return nullptr;
+        }
+        char *user = static_cast<char *>(block) + header;
+        reinterpret_cast<size_t *>(user)[-1] = size;
+
+        AllocationCounts &counts = threadAllocationCounts();
+        counts.allocations++;
+        counts.bytes_allocated += size;
+        counts.live_bytes += size;
+        if (counts.live_bytes > counts.peak_live_bytes)
+        {
+            counts.peak_live_bytes = counts.live_bytes;
+        }
+        return user;
+    }
+
+    inline void deallocate(void *ptr, size_t alignment)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+        size_t header = alignment > kHeader ? alignment : kHeader;
+        char *user = static_cast<char *>(ptr);
+        size_t size = reinterpret_cast<size_t *>(user)[-1];
+
+        // Blocks may be freed on another thread than the one that allocated them, so a thread's
+        // live bytes can go negative; the deltas of a single-threaded scope stay exact.
+        AllocationCounts &counts = threadAllocationCounts();
+        counts.deallocations++;
+        counts.live_bytes -= size;
+        std::free(user - header);
+    }
+
+    inline void *allocateOrThrow(size_t size, size_t alignment)
+    {
+        void *ptr = allocate(size, alignment);
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+}
+
+#define SHEARWATER_DEFINE_ALLOCATION_HOOKS                                                                                          \
+    void *operator new(size_t size) { return allocation_hooks::allocateOrThrow(size, 0); }                                          \
+    void *operator new[](size_t size) { return allocation_hooks::allocateOrThrow(size, 0); }                                        \
+    void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocation_hooks::allocate(size, 0); }                \
+    void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocation_hooks::allocate(size, 0); }              \
+    void *operator new(size_t size, std::align_val_t al) { return allocation_hooks::allocateOrThrow(size, size_t(al)); }            \
+    void *operator new[](size_t size, std::align_val_t al) { return allocation_hooks::allocateOrThrow(size, size_t(al)); }          \
+    void *operator new(size_t size, std::align_val_t al, const std::nothrow_t &) noexcept                                           \
+    {                                                                                                                               \
+        return allocation_hooks::allocate(size, size_t(al));                                                                        \
+    }                                                                                                                               \
+    void *operator new[](size_t size, std::align_val_t al, const std::nothrow_t &) noexcept                                         \
+    {                                                                                                                               \
+        return allocation_hooks::allocate(size, size_t(al));                                                                        \
+    }                                                                                                                               \
+    void operator delete(void *ptr) noexcept { allocation_hooks::deallocate(ptr, 0); }                                              \
+    void operator delete[](void *ptr) noexcept { allocation_hooks::deallocate(ptr, 0); }                                            \
+    void operator delete(void *ptr, const std::nothrow_t &) noexcept { allocation_hooks::deallocate(ptr, 0); }                      \
+    void operator delete[](void *ptr, const std::nothrow_t &) noexcept { allocation_hooks::deallocate(ptr, 0); }                    \
+    void operator delete(void *ptr, size_t) noexcept { allocation_hooks::deallocate(ptr, 0); }                                      \
+    void operator delete[](void *ptr, size_t) noexcept { allocation_hooks::deallocate(ptr, 0); }                                    \
+    void operator delete(void *ptr, std::align_val_t al) noexcept { allocation_hooks::deallocate(ptr, size_t(al)); }                \
+    void operator delete[](void *ptr, std::align_val_t al) noexcept { allocation_hooks::deallocate(ptr, size_t(al)); }              \
+    void operator delete(void *ptr, std::align_val_t al, const std::nothrow_t &) noexcept                                           \
+    {                                                                                                                               \
+        allocation_hooks::deallocate(ptr, size_t(al));                                                                              \
+    }                                                                                                                               \
+    void operator delete[](void *ptr, std::align_val_t al, const std::nothrow_t &) noexcept                                         \
+    {                                                                                                                               \
+        allocation_hooks::deallocate(ptr, size_t(al));                                                                              \
+    }                                                                                                                               \
+    void operator delete(void *ptr, size_t, std::align_val_t al) noexcept { allocation_hooks::deallocate(ptr, size_t(al)); }        \
+    void operator delete[](void *ptr, size_t, std::align_val_t al) noexcept { allocation_hooks::deallocate(ptr, size_t(al)); }
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "optimizer.h"
+#include "result_cache.h"
+
+constexpr char kBatchJournalMagic[8] = {'S', 'W', 'J', 'O', 'U', 'R', 'N', 'L'};
+constexpr uint32_t kBatchJournalVersion = 1;
+
+/**
+    Hash of a whole batch, order included; ties a journal to the input it was written for.
+*/
+inline uint64_t batchFingerprint(const std::vector<std::vector<Waypoint>> &courses)
+{
+    uint64_t fingerprint = courses.size();
+    for (const auto &course : courses)
+    {
+        fingerprint = (fingerprint ^ hashWaypoints(course.data(), course.size())) * 0x9e3779b185ebca87ull;
+        fingerprint ^= fingerprint >> 29;
+    }
+    return fingerprint;
+}
+
+/**
+    Progress journal of a batch run, so an interrupted run resumes instead of starting over. The
+    file is a header naming the batch (course count and batchFingerprint()) followed by one 24-byte
+    record per finished course: index, answer bits and a checksum of both. Courses finish in any
+    order when solved on several threads; only the set matters.
+
+    Records are buffered and written with fdatasync() at most once per sync interval and on sync(),
+    so a crash loses at most the last interval of answers, which the next run simply solves again.
+    A record torn by the crash fails its checksum and is cut off when the journal is reopened.
+    Answers are stored bit for bit, so a resumed run prints exactly what an uninterrupted one would.
+*/
+class BatchJournal
+{
+public:
+    BatchJournal() = default;
+
+    ~BatchJournal()
+    {
+        close();
+    }
+
+    BatchJournal(const BatchJournal &) = delete;
+    BatchJournal &operator=(const BatchJournal &) = delete;
+
+    /**
+        Opens or creates the journal at path for courses and loads the answers it already holds.
+        Fails if the journal was written for a different batch.
+    */
+    bool open(const std::string &path, const std::vector<std::vector<Waypoint>> &courses,
+              std::chrono::milliseconds sync_interval = std::chrono::milliseconds(1000))
+    {
+        close();
+        pending.clear();
+        interval = sync_interval;
+        done.assign(courses.size(), false);
+        answers.assign(courses.size(), 0.0);
+        finished_count = 0;
+
+        fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+        struct stat info;
+        if (fd < 0 || ::fstat(fd, &info) < 0)
+        {
+            return fail(path);
+        }
+
+        Header expected = {};
+        std::memcpy(expected.magic, kBatchJournalMagic, sizeof(kBatchJournalMagic));
+        expected.version = kBatchJournalVersion;
+        expected.courses = courses.size();
+        expected.fingerprint = batchFingerprint(courses);
+
+        if (static_cast<size_t>(info.st_size) < sizeof(Header))
+        {
+            // New, or cut short before its header was complete: start over.
+            if (::ftruncate(fd, 0) < 0 || !writeAll(&expected, sizeof(expected)) || ::fdatasync(fd) < 0)
+            {
+                return fail(path);
+            }
+            last_sync = std::chrono::steady_clock::now();
+            return true;
+        }
+
+        std::vector<char> contents(static_cast<size_t>(info.st_size));
+        if (::pread(fd, contents.data(), contents.size(), 0) != static_cast<ssize_t>(contents.size()))
+        {
+            return fail(path);
+        }
+        Header header;
+        std::memcpy(&header, contents.data(), sizeof(header));
+        if (std::memcmp(header.magic, kBatchJournalMagic, sizeof(kBatchJournalMagic)) != 0 || header.version != kBatchJournalVersion)
+        {
+            last_error = path + ": not a shearwater batch journal";
+            close();
+            return false;
+        }
+        if (header.courses != expected.courses || header.fingerprint != expected.fingerprint)
+        {
+            last_error = path + ": journal belongs to a different batch; delete it to start over";
+            close();
+            return false;
+        }
+
+        size_t valid = sizeof(Header);
+        for (; valid + sizeof(Record) <= contents.size(); valid += sizeof(Record))
+        {
+            Record record;
+            std::memcpy(&record, contents.data() + valid, sizeof(record));
+            if (record.check != checksum(record.index, record.answer_bits) || record.index >= courses.size())
+            {
+                break;
+            }
+            if (!done[record.index])
+            {
+                done[record.index] = true;
+                ++finished_count;
+            }
+            std::memcpy(&answers[record.index], &record.answer_bits, sizeof(double));
+        }
+        if (valid < contents.size() && ::ftruncate(fd, static_cast<off_t>(valid)) < 0)
+        {
+            return fail(path);
+        }
+        if (::lseek(fd, static_cast<off_t>(valid), SEEK_SET) < 0)
+        {
+            return fail(path);
+        }
+        last_sync = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    /**
+        Writes out buffered records and closes the file.
+    */
+    void close()
+    {
+        if (fd >= 0)
+        {
+            sync();
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    const std::string &error() const
+    {
+        return last_error;
+    }
+
+    bool finished(size_t course) const
+    {
+        return done[course];
+    }
+
+    double answer(size_t course) const
+    {
+        return answers[course];
+    }
+
+    /**
+        Courses finished, including those loaded by open().
+    */
+    size_t finishedCount() const
+    {
+        return finished_count;
+    }
+
+    /**
+        Journals a finished course. Thread-safe; the buffer is synced once the interval has passed.
+    */
+    void record(size_t course, double answer)
+    {
+        Record entry;
+        entry.index = course;
+        std::memcpy(&entry.answer_bits, &answer, sizeof(double));
+        entry.check = checksum(entry.index, entry.answer_bits);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const char *bytes = reinterpret_cast<const char *>(&entry);
+        pending.insert(pending.end(), bytes, bytes + sizeof(entry));
+        if (std::chrono::steady_clock::now() - last_sync >= interval)
+        {
+            flushLocked();
+        }
+    }
+
+    /**
+        Writes buffered records and waits for them to reach the disk. Returns false on an I/O error,
+        after which the records stay buffered.
+    */
+    bool sync()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return flushLocked();
+    }
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t courses;
+        uint64_t fingerprint;
+    };
+
+    struct Record
+    {
+        uint64_t index;
+        uint64_t answer_bits;
+        uint64_t check;
+    };
+
+    int fd = -1;
+    std::string last_error;
+    std::chrono::milliseconds interval{1000};
+    std::chrono::steady_clock::time_point last_sync;
+    std::mutex mutex;
+    std::vector<char> pending;
+    // Only touched by open(): workers read them for courses loaded from the journal.
+    std::vector<bool> done;
+    std::vector<double> answers;
+    size_t finished_count = 0;
+
+    static uint64_t checksum(uint64_t index, uint64_t answer_bits)
+    {
+        uint64_t h = (index ^ 0x243f6a8885a308d3ull) * 0x9e3779b185ebca87ull;
+        h = ((h ^ (h >> 29)) ^ answer_bits) * 0x9e3779b185ebca87ull;
+        return h ^ (h >> 32);
+    }
+
+    bool fail(const std::string &what)
+    {
+        last_error = what + ": " + std::strerror(errno);
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+
+    bool writeAll(const void *data, size_t bytes)
+    {
+        const char *p = static_cast<const char *>(data);
+        while (bytes > 0)
+        {
+            ssize_t written = ::write(fd, p, bytes);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return false;
+            }
+            p += written;
+            bytes -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    bool flushLocked()
+    {
+        last_sync = std::chrono::steady_clock::now();
+        if (fd < 0 || pending.empty())
+        {
+            return true;
+        }
+        if (!writeAll(pending.data(), pending.size()) || ::fdatasync(fd) < 0)
+        {
+            last_error = std::string("journal write failed: ") + std::strerror(errno);
+            return false;
+        }
+        pending.clear();
+        return true;
+    }
+};
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch_journal.h"
+#include "disk_cache.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "optimizer.h"
+#include "perf_counters.h"
+#include "result_cache.h"
+#include "shadow_comparator.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+/**
+    Solves a batch of courses on a fixed number of worker threads. Workers take the next unsolved
+    course from a shared atomic index, so stragglers do not hold up the rest, and each keeps its own
+    Optimizer (and therefore its own warmed-up workspace) across calls. Answers come back in input
+    order. The calling thread works as worker 0; the others are threads started by the first solve()
+    and parked between calls until the BatchSolver is destroyed, so a long-lived solver (the
+    daemon's) pays thread creation once, not per batch.
+
+    With a LatencyRecorder attached, each worker times its solves into a private recorder; the
+    recorders are merged into the attached one after the workers join, so the hot path takes no
+    locks. Attached SolverMetrics are updated per course with relaxed atomics.
+
+    With enableCache(), each worker answers repeated courses from its own ResultCache. A shared
+    DiskResultCache (setDiskCache()) is consulted after it and filled with every new answer.
+
+    Workers claim tuningProfile().claim_size courses at a time (setTuning()), which trades load
+    balance for fewer contended claims on batches of many small courses.
+
+    With a BatchJournal attached, courses it already holds are answered from it and every newly
+    solved course is journaled, so an interrupted batch resumes where it stopped.
+*/
+class BatchSolver
+{
+public:
+    explicit BatchSolver(int threads = 1) : optimizers(threads < 1 ? 1 : threads), recorders(optimizers.size()) {}
+
+    ~BatchSolver()
+    {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            pool_stopping = true;
+        }
+        pool_wake.notify_all();
+        for (auto &thread : pool)
+        {
+            thread.join();
+        }
+    }
+
+    BatchSolver(const BatchSolver &) = delete;
+    BatchSolver &operator=(const BatchSolver &) = delete;
+
+    int threads() const
+    {
+        return static_cast<int>(optimizers.size());
+    }
+
+    void setLatencyRecorder(LatencyRecorder *recorder)
+    {
+        latency = recorder;
+    }
+
+    void setMetrics(SolverMetrics *solver_metrics)
+    {
+        metrics = solver_metrics;
+    }
+
+    /**
+        Gives every worker a result cache of max_bytes_per_worker; 0 removes the caches.
+    */
+    void enableCache(size_t max_bytes_per_worker)
+    {
+        caches.clear();
+        for (size_t w = 0; max_bytes_per_worker > 0 && w < optimizers.size(); ++w)
+        {
+            caches.push_back(std::make_unique<ResultCache>(max_bytes_per_worker));
+        }
+    }
+
+    /**
+        Consults and fills disk_cache, which outlives the process, for every course. Pass nullptr to stop.
+    */
+    void setDiskCache(DiskResultCache *disk_cache)
+    {
+        disk = disk_cache;
+    }
+
+    /**
+        Offers every solved course, with its answer and solve time, to shadow for comparison with a
+        candidate engine. Pass nullptr to stop.
+    */
+    void setShadow(ShadowComparator *shadow_comparator)
+    {
+        shadow = shadow_comparator;
+    }
+
+    /**
+        Caps each worker's Optimizer workspace; see Optimizer::setMemoryBudget(). 0 removes the cap.
+    */
+    void setMemoryBudget(size_t bytes_per_worker)
+    {
+        memory_budget = bytes_per_worker;
+        for (auto &optimizer : optimizers)
+        {
+            optimizer.setMemoryBudget(bytes_per_worker);
+        }
+    }
+
+    /**
+        Replaces the tuned parameters (tuningProfile()) of the workers' Optimizers and the claim
+        size. The worker count is fixed at construction and the cpu_level is process-wide
+        (selectCpuLevel()), so profile.threads and profile.cpu_level are not applied here.
+    */
+    void setTuning(const TuningProfile &profile)
+    {
+        claim_size = profile.claim_size < 1 ? 1 : profile.claim_size;
+        for (auto &optimizer : optimizers)
+        {
+            optimizer.setTuning(profile);
+        }
+    }
+
+    /**
+        Per-course memory plans of the last solve(), in input order. Empty without a memory budget;
+        courses answered from a cache or journal keep a default plan.
+    */
+    const std::vector<MemoryPlan> &memoryPlans() const
+    {
+        return course_plans;
+    }
+
+    /**
+        Skips courses finished in journal and records the others as they finish. The journal must
+        have been opened for the courses passed to solve(). Pass nullptr to stop.
+    */
+    void setJournal(BatchJournal *batch_journal)
+    {
+        journal = batch_journal;
+    }
+
+    /**
+        Cache counters summed over the workers.
+    */
+    ResultCacheStats cacheStats() const
+    {
+        ResultCacheStats total;
+        for (const auto &cache : caches)
+        {
+            ResultCacheStats stats = cache->stats();
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+            total.collisions += stats.collisions;
+            total.evictions += stats.evictions;
+            total.entries += stats.entries;
+            total.bytes += stats.bytes;
+        }
+        return total;
+    }
+
+    /**
+        Attributes hardware counters to the preprocess and solve phases. Counters only see the
+        calling thread, so they are honoured only with a single worker, which runs inline.
+    */
+    void setPhaseCounters(PhaseCounters *counters)
+    {
+        optimizers[0].setPhaseCounters(optimizers.size() == 1 ? counters : nullptr);
+    }
+
+    std::vector<double> solve(const std::vector<std::vector<Waypoint>> &courses)
+    {
+        std::vector<double> answers(courses.size());
+        if (kSolverStatsEnabled)
+        {
+            course_stats.assign(courses.size(), SolverStats());
+        }
+        course_plans.assign(memory_budget > 0 ? courses.size() : 0, MemoryPlan());
+        std::atomic<size_t> next{0};
+
+        if (optimizers.size() == 1)
+        {
+            work(0, courses, answers, next);
+        }
+        else
+        {
+            const std::function<void(size_t)> task = [&](size_t w)
+            { work(w, courses, answers, next); };
+            runOnPool(task);
+        }
+
+        if (journal)
+        {
+            journal->sync();
+        }
+        if (latency)
+        {
+            for (auto &recorder : recorders)
+            {
+                latency->merge(recorder);
+                recorder = LatencyRecorder();
+            }
+        }
+        return answers;
+    }
+
+    /**
+        Per-course counters of the last solve(), in input order. Empty unless built with
+        SHEARWATER_STATS.
+    */
+    const std::vector<SolverStats> &stats() const
+    {
+        return course_stats;
+    }
+
+private:
+    std::vector<Optimizer> optimizers;
+    std::vector<LatencyRecorder> recorders;
+    std::vector<std::unique_ptr<ResultCache>> caches;
+    DiskResultCache *disk = nullptr;
+    BatchJournal *journal = nullptr;
+    ShadowComparator *shadow = nullptr;
+    std::vector<SolverStats> course_stats;
+    std::vector<MemoryPlan> course_plans;
+    size_t memory_budget = 0;
+    size_t claim_size = tuningProfile().claim_size;
+    LatencyRecorder *latency = nullptr;
+    SolverMetrics *metrics = nullptr;
+    static inline const SolverStats kNoStats{}; // a cache hit did no search
+
+    // Workers 1..threads()-1, parked on pool_wake between solve() calls.
+    std::vector<std::thread> pool;
+    std::mutex pool_mutex;
+    std::condition_variable pool_wake;
+    std::condition_variable pool_done;
+    const std::function<void(size_t)> *pool_task = nullptr;
+    uint64_t pool_round = 0;
+    size_t pool_busy = 0;
+    bool pool_stopping = false;
+
+    // Runs task(w) for every worker, worker 0 on the calling thread, and returns when all are done.
+    void runOnPool(const std::function<void(size_t)> &task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            while (pool.size() + 1 < optimizers.size())
+            {
+                const size_t w = pool.size() + 1;
+                pool.emplace_back([this, w]
+                                  { poolLoop(w); });
+            }
+            pool_task = &task;
+            pool_busy = pool.size();
+            ++pool_round;
+        }
+        pool_wake.notify_all();
+        task(0);
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        pool_done.wait(lock, [this]
+                       { return pool_busy == 0; });
+        pool_task = nullptr;
+    }
+
+    void poolLoop(size_t w)
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            const std::function<void(size_t)> *task;
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex);
+                pool_wake.wait(lock, [&]
+                               { return pool_stopping || pool_round != seen; });
+                if (pool_stopping)
+                {
+                    return;
+                }
+                seen = pool_round;
+                task = pool_task;
+            }
+            (*task)(w);
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            if (--pool_busy == 0)
+            {
+                pool_done.notify_one();
+            }
+        }
+    }
+
+    void work(size_t worker, const std::vector<std::vector<Waypoint>> &courses, std::vector<double> &answers, std::atomic<size_t> &next)
+    {
+        SHEARWATER_TRACE_SPAN("worker", worker);
+        for (size_t first = next.fetch_add(claim_size, std::memory_order_relaxed); first < courses.size();
+             first = next.fetch_add(claim_size, std::memory_order_relaxed))
+        {
+            for (size_t c = first; c < std::min(first + claim_size, courses.size()); ++c)
+            {
+                solveOne(worker, c, courses, answers);
+            }
+        }
+    }
+
+    void solveOne(size_t worker, size_t c, const std::vector<std::vector<Waypoint>> &courses, std::vector<double> &answers)
+    {
+        Optimizer &optimizer = optimizers[worker];
+        LatencyRecorder &recorder = recorders[worker];
+        if (journal && journal->finished(c))
+        {
+            answers[c] = journal->answer(c);
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        bool hit = !caches.empty() && caches[worker]->lookup(courses[c], answers[c]);
+        if (!hit && disk && disk->lookup(courses[c], answers[c]))
+        {
+            hit = true;
+            if (!caches.empty())
+            {
+                caches[worker]->insert(courses[c], answers[c], {});
+            }
+        }
+        if (!hit)
+        {
+            answers[c] = optimizer.findLowestTime(courses[c]);
+            if (memory_budget > 0)
+            {
+                course_plans[c] = optimizer.memoryPlan();
+            }
+            // NaN: refused under the memory budget; nothing to remember.
+            if (!caches.empty() && !std::isnan(answers[c]))
+            {
+                caches[worker]->insert(courses[c], answers[c], optimizer.optimalPath());
+            }
+            if (disk && !std::isnan(answers[c]))
+            {
+                disk->insert(courses[c], answers[c], optimizer.optimalPath());
+            }
+        }
+        const SolverStats &stats = hit ? kNoStats : optimizer.stats();
+        if (latency || metrics || shadow)
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            if (shadow && !hit && !std::isnan(answers[c]))
+            {
+                shadow->offer(c, courses[c], answers[c], ns);
+            }
+            if (latency)
+            {
+                recorder.record(SolvePhase::Solve, c, courses[c].size() - 2, ns);
+            }
+            if (metrics)
+            {
+                metrics->recordSolve(courses[c].size() - 2, ns, stats);
+                if (!caches.empty() || disk)
+                {
+                    metrics->recordCacheLookup(hit);
+                }
+            }
+        }
+        if (kSolverStatsEnabled)
+        {
+            course_stats[c] = stats;
+        }
+        if (journal && !std::isnan(answers[c]))
+        {
+            journal->record(c, answers[c]);
+        }
+    }
+};
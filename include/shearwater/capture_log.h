@@ -0,0 +1,197 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "optimizer.h"
+
+/**
+    Compact binary log of incoming courses with their arrival times, written by the solver's capture
+    mode and read back by the replay driver.
+
+    Layout, all integers little-endian:
+        header   "SWCAPLOG", u32 version
+        record   u64 arrival_ns, u32 waypoint count N, u8 field width W (1 or 4),
+                 then N * (x, y, penalty) as W-byte fields (W = 4: two's complement)
+
+    A record uses 1-byte fields when every value of the course fits in 0..255, which covers every
+    valid challenge course (3 bytes per waypoint), and 4-byte fields otherwise, so capture is lossless
+    even for malformed input. The implicit start and finish waypoints are not stored.
+*/
+constexpr char kCaptureMagic[8] = {'S', 'W', 'C', 'A', 'P', 'L', 'O', 'G'};
+constexpr uint32_t kCaptureVersion = 1;
+
+// Larger counts are treated as corruption rather than allocated.
+constexpr uint64_t kCaptureMaxWaypoints = 1 << 24;
+
+/**
+    Wall-clock arrival timestamp, so logs appended across runs stay in order.
+*/
+inline uint64_t captureClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct CapturedCourse
+{
+    uint64_t arrival_ns = 0;
+    std::vector<Waypoint> waypoints; // framed with the (0,0) start and (100,100) finish
+};
+
+class CaptureWriter
+{
+public:
+    explicit CaptureWriter(std::ostream &output) : output(output) {}
+
+    /**
+        Writes the file header. Call once, on an empty file only; appending to an existing log skips it.
+    */
+    void writeHeader()
+    {
+        output.write(kCaptureMagic, sizeof(kCaptureMagic));
+        writeLE(kCaptureVersion, 4);
+    }
+
+    /**
+        Appends one framed course (as produced by readCourse()). Returns false if the stream failed.
+    */
+    bool append(uint64_t arrival_ns, const std::vector<Waypoint> &waypoints)
+    {
+        const size_t n = waypoints.size() < 2 ? 0 : waypoints.size() - 2;
+        int width = 1;
+        for (size_t i = 1; i <= n; ++i)
+        {
+            const Waypoint &wp = waypoints[i];
+            if (!fitsByte(wp.x) || !fitsByte(wp.y) || !fitsByte(wp.penalty))
+            {
+                width = 4;
+                break;
+            }
+        }
+
+        writeLE(arrival_ns, 8);
+        writeLE(static_cast<uint32_t>(n), 4);
+        writeLE(static_cast<uint32_t>(width), 1);
+        buffer.clear();
+        for (size_t i = 1; i <= n; ++i)
+        {
+            const Waypoint &wp = waypoints[i];
+            for (int value : {wp.x, wp.y, wp.penalty})
+            {
+                uint32_t bits = static_cast<uint32_t>(value);
+                for (int b = 0; b < width; ++b)
+                {
+                    buffer.push_back(static_cast<char>(bits >> (8 * b)));
+                }
+            }
+        }
+        output.write(buffer.data(), buffer.size());
+        return static_cast<bool>(output);
+    }
+
+private:
+    std::ostream &output;
+    std::vector<char> buffer;
+
+    static bool fitsByte(int value)
+    {
+        return value >= 0 && value <= 255;
+    }
+
+    void writeLE(uint64_t value, int bytes)
+    {
+        char le[8];
+        for (int b = 0; b < bytes; ++b)
+        {
+            le[b] = static_cast<char>(value >> (8 * b));
+        }
+        output.write(le, bytes);
+    }
+};
+
+class CaptureReader
+{
+public:
+    /**
+        Reads and checks the header; valid() reports the result.
+    */
+    explicit CaptureReader(std::istream &input) : input(input)
+    {
+        char magic[sizeof(kCaptureMagic)];
+        uint64_t version = 0;
+        ok = input.read(magic, sizeof(magic)) && std::memcmp(magic, kCaptureMagic, sizeof(magic)) == 0 &&
+             readLE(version, 4) && version == kCaptureVersion;
+    }
+
+    bool valid() const
+    {
+        return ok;
+    }
+
+    /**
+        Reads the next record into course, reusing its capacity. Returns false at the end of the log
+        or on a truncated or malformed record, which ends reading.
+    */
+    bool next(CapturedCourse &course)
+    {
+        uint64_t arrival = 0, n = 0, width = 0;
+        if (!ok || !readLE(arrival, 8) || !readLE(n, 4) || !readLE(width, 1) || (width != 1 && width != 4) ||
+            n > kCaptureMaxWaypoints)
+        {
+            ok = false;
+            return false;
+        }
+        buffer.resize(n * 3 * width);
+        if (!input.read(buffer.data(), buffer.size()))
+        {
+            ok = false;
+            return false;
+        }
+
+        course.arrival_ns = arrival;
+        course.waypoints.clear();
+        course.waypoints.reserve(n + 2);
+        course.waypoints.push_back(StandardCostModel::start());
+        const unsigned char *field = reinterpret_cast<const unsigned char *>(buffer.data());
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            int values[3];
+            for (int &value : values)
+            {
+                uint32_t bits = 0;
+                for (uint64_t b = 0; b < width; ++b)
+                {
+                    bits |= static_cast<uint32_t>(*field++) << (8 * b);
+                }
+                value = static_cast<int>(bits);
+            }
+            course.waypoints.push_back({values[0], values[1], values[2]});
+        }
+        course.waypoints.push_back(StandardCostModel::finish());
+        return true;
+    }
+
+private:
+    std::istream &input;
+    std::vector<char> buffer;
+    bool ok = false;
+
+    bool readLE(uint64_t &value, int bytes)
+    {
+        unsigned char le[8];
+        if (!input.read(reinterpret_cast<char *>(le), bytes))
+        {
+            return false;
+        }
+        value = 0;
+        for (int b = 0; b < bytes; ++b)
+        {
+            value |= static_cast<uint64_t>(le[b]) << (8 * b);
+        }
+        return true;
+    }
+};
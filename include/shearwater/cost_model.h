@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cmath>
+
+#include "waypoint.h"
+
+/**
+    The challenge's cost model: the UAV flies at 2 m/s and stops 10 s at every waypoint it visits
+    after the start, on a course framed by a (0,0) start and a (100,100) finish. Every member is
+    constexpr, so engines instantiated on it (BasicOptimizer<>, referenceLowestTime<>) fold them:
+    a leg costs its length times 0.5 plus 10. Changing it changes answers, so bump
+    kCostModelVersion (solver_version.h).
+*/
+struct StandardCostModel
+{
+    static constexpr double speed()
+    {
+        return 2.0;
+    }
+
+    static constexpr double stopSeconds()
+    {
+        return 10.0;
+    }
+
+    static constexpr Waypoint start()
+    {
+        return {0, 0, 0};
+    }
+
+    static constexpr Waypoint finish()
+    {
+        return {100, 100, 0};
+    }
+
+    static constexpr bool valid()
+    {
+        return true;
+    }
+};
+
+/**
+    The same cost model with parameters chosen at runtime, for other craft and fields: the finish
+    is at (field_size, field_size). Engines instantiated on it read the parameters on every use
+    instead of folding them. With the default values it gives the answers of StandardCostModel.
+*/
+struct RuntimeCostModel
+{
+    double speed_mps = StandardCostModel::speed();
+    double stop_seconds = StandardCostModel::stopSeconds();
+    int field_size = StandardCostModel::finish().x;
+
+    double speed() const
+    {
+        return speed_mps;
+    }
+
+    double stopSeconds() const
+    {
+        return stop_seconds;
+    }
+
+    Waypoint start() const
+    {
+        return StandardCostModel::start();
+    }
+
+    Waypoint finish() const
+    {
+        return {field_size, field_size, 0};
+    }
+
+    /**
+        A positive finite speed and a finite, non-negative stop time.
+    */
+    bool valid() const
+    {
+        return std::isfinite(speed_mps) && speed_mps > 0 && std::isfinite(stop_seconds) && stop_seconds >= 0;
+    }
+
+    bool isStandard() const
+    {
+        return speed_mps == StandardCostModel::speed() && stop_seconds == StandardCostModel::stopSeconds() &&
+               field_size == StandardCostModel::finish().x;
+    }
+};
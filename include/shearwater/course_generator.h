@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "optimizer.h"
+
+/**
+    Shape of a generated course. Positions always stay inside the 1..99 field of the challenge and
+    penalties inside 1..100, so generated courses are valid solver input.
+*/
+enum class CourseProfile
+{
+    Uniform,     // positions and penalties uniform over the whole range
+    Clustered,   // positions drawn around a handful of cluster centres
+    LowPenalty,  // uniform positions, penalties in 1..10 (skipping is cheap)
+    HighPenalty, // uniform positions, penalties in 90..100 (skipping is expensive)
+    MaxPenalty,  // adversarial: every penalty is 100, so no waypoint is ever worth skipping
+    Collinear,   // adversarial: runs of waypoints along straight lines, many ties between legs
+    ZigZag,      // adversarial: alternates between opposite corners with penalties of 1..3, so
+                 // skipping long runs stays competitive and penalty-based window pruning fails
+};
+
+constexpr CourseProfile kAllCourseProfiles[] = {
+    CourseProfile::Uniform, CourseProfile::Clustered, CourseProfile::LowPenalty, CourseProfile::HighPenalty,
+    CourseProfile::MaxPenalty, CourseProfile::Collinear, CourseProfile::ZigZag};
+
+// Distinct positions available in the 1..99 x 1..99 field.
+constexpr int kFieldCells = 99 * 99;
+
+inline const char *profileName(CourseProfile profile)
+{
+    switch (profile)
+    {
+    case CourseProfile::Uniform:
+        return "uniform";
+    case CourseProfile::Clustered:
+        return "clustered";
+    case CourseProfile::LowPenalty:
+        return "low_penalty";
+    case CourseProfile::HighPenalty:
+        return "high_penalty";
+    case CourseProfile::MaxPenalty:
+        return "max_penalty";
+    case CourseProfile::Collinear:
+        return "collinear";
+    case CourseProfile::ZigZag:
+        return "zigzag";
+    }
+    return "unknown";
+}
+
+/**
+    Inverse of profileName(). Returns false if the name is not a known profile.
+*/
+inline bool parseProfile(const std::string &name, CourseProfile &profile)
+{
+    for (CourseProfile candidate : kAllCourseProfiles)
+    {
+        if (name == profileName(candidate))
+        {
+            profile = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+    Deterministic course generator. The same seed, profile and N always give the same course on every
+    platform: only the raw std::mt19937_64 output is used, never the implementation-defined
+    standard distributions.
+
+    Waypoint positions within a course are unique, as the challenge requires, for any N up to
+    kFieldCells. A position that is already taken moves to the next free cell in raster order.
+    Larger courses cannot be unique on the field and are generated with repeats for scale testing.
+*/
+class CourseGenerator
+{
+public:
+    explicit CourseGenerator(uint64_t seed) : rng(seed) {}
+
+    /**
+        Generates a course of n waypoints framed with the (0,0) start and (100,100) finish.
+    */
+    std::vector<Waypoint> generate(CourseProfile profile, int n)
+    {
+        std::vector<Waypoint> waypoints;
+        waypoints.reserve(n + 2);
+        waypoints.push_back(StandardCostModel::start());
+
+        const bool unique = n <= kFieldCells;
+        std::vector<bool> occupied(unique ? kFieldCells : 0, false);
+
+        int centres[4][2];
+        for (auto &centre : centres)
+        {
+            centre[0] = uniform(15, 85);
+            centre[1] = uniform(15, 85);
+        }
+
+        // Collinear runs: current point and step direction.
+        int line_x = uniform(1, 99), line_y = uniform(1, 99), step_x = 1, step_y = 0, run_left = 0;
+
+        for (int i = 0; i < n; ++i)
+        {
+            Waypoint wp;
+            switch (profile)
+            {
+            case CourseProfile::Clustered:
+            {
+                const int *centre = centres[uniform(0, 3)];
+                wp.x = clampToField(centre[0] + uniform(-8, 8));
+                wp.y = clampToField(centre[1] + uniform(-8, 8));
+                break;
+            }
+            case CourseProfile::Collinear:
+            {
+                int next_x = line_x + step_x, next_y = line_y + step_y;
+                if (run_left == 0 || next_x < 1 || next_x > 99 || next_y < 1 || next_y > 99)
+                {
+                    // Start a new run from a random point in a random non-zero direction.
+                    line_x = uniform(1, 99);
+                    line_y = uniform(1, 99);
+                    do
+                    {
+                        step_x = uniform(-1, 1);
+                        step_y = uniform(-1, 1);
+                    } while (step_x == 0 && step_y == 0);
+                    run_left = uniform(8, 32);
+                    next_x = line_x;
+                    next_y = line_y;
+                }
+                line_x = next_x;
+                line_y = next_y;
+                --run_left;
+                wp.x = line_x;
+                wp.y = line_y;
+                break;
+            }
+            case CourseProfile::ZigZag:
+                wp.x = (i % 2 == 0) ? uniform(1, 20) : uniform(80, 99);
+                wp.y = (i % 2 == 0) ? uniform(1, 20) : uniform(80, 99);
+                break;
+            default:
+                wp.x = uniform(1, 99);
+                wp.y = uniform(1, 99);
+                break;
+            }
+            if (unique)
+            {
+                claimFreeCell(occupied, wp);
+            }
+            wp.penalty = penalty(profile);
+            waypoints.push_back(wp);
+        }
+
+        waypoints.push_back(StandardCostModel::finish());
+        return waypoints;
+    }
+
+private:
+    std::mt19937_64 rng;
+
+    int uniform(int lo, int hi)
+    {
+        return lo + static_cast<int>(rng() % static_cast<uint64_t>(hi - lo + 1));
+    }
+
+    static int clampToField(int v)
+    {
+        return v < 1 ? 1 : (v > 99 ? 99 : v);
+    }
+
+    /**
+        Moves wp to the first free cell at or after its position in raster order (wrapping) and marks
+        it taken. The caller guarantees a free cell exists.
+    */
+    static void claimFreeCell(std::vector<bool> &occupied, Waypoint &wp)
+    {
+        int cell = (wp.y - 1) * 99 + (wp.x - 1);
+        while (occupied[cell])
+        {
+            cell = (cell + 1) % kFieldCells;
+        }
+        occupied[cell] = true;
+        wp.x = cell % 99 + 1;
+        wp.y = cell / 99 + 1;
+    }
+
+    int penalty(CourseProfile profile)
+    {
+        switch (profile)
+        {
+        case CourseProfile::LowPenalty:
+            return uniform(1, 10);
+        case CourseProfile::HighPenalty:
+            return uniform(90, 100);
+        case CourseProfile::MaxPenalty:
+            return 100;
+        case CourseProfile::ZigZag:
+            return uniform(1, 3);
+        default:
+            return uniform(1, 100);
+        }
+    }
+};
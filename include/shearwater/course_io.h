@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "optimizer.h"
+
+/**
+    Reads the next course from a stream in the challenge input format: a waypoint count N followed by
+    N lines of "X Y P". Returns false at the terminating 0, the end of the stream, or a negative count
+    or truncated course.
+    The course is framed with the start and finish waypoints of the cost model (cost_model.h), which
+    is the layout Optimizer::findLowestTime expects. The vector's capacity is reused.
+*/
+template <typename CostModel = StandardCostModel>
+inline bool readCourse(std::istream &input, std::vector<Waypoint> &waypoints, const CostModel &model = CostModel())
+{
+    int numWaypoints;
+    if (!(input >> numWaypoints) || numWaypoints <= 0)
+    {
+        return false;
+    }
+    // Not reserved up front: the count is untrusted until the waypoints have been read.
+    waypoints.clear();
+    waypoints.push_back(model.start());
+    for (int j = 0; j < numWaypoints; ++j)
+    {
+        Waypoint wp;
+        if (!(input >> wp.x >> wp.y >> wp.penalty))
+        {
+            return false;
+        }
+        waypoints.push_back(wp);
+    }
+    waypoints.push_back(model.finish());
+    return true;
+}
+
+/**
+    Reads every course up to the terminating 0 (or the end of the stream). See readCourse().
+*/
+template <typename CostModel = StandardCostModel>
+inline std::vector<std::vector<Waypoint>> readCourses(std::istream &input, const CostModel &model = CostModel())
+{
+    std::vector<std::vector<Waypoint>> courses;
+    std::vector<Waypoint> waypoints;
+    while (readCourse(input, waypoints, model))
+    {
+        courses.push_back(std::move(waypoints));
+    }
+    return courses;
+}
+
+/**
+    Parses courses from a whole input held in memory, with the parse_ints kernel (cpu_dispatch.h)
+    instead of stream extraction. next() frames each course as readCourse() does and returns false
+    at the terminating 0, at the end of the data, or at input that is not a course (a stray
+    character, a truncated course).
+*/
+class CourseParser
+{
+public:
+    template <typename CostModel = StandardCostModel>
+    CourseParser(const char *data, size_t size, const CostModel &model = CostModel())
+        : data(data), size(size), start(model.start()), finish(model.finish())
+    {
+    }
+
+    bool next(std::vector<Waypoint> &waypoints)
+    {
+        const CpuKernels &kernels = cpuKernels();
+        int numWaypoints;
+        size_t used;
+        if (kernels.parse_ints(data + position, size - position, &numWaypoints, 1, &used) != 1 || numWaypoints <= 0)
+        {
+            return false;
+        }
+        position += used;
+        // A waypoint takes at least 6 bytes (" 1 2 3"): a count the rest of the data cannot hold
+        // is malformed, and must not size the vector.
+        if (static_cast<size_t>(numWaypoints) > (size - position) / 6)
+        {
+            return false;
+        }
+        waypoints.resize(numWaypoints + 2);
+        waypoints.front() = start;
+        const size_t values = 3 * static_cast<size_t>(numWaypoints);
+        if (kernels.parse_ints(data + position, size - position, &waypoints[1].x, values, &used) != values)
+        {
+            return false;
+        }
+        position += used;
+        waypoints.back() = finish;
+        return true;
+    }
+
+    /**
+        Offset just past the last course parsed.
+    */
+    size_t consumed() const
+    {
+        return position;
+    }
+
+private:
+    const char *data;
+    size_t size;
+    size_t position = 0;
+    Waypoint start;
+    Waypoint finish;
+};
+
+/**
+    Total number of course waypoints, excluding the implicit start and finish.
+*/
+inline size_t countWaypoints(const std::vector<std::vector<Waypoint>> &courses)
+{
+    size_t total = 0;
+    for (const auto &course : courses)
+    {
+        total += course.size() - 2;
+    }
+    return total;
+}
+
+/**
+    Formats an answer the way the challenge expects: rounded (not truncated) to three decimals.
+*/
+inline std::string formatAnswer(double lowest_time)
+{
+    char buffer[512]; // room for any double in full
+    std::snprintf(buffer, sizeof(buffer), "%.3f", lowest_time);
+    return buffer;
+}
+
+/**
+    Appends answers one per line, each as formatAnswer() formats it, with the format_fixed3 kernel
+    (cpu_dispatch.h).
+*/
+inline void appendAnswers(const double *answers, size_t count, std::string &output)
+{
+    cpuKernels().format_fixed3(answers, count, output);
+}
+
+/**
+    Writes courses in the challenge input format, dropping the implicit start and finish waypoints
+    and terminating the stream with a single 0.
+*/
+inline void writeCourses(std::ostream &output, const std::vector<std::vector<Waypoint>> &courses)
+{
+    for (const auto &course : courses)
+    {
+        output << course.size() - 2 << "\n";
+        for (size_t i = 1; i + 1 < course.size(); ++i)
+        {
+            output << course[i].x << " " << course[i].y << " " << course[i].penalty << "\n";
+        }
+    }
+    output << "0\n";
+}
@@ -0,0 +1,605 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SHEARWATER_X86_KERNELS 1
+#endif
+
+/**
+    Instruction set levels the hot kernels are built for. Every level is compiled into every binary
+    with per-function target attributes, so no build flag is needed; the best level the host
+    supports is picked once at startup (see cpuKernels()).
+
+    Baseline  portable scalar code, the only level off x86-64
+    Avx2      256-bit vectors and gathers
+    Avx512    512-bit vectors and byte masks (AVX-512F and AVX-512BW)
+*/
+enum class CpuLevel
+{
+    Baseline,
+    Avx2,
+    Avx512,
+    Count
+};
+
+constexpr int kCpuLevelCount = static_cast<int>(CpuLevel::Count);
+
+inline const char *cpuLevelName(CpuLevel level)
+{
+    static const char *names[kCpuLevelCount] = {"baseline", "avx2", "avx512"};
+    return names[static_cast<int>(level)];
+}
+
+inline bool parseCpuLevel(const std::string &name, CpuLevel &level)
+{
+    for (int l = 0; l < kCpuLevelCount; ++l)
+    {
+        if (name == cpuLevelName(static_cast<CpuLevel>(l)))
+        {
+            level = static_cast<CpuLevel>(l);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+    The best level this host's CPU and OS support, from CPUID.
+*/
+inline CpuLevel detectCpuLevel()
+{
+#ifdef SHEARWATER_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    {
+        return CpuLevel::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return CpuLevel::Avx2;
+    }
+#endif
+    return CpuLevel::Baseline;
+}
+
+/**
+    The hot kernels of one CpuLevel. Every level gives bit-identical results.
+*/
+struct CpuKernels
+{
+    CpuLevel level;
+
+    // out[k] = distance from (x, y) to point begin + k / speed + stop, for begin <= begin + k < end.
+    // points holds (x, y, penalty) int triples, the Waypoint layout.
+    void (*leg_times)(const int *points, int begin, int end, int x, int y, double speed, double stop, double *out);
+
+    // Index of the first smallest of count > 0 values (none NaN).
+    size_t (*argmin)(const double *values, size_t count);
+
+    // Parses up to max_count whitespace separated decimal ints from data into out and returns how
+    // many. Stops early at the end of the data or at anything that is not such an int (a stray
+    // character, an out of range value); *consumed is the offset just past the last int parsed.
+    size_t (*parse_ints)(const char *data, size_t size, int *out, size_t max_count, size_t *consumed);
+
+    // Appends each value as printf("%.3f\n") would.
+    void (*format_fixed3)(const double *values, size_t count, std::string &out);
+};
+
+// AVX-512F includes FMA: a contracted multiply-add would round differently from the other levels.
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+
+namespace cpu_kernels
+{
+    // Shared scalar pieces, also the tails of the vector loops.
+
+    // Dividing by a power of two and multiplying by its reciprocal round the same real number, so
+    // the cheaper multiply gives identical results there; 0 otherwise.
+    inline double exactReciprocal(double speed)
+    {
+        int exponent;
+        return std::frexp(speed, &exponent) == 0.5 ? 1.0 / speed : 0.0;
+    }
+
+    inline void legTimesScalar(const int *points, int begin, int end, int x, int y, double speed, double stop, double *out)
+    {
+        const double reciprocal = exactReciprocal(speed);
+        for (int j = begin; j < end; ++j)
+        {
+            // Differences in double, exact for any int coordinates.
+            const double dx = static_cast<double>(points[3 * j]) - x;
+            const double dy = static_cast<double>(points[3 * j + 1]) - y;
+            const double distance = std::sqrt(dx * dx + dy * dy);
+            out[j - begin] = (reciprocal != 0 ? distance * reciprocal : distance / speed) + stop;
+        }
+    }
+
+    inline size_t argminScalar(const double *values, size_t begin, size_t count, size_t best)
+    {
+        for (size_t i = begin; i < count; ++i)
+        {
+            if (values[i] < values[best])
+            {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    // Rounds v * 1000 to the nearest integer into *scaled when that provably matches printf's
+    // correctly rounded "%.3f", i.e. for non-negative v below 2^43 / 1000 not within 2^-8 of a
+    // rounding tie; false otherwise. Adding and subtracting 2^52 rounds to nearest.
+    inline bool scaleFixed3(double v, double &scaled)
+    {
+        const double t = v * 1000.0;
+        scaled = (t + 4503599627370496.0) - 4503599627370496.0;
+        return !std::signbit(v) && t < 8796093022208.0 && std::fabs(t - scaled) < 0.5 - 1.0 / 256;
+    }
+
+    inline void appendFixed3(double v, double scaled, bool fast, std::string &out)
+    {
+        if (!fast)
+        {
+            char buffer[512];
+            int length = std::snprintf(buffer, sizeof(buffer), "%.3f\n", v);
+            out.append(buffer, length);
+            return;
+        }
+        const uint64_t thousandths = static_cast<uint64_t>(scaled);
+        char buffer[24];
+        char *end = buffer + sizeof(buffer);
+        char *p = end;
+        *--p = '\n';
+        uint64_t fraction = thousandths % 1000;
+        for (int d = 0; d < 3; ++d, fraction /= 10)
+        {
+            *--p = static_cast<char>('0' + fraction % 10);
+        }
+        *--p = '.';
+        uint64_t whole = thousandths / 1000;
+        do
+        {
+            *--p = static_cast<char>('0' + whole % 10);
+            whole /= 10;
+        } while (whole);
+        out.append(p, end - p);
+    }
+
+    inline void formatFixed3Scalar(const double *values, size_t begin, size_t count, std::string &out)
+    {
+        for (size_t i = begin; i < count; ++i)
+        {
+            double scaled;
+            bool fast = scaleFixed3(values[i], scaled);
+            appendFixed3(values[i], scaled, fast, out);
+        }
+    }
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    inline bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // Digit and whitespace bitmasks of a 64-byte block, bit k for byte k.
+    struct BlockMasks
+    {
+        uint64_t digits;
+        uint64_t spaces;
+    };
+
+    inline BlockMasks classifyScalar(const char *block)
+    {
+        BlockMasks masks = {0, 0};
+        for (int k = 0; k < 64; ++k)
+        {
+            masks.digits |= static_cast<uint64_t>(isDigit(block[k])) << k;
+            masks.spaces |= static_cast<uint64_t>(isSpace(block[k])) << k;
+        }
+        return masks;
+    }
+
+    /**
+        The tokenizer shared by every level; Classify supplies the block masks. Whitespace runs and
+        digit runs are skipped a block at a time with count-trailing-zeros on the masks, so the
+        per-byte work is only the digit accumulation. The final partial block is classified from a
+        space-padded copy.
+    */
+    template <BlockMasks (*Classify)(const char *)>
+    size_t parseIntsWith(const char *data, size_t size, int *out, size_t max_count, size_t *consumed)
+    {
+        size_t count = 0;
+        size_t p = 0;
+        size_t block = SIZE_MAX;
+        BlockMasks masks = {0, 0};
+        char padded[64];
+        auto classify = [&](size_t at)
+        {
+            block = at & ~size_t(63);
+            if (block + 64 <= size)
+            {
+                masks = Classify(data + block);
+            }
+            else
+            {
+                std::memset(padded, ' ', sizeof(padded));
+                std::memcpy(padded, data + block, size - block);
+                masks = Classify(padded);
+            }
+        };
+        // First position at or after from whose bit is clear in the selected mask.
+        auto skip = [&](size_t from, uint64_t BlockMasks::*which)
+        {
+            while (from < size)
+            {
+                if (block == SIZE_MAX || from - block >= 64)
+                {
+                    classify(from);
+                }
+                uint64_t rest = ~(masks.*which) >> (from - block);
+                if (rest)
+                {
+                    return from + __builtin_ctzll(rest);
+                }
+                from = block + 64;
+            }
+            return size;
+        };
+
+        size_t end_of_last = 0;
+        while (count < max_count)
+        {
+            p = skip(p, &BlockMasks::spaces);
+            if (p >= size)
+            {
+                break;
+            }
+            const bool negative = data[p] == '-';
+            if (negative)
+            {
+                ++p;
+            }
+            const size_t digits_end = std::min(skip(p, &BlockMasks::digits), size);
+            if (digits_end == p || (digits_end < size && !isSpace(data[digits_end])))
+            {
+                break;
+            }
+            int64_t value = 0;
+            for (size_t k = p; k < digits_end && value <= int64_t(INT32_MAX) + 1; ++k)
+            {
+                value = value * 10 + (data[k] - '0');
+            }
+            if (value > int64_t(INT32_MAX) + negative)
+            {
+                break;
+            }
+            out[count++] = static_cast<int>(negative ? -value : value);
+            p = end_of_last = digits_end;
+        }
+        *consumed = end_of_last;
+        return count;
+    }
+
+    // SSE2 is part of x86-64, so the baseline there still evaluates two legs at a time.
+    inline void legTimesBaseline(const int *points, int begin, int end, int x, int y, double speed, double stop, double *out)
+    {
+        int j = begin;
+#ifdef SHEARWATER_X86_KERNELS
+        const __m128d origin_x = _mm_set1_pd(x);
+        const __m128d origin_y = _mm_set1_pd(y);
+        const __m128d speeds = _mm_set1_pd(speed);
+        const __m128d stops = _mm_set1_pd(stop);
+        const double reciprocal = exactReciprocal(speed);
+        const __m128d reciprocals = _mm_set1_pd(reciprocal);
+        for (; j + 2 <= end; j += 2)
+        {
+            __m128d dx = _mm_sub_pd(_mm_cvtepi32_pd(_mm_setr_epi32(points[3 * j], points[3 * j + 3], 0, 0)), origin_x);
+            __m128d dy = _mm_sub_pd(_mm_cvtepi32_pd(_mm_setr_epi32(points[3 * j + 1], points[3 * j + 4], 0, 0)), origin_y);
+            __m128d squared = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+            __m128d distance = _mm_sqrt_pd(squared);
+            __m128d time = reciprocal != 0 ? _mm_mul_pd(distance, reciprocals) : _mm_div_pd(distance, speeds);
+            _mm_storeu_pd(out + (j - begin), _mm_add_pd(time, stops));
+        }
+#endif
+        legTimesScalar(points, j, end, x, y, speed, stop, out + (j - begin));
+    }
+
+    inline size_t argminBaseline(const double *values, size_t count)
+    {
+        return argminScalar(values, 1, count, 0);
+    }
+
+    inline size_t parseIntsBaseline(const char *data, size_t size, int *out, size_t max_count, size_t *consumed)
+    {
+        return parseIntsWith<classifyScalar>(data, size, out, max_count, consumed);
+    }
+
+    inline void formatFixed3Baseline(const double *values, size_t count, std::string &out)
+    {
+        formatFixed3Scalar(values, 0, count, out);
+    }
+
+#ifdef SHEARWATER_X86_KERNELS
+    __attribute__((target("avx2"))) inline void legTimesAvx2(const int *points, int begin, int end, int x, int y, double speed,
+                                                             double stop, double *out)
+    {
+        const __m128i lanes = _mm_setr_epi32(0, 3, 6, 9);
+        const __m256d origin_x = _mm256_set1_pd(x);
+        const __m256d origin_y = _mm256_set1_pd(y);
+        const __m256d speeds = _mm256_set1_pd(speed);
+        const __m256d stops = _mm256_set1_pd(stop);
+        const double reciprocal = exactReciprocal(speed);
+        const __m256d reciprocals = _mm256_set1_pd(reciprocal);
+        int j = begin;
+        for (; j + 4 <= end; j += 4)
+        {
+            __m128i xs = _mm_i32gather_epi32(points + 3 * j, lanes, 4);
+            __m128i ys = _mm_i32gather_epi32(points + 3 * j + 1, lanes, 4);
+            __m256d dx = _mm256_sub_pd(_mm256_cvtepi32_pd(xs), origin_x);
+            __m256d dy = _mm256_sub_pd(_mm256_cvtepi32_pd(ys), origin_y);
+            __m256d squared = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+            __m256d distance = _mm256_sqrt_pd(squared);
+            __m256d time = reciprocal != 0 ? _mm256_mul_pd(distance, reciprocals) : _mm256_div_pd(distance, speeds);
+            _mm256_storeu_pd(out + (j - begin), _mm256_add_pd(time, stops));
+        }
+        legTimesScalar(points, j, end, x, y, speed, stop, out + (j - begin));
+    }
+
+    __attribute__((target("avx2"))) inline size_t argminAvx2(const double *values, size_t count)
+    {
+        if (count < 8)
+        {
+            return argminScalar(values, 1, count, 0);
+        }
+        __m256d best = _mm256_loadu_pd(values);
+        __m256d best_index = _mm256_setr_pd(0, 1, 2, 3);
+        __m256d index = best_index;
+        const __m256d step = _mm256_set1_pd(4);
+        size_t i = 4;
+        for (; i + 4 <= count; i += 4)
+        {
+            index = _mm256_add_pd(index, step);
+            __m256d v = _mm256_loadu_pd(values + i);
+            __m256d less = _mm256_cmp_pd(v, best, _CMP_LT_OQ);
+            best = _mm256_blendv_pd(best, v, less);
+            best_index = _mm256_blendv_pd(best_index, index, less);
+        }
+        double lane_best[4];
+        double lane_index[4];
+        _mm256_storeu_pd(lane_best, best);
+        _mm256_storeu_pd(lane_index, best_index);
+        size_t result = static_cast<size_t>(lane_index[0]);
+        for (int l = 1; l < 4; ++l)
+        {
+            if (lane_best[l] < values[result] || (lane_best[l] == values[result] && lane_index[l] < result))
+            {
+                result = static_cast<size_t>(lane_index[l]);
+            }
+        }
+        return argminScalar(values, i, count, result);
+    }
+
+    __attribute__((target("avx2"))) inline BlockMasks classifyAvx2(const char *block)
+    {
+        BlockMasks masks = {0, 0};
+        for (int half = 0; half < 2; ++half)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32 * half));
+            // '0'..'9' as a signed range test: bytes - '0' + 128 lands in [-128, -118] exactly for digits.
+            __m256i shifted = _mm256_add_epi8(bytes, _mm256_set1_epi8(static_cast<char>(128 - '0')));
+            __m256i digits = _mm256_cmpgt_epi8(_mm256_set1_epi8(-118), shifted);
+            // Whitespace: ' ' or '\t'..'\r', the same test for [9, 13] against -123.
+            __m256i controls = _mm256_cmpgt_epi8(_mm256_set1_epi8(-123), _mm256_add_epi8(bytes, _mm256_set1_epi8(128 - 9)));
+            __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')), controls);
+            masks.digits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(digits))) << (32 * half);
+            masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(spaces))) << (32 * half);
+        }
+        return masks;
+    }
+
+    __attribute__((target("avx2"))) inline size_t parseIntsAvx2(const char *data, size_t size, int *out, size_t max_count,
+                                                                size_t *consumed)
+    {
+        return parseIntsWith<classifyAvx2>(data, size, out, max_count, consumed);
+    }
+
+    __attribute__((target("avx2"))) inline void formatFixed3Avx2(const double *values, size_t count, std::string &out)
+    {
+        const __m256d thousand = _mm256_set1_pd(1000.0);
+        const __m256d magic = _mm256_set1_pd(4503599627370496.0);
+        const __m256d limit = _mm256_set1_pd(8796093022208.0);
+        const __m256d margin = _mm256_set1_pd(0.5 - 1.0 / 256);
+        const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(INT64_MAX));
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256d v = _mm256_loadu_pd(values + i);
+            __m256d t = _mm256_mul_pd(v, thousand);
+            __m256d scaled = _mm256_sub_pd(_mm256_add_pd(t, magic), magic);
+            __m256d ok = _mm256_and_pd(_mm256_cmp_pd(t, limit, _CMP_LT_OQ),
+                                       _mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(t, scaled), abs_mask), margin, _CMP_LT_OQ));
+            int fast = _mm256_movemask_pd(ok) & ~_mm256_movemask_pd(v); // the sign bit excludes -0.0 too
+            double lanes[4];
+            _mm256_storeu_pd(lanes, scaled);
+            for (int l = 0; l < 4; ++l)
+            {
+                appendFixed3(values[i + l], lanes[l], (fast >> l) & 1, out);
+            }
+        }
+        formatFixed3Scalar(values, i, count, out);
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) inline void legTimesAvx512(const int *points, int begin, int end, int x, int y,
+                                                                           double speed, double stop, double *out)
+    {
+        const __m256i lanes = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        const __m512d origin_x = _mm512_set1_pd(x);
+        const __m512d origin_y = _mm512_set1_pd(y);
+        const __m512d speeds = _mm512_set1_pd(speed);
+        const __m512d stops = _mm512_set1_pd(stop);
+        const double reciprocal = exactReciprocal(speed);
+        const __m512d reciprocals = _mm512_set1_pd(reciprocal);
+        int j = begin;
+        for (; j + 8 <= end; j += 8)
+        {
+            __m256i xs = _mm256_i32gather_epi32(points + 3 * j, lanes, 4);
+            __m256i ys = _mm256_i32gather_epi32(points + 3 * j + 1, lanes, 4);
+            __m512d dx = _mm512_sub_pd(_mm512_cvtepi32_pd(xs), origin_x);
+            __m512d dy = _mm512_sub_pd(_mm512_cvtepi32_pd(ys), origin_y);
+            __m512d squared = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+            __m512d distance = _mm512_sqrt_pd(squared);
+            __m512d time = reciprocal != 0 ? _mm512_mul_pd(distance, reciprocals) : _mm512_div_pd(distance, speeds);
+            _mm512_storeu_pd(out + (j - begin), _mm512_add_pd(time, stops));
+        }
+        legTimesScalar(points, j, end, x, y, speed, stop, out + (j - begin));
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) inline size_t argminAvx512(const double *values, size_t count)
+    {
+        if (count < 16)
+        {
+            return argminScalar(values, 1, count, 0);
+        }
+        __m512d best = _mm512_loadu_pd(values);
+        __m512d best_index = _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7);
+        __m512d index = best_index;
+        const __m512d step = _mm512_set1_pd(8);
+        size_t i = 8;
+        for (; i + 8 <= count; i += 8)
+        {
+            index = _mm512_add_pd(index, step);
+            __m512d v = _mm512_loadu_pd(values + i);
+            __mmask8 less = _mm512_cmp_pd_mask(v, best, _CMP_LT_OQ);
+            best = _mm512_mask_mov_pd(best, less, v);
+            best_index = _mm512_mask_mov_pd(best_index, less, index);
+        }
+        double lowest = _mm512_reduce_min_pd(best);
+        __mmask8 at_lowest = _mm512_cmp_pd_mask(best, _mm512_set1_pd(lowest), _CMP_EQ_OQ);
+        double first = _mm512_mask_reduce_min_pd(at_lowest, best_index);
+        return argminScalar(values, i, count, static_cast<size_t>(first));
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) inline BlockMasks classifyAvx512(const char *block)
+    {
+        __m512i bytes = _mm512_loadu_si512(block);
+        BlockMasks masks;
+        masks.digits = _mm512_cmple_epu8_mask(_mm512_sub_epi8(bytes, _mm512_set1_epi8('0')), _mm512_set1_epi8(9));
+        masks.spaces = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(' ')) |
+                       _mm512_cmple_epu8_mask(_mm512_sub_epi8(bytes, _mm512_set1_epi8('\t')), _mm512_set1_epi8('\r' - '\t'));
+        return masks;
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) inline size_t parseIntsAvx512(const char *data, size_t size, int *out,
+                                                                              size_t max_count, size_t *consumed)
+    {
+        return parseIntsWith<classifyAvx512>(data, size, out, max_count, consumed);
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) inline void formatFixed3Avx512(const double *values, size_t count, std::string &out)
+    {
+        const __m512d thousand = _mm512_set1_pd(1000.0);
+        const __m512d magic = _mm512_set1_pd(4503599627370496.0);
+        const __m512d limit = _mm512_set1_pd(8796093022208.0);
+        const __m512d margin = _mm512_set1_pd(0.5 - 1.0 / 256);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m512d v = _mm512_loadu_pd(values + i);
+            __m512d t = _mm512_mul_pd(v, thousand);
+            __m512d scaled = _mm512_sub_pd(_mm512_add_pd(t, magic), magic);
+            __mmask8 fast = _mm512_cmp_pd_mask(t, limit, _CMP_LT_OQ) &
+                            _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(t, scaled)), margin, _CMP_LT_OQ) &
+                            ~_mm512_cmplt_epi64_mask(_mm512_castpd_si512(v), _mm512_setzero_si512());
+            double lanes[8];
+            _mm512_storeu_pd(lanes, scaled);
+            for (int l = 0; l < 8; ++l)
+            {
+                appendFixed3(values[i + l], lanes[l], (fast >> l) & 1, out);
+            }
+        }
+        formatFixed3Scalar(values, i, count, out);
+    }
+#endif
+
+    inline const CpuKernels &table(CpuLevel level)
+    {
+        static const CpuKernels tables[kCpuLevelCount] = {
+            {CpuLevel::Baseline, legTimesBaseline, argminBaseline, parseIntsBaseline, formatFixed3Baseline},
+#ifdef SHEARWATER_X86_KERNELS
+            {CpuLevel::Avx2, legTimesAvx2, argminAvx2, parseIntsAvx2, formatFixed3Avx2},
+            {CpuLevel::Avx512, legTimesAvx512, argminAvx512, parseIntsAvx512, formatFixed3Avx512},
+#else
+            {CpuLevel::Avx2, legTimesBaseline, argminBaseline, parseIntsBaseline, formatFixed3Baseline},
+            {CpuLevel::Avx512, legTimesBaseline, argminBaseline, parseIntsBaseline, formatFixed3Baseline},
+#endif
+        };
+        return tables[static_cast<int>(level)];
+    }
+#pragma GCC pop_options
+
+    // The detected level, lowered by SHEARWATER_CPU_LEVEL=baseline|avx2|avx512 when that names a
+    // level the host supports; an unknown or unsupported name is ignored.
+    inline const CpuKernels *startupTable()
+    {
+        CpuLevel level = detectCpuLevel();
+        const char *requested = std::getenv("SHEARWATER_CPU_LEVEL");
+        CpuLevel forced;
+        if (requested && parseCpuLevel(requested, forced) && forced <= level)
+        {
+            level = forced;
+        }
+        return &table(level);
+    }
+
+    inline std::atomic<const CpuKernels *> &active()
+    {
+        static std::atomic<const CpuKernels *> kernels{startupTable()};
+        return kernels;
+    }
+}
+
+/**
+    The kernels in use: the best level of the host unless overridden, chosen on first use. A
+    function pointer call per kernel invocation; the kernels work on whole rows or buffers, so the
+    indirection is amortized.
+*/
+inline const CpuKernels &cpuKernels()
+{
+    return *cpu_kernels::active().load(std::memory_order_relaxed);
+}
+
+/**
+    The kernels of a given level, e.g. to compare levels in tests. Only call a level the host
+    supports (level <= detectCpuLevel()).
+*/
+inline const CpuKernels &cpuKernels(CpuLevel level)
+{
+    return cpu_kernels::table(level);
+}
+
+/**
+    Switches every later cpuKernels() call to the given level, for testing and for the --isa
+    override of the tools. Returns false, changing nothing, if the host does not support it.
+*/
+inline bool selectCpuLevel(CpuLevel level)
+{
+    if (level > detectCpuLevel())
+    {
+        return false;
+    }
+    cpu_kernels::active().store(&cpu_kernels::table(level), std::memory_order_relaxed);
+    return true;
+}
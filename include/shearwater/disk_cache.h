@@ -0,0 +1,541 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "optimizer.h"
+#include "result_cache.h"
+
+constexpr char kDiskCacheMagic[8] = {'S', 'W', 'D', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t kDiskCacheFormatVersion = 1;
+
+struct DiskCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t entries = 0; // in the file
+    uint64_t slots = 0;
+    bool writable = false;
+};
+
+/**
+    Persistent course hash -> (answer, optimal path) store in a memory-mapped file, for answers that
+    outlive the process, e.g. nightly replays of an archive that is mostly unchanged.
+
+    The file is an open-addressing table of fixed 32-byte slots followed by an append-only array of
+    path indices. Courses themselves are not stored: a slot is keyed by two independent 64-bit
+    hashWaypoints() values, so a false hit needs a 128-bit collision. Slots are written once and
+    published by a release store of their key, so any number of readers, in any process, look up
+    without locks while one writer appends. The writer holds an flock on PATH.lock; a second writer
+    opens read-only instead. When the table is half full or the path array is out of room, the
+    writer builds a file twice the size next to it and renames it over PATH, then flags the old file
+    as replaced; a reader's next lookup sees the flag and maps the new file (refresh()).
+
+    The header carries kSolverVersion and kCostModelVersion. A file stamped by another version is
+    ignored by readers and replaced, empty, by the next writer.
+
+    Entries survive a crash of the process. After a power loss, delete the file: pages reach the disk
+    in no particular order, so a published slot may point at a path that never did.
+*/
+class DiskResultCache
+{
+public:
+    DiskResultCache() = default;
+
+    ~DiskResultCache()
+    {
+        close();
+    }
+
+    DiskResultCache(const DiskResultCache &) = delete;
+    DiskResultCache &operator=(const DiskResultCache &) = delete;
+
+    /**
+        Maps the cache at path. With writable, takes the writer lock, creating the file if it is
+        missing and resetting it if it holds a cache of another format or version; if another
+        process holds the lock this falls back to read-only and still returns true (see writable()).
+        A reader fails on a missing file and on a stale stamp. Anything else at path is never
+        overwritten: opening it fails.
+    */
+    bool open(const std::string &path, bool writable = true, uint64_t initial_slots = 1 << 16)
+    {
+        close();
+        file_path = path;
+        if (writable)
+        {
+            lock_fd = ::open((path + ".lock").c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+            if (lock_fd < 0)
+            {
+                return fail(path + ".lock");
+            }
+            if (::flock(lock_fd, LOCK_EX | LOCK_NB) == 0)
+            {
+                is_writer = true;
+            }
+            else
+            {
+                ::close(lock_fd);
+                lock_fd = -1;
+            }
+        }
+
+        bool replaceable = false;
+        Mapping *mapping = map(path, is_writer, &replaceable);
+        if (!mapping && is_writer && replaceable)
+        {
+            uint64_t slots = 16;
+            while (slots < initial_slots)
+            {
+                slots <<= 1;
+            }
+            mapping = build(slots, 16 * slots, nullptr);
+        }
+        if (!mapping)
+        {
+            return false;
+        }
+        current.store(mapping, std::memory_order_release);
+        return true;
+    }
+
+    /**
+        Unmaps the cache and releases the writer lock.
+    */
+    void close()
+    {
+        delete current.exchange(nullptr);
+        retired.clear();
+        if (lock_fd >= 0)
+        {
+            ::close(lock_fd); // releases the flock
+            lock_fd = -1;
+        }
+        is_writer = false;
+    }
+
+    bool writable() const
+    {
+        return is_writer;
+    }
+
+    const std::string &error() const
+    {
+        return last_error;
+    }
+
+    /**
+        On a hit sets answer and, when path is given, the stored optimal path. Thread-safe and
+        lock-free, including while this process inserts.
+    */
+    bool lookup(const std::vector<Waypoint> &waypoints, double &answer, std::vector<int> *path = nullptr)
+    {
+        const Mapping *mapping = current.load(std::memory_order_acquire);
+        if (mapping && !is_writer && mapping->header->replaced.load(std::memory_order_acquire))
+        {
+            follow();
+            mapping = current.load(std::memory_order_acquire);
+        }
+        const Key key = keyOf(waypoints);
+        const Slot *slot = mapping ? find(*mapping, key) : nullptr;
+        // The path bounds come from the file; a corrupt slot is a miss, not a read past the mapping.
+        if (!slot || slot->key.load(std::memory_order_acquire) != key.primary ||
+            uint64_t(slot->path_offset) + slot->path_length > mapping->data_words)
+        {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        answer = slot->answer;
+        if (path)
+        {
+            path->assign(mapping->data + slot->path_offset, mapping->data + slot->path_offset + slot->path_length);
+        }
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+        Stores a result unless the course is already present. A no-op for readers. Thread-safe;
+        inserts are serialized and may grow the file.
+    */
+    void insert(const std::vector<Waypoint> &waypoints, double answer, const std::vector<int> &path)
+    {
+        if (!is_writer)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(write_mutex);
+        Mapping *mapping = current.load(std::memory_order_relaxed);
+        const Key key = keyOf(waypoints);
+        const Slot *existing = mapping ? find(*mapping, key) : nullptr;
+        if (!mapping || (existing && existing->key.load(std::memory_order_relaxed) == key.primary))
+        {
+            return;
+        }
+        Header &header = *mapping->header;
+        uint64_t used = header.data_used.load(std::memory_order_relaxed);
+        // No existing slot: the table is full despite its entry count, so it was damaged; doubling
+        // leaves it at most half full again.
+        if (!existing || 2 * (header.entries.load(std::memory_order_relaxed) + 1) > mapping->slot_count ||
+            used + path.size() > mapping->data_words)
+        {
+            uint64_t slots = existing ? mapping->slot_count : 2 * mapping->slot_count;
+            uint64_t words = mapping->data_words;
+            while (2 * (header.entries.load(std::memory_order_relaxed) + 1) > slots)
+            {
+                slots <<= 1;
+            }
+            while (used + path.size() > words)
+            {
+                words <<= 1;
+            }
+            if (words > UINT32_MAX || !(mapping = build(slots, words, mapping)))
+            {
+                return;
+            }
+            current.store(mapping, std::memory_order_release);
+        }
+        place(*mapping, key, answer, path.data(), path.size());
+        inserts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+        Picks up a file the writer has since replaced (grown or reset). Returns false when the file
+        now at the path cannot be used, keeping the current mapping. lookup() calls this itself once
+        the writer flags the mapped file as replaced; a writer reset over a stale file is only seen
+        here.
+    */
+    bool refresh()
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex);
+        return refreshLocked();
+    }
+
+    DiskCacheStats stats() const
+    {
+        DiskCacheStats result;
+        result.hits = hits.load(std::memory_order_relaxed);
+        result.misses = misses.load(std::memory_order_relaxed);
+        result.inserts = inserts.load(std::memory_order_relaxed);
+        result.writable = is_writer;
+        if (const Mapping *mapping = current.load(std::memory_order_acquire))
+        {
+            result.entries = mapping->header->entries.load(std::memory_order_relaxed);
+            result.slots = mapping->slot_count;
+        }
+        return result;
+    }
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint32_t format;
+        uint32_t solver_version;
+        uint32_t cost_model_version;
+        std::atomic<uint32_t> replaced; // set once a grown copy has been renamed over this file
+        uint64_t slot_count; // power of two
+        uint64_t data_words; // path array capacity, in ints
+        std::atomic<uint64_t> data_used;
+        std::atomic<uint64_t> entries;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> key; // primary hash, 0 while empty; stored last
+        uint64_t check;            // second, independent hash
+        double answer;
+        uint32_t path_offset;
+        uint32_t path_length;
+    };
+
+    static_assert(sizeof(Slot) == 32, "slots are a fixed on-disk layout");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "keys are shared across processes");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "the replaced flag is shared across processes");
+    static constexpr size_t kHeaderBytes = 4096;
+    static constexpr uint64_t kCheckSeed = 0x5851f42d4c957f2dull;
+
+    struct Key
+    {
+        uint64_t primary;
+        uint64_t check;
+    };
+
+    struct Mapping
+    {
+        void *base = nullptr;
+        size_t bytes = 0;
+        ino_t inode = 0;
+        // Copied from the header at map time: the file is shared, so its copy may change under us.
+        uint64_t slot_count = 0;
+        uint64_t data_words = 0;
+        Header *header = nullptr;
+        Slot *slots = nullptr;
+        int32_t *data = nullptr;
+
+        ~Mapping()
+        {
+            if (base)
+            {
+                ::munmap(base, bytes);
+            }
+        }
+    };
+
+    std::string file_path;
+    std::string last_error;
+    int lock_fd = -1;
+    bool is_writer = false;
+    std::mutex write_mutex;
+    std::mutex refresh_mutex; // readers only: serializes switching to a replaced file
+    std::atomic<Mapping *> current{nullptr};
+    // Replaced mappings stay valid until close(): a concurrent lookup may still be reading them.
+    std::vector<std::unique_ptr<Mapping>> retired;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> inserts{0};
+
+    static Key keyOf(const std::vector<Waypoint> &waypoints)
+    {
+        uint64_t primary = hashWaypoints(waypoints.data(), waypoints.size());
+        return {primary == 0 ? 1 : primary, hashWaypoints(waypoints.data(), waypoints.size(), kCheckSeed)};
+    }
+
+    static size_t fileBytes(uint64_t slots, uint64_t words)
+    {
+        return kHeaderBytes + slots * sizeof(Slot) + words * sizeof(int32_t);
+    }
+
+    // The slot holding key, or the empty slot where it would go; nullptr if a damaged file filled
+    // every slot (the writer keeps the table at most half full).
+    static Slot *find(const Mapping &mapping, const Key &key)
+    {
+        const uint64_t mask = mapping.slot_count - 1;
+        uint64_t i = key.primary & mask;
+        for (uint64_t probes = 0; probes < mapping.slot_count; ++probes, i = (i + 1) & mask)
+        {
+            Slot &slot = mapping.slots[i];
+            uint64_t stored = slot.key.load(std::memory_order_acquire);
+            if (stored == 0 || (stored == key.primary && slot.check == key.check))
+            {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    static void place(Mapping &mapping, const Key &key, double answer, const int *path, size_t length)
+    {
+        Header &header = *mapping.header;
+        Slot *slot = find(mapping, key);
+        if (!slot)
+        {
+            return;
+        }
+        uint64_t offset = header.data_used.load(std::memory_order_relaxed);
+        std::memcpy(mapping.data + offset, path, length * sizeof(int32_t));
+        slot->check = key.check;
+        slot->answer = answer;
+        slot->path_offset = static_cast<uint32_t>(offset);
+        slot->path_length = static_cast<uint32_t>(length);
+        header.data_used.store(offset + length, std::memory_order_relaxed);
+        header.entries.fetch_add(1, std::memory_order_relaxed);
+        slot->key.store(key.primary, std::memory_order_release);
+    }
+
+    bool fail(const std::string &what)
+    {
+        last_error = what + ": " + std::strerror(errno);
+        return false;
+    }
+
+    // lookup()'s refresh: a lookup that finds another thread already switching keeps reading the old
+    // mapping rather than waiting.
+    void follow()
+    {
+        std::unique_lock<std::mutex> lock(refresh_mutex, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            refreshLocked();
+        }
+    }
+
+    bool refreshLocked()
+    {
+        struct stat info;
+        const Mapping *mapping = current.load(std::memory_order_acquire);
+        if (is_writer || (mapping && ::stat(file_path.c_str(), &info) == 0 && info.st_ino == mapping->inode))
+        {
+            return true;
+        }
+        Mapping *replacement = map(file_path, false);
+        if (!replacement)
+        {
+            return false;
+        }
+        retire(current.exchange(replacement));
+        return true;
+    }
+
+    void retire(Mapping *mapping)
+    {
+        if (mapping)
+        {
+            retired.emplace_back(mapping);
+        }
+    }
+
+    Mapping *mapFd(int fd, uint64_t slots, uint64_t words, bool writable)
+    {
+        const size_t bytes = fileBytes(slots, words);
+        void *base = ::mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+        {
+            fail(file_path);
+            return nullptr;
+        }
+        struct stat info;
+        ::fstat(fd, &info);
+        Mapping *mapping = new Mapping;
+        mapping->base = base;
+        mapping->bytes = bytes;
+        mapping->inode = info.st_ino;
+        mapping->slot_count = slots;
+        mapping->data_words = words;
+        mapping->header = static_cast<Header *>(base);
+        mapping->slots = reinterpret_cast<Slot *>(static_cast<char *>(base) + kHeaderBytes);
+        mapping->data = reinterpret_cast<int32_t *>(mapping->slots + slots);
+        return mapping;
+    }
+
+    // Maps an existing cache file, or returns nullptr (with error() set) if it is missing, foreign or
+    // stale. *replaceable tells whether a fresh cache may be built over path: only if it is missing
+    // or holds a shearwater cache, stale or damaged, never over a foreign file.
+    Mapping *map(const std::string &path, bool writable, bool *replaceable = nullptr)
+    {
+        if (replaceable)
+        {
+            *replaceable = false;
+        }
+        int fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+        if (fd < 0)
+        {
+            if (replaceable)
+            {
+                *replaceable = errno == ENOENT;
+            }
+            fail(path);
+            return nullptr;
+        }
+        struct stat info;
+        Header header;
+        if (::fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(header) ||
+            ::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            std::memcmp(header.magic, kDiskCacheMagic, sizeof(kDiskCacheMagic)) != 0)
+        {
+            last_error = path + ": not a shearwater result cache, left alone";
+            ::close(fd);
+            return nullptr;
+        }
+        if (replaceable)
+        {
+            *replaceable = true;
+        }
+        if (static_cast<size_t>(info.st_size) < kHeaderBytes || header.format != kDiskCacheFormatVersion ||
+            header.slot_count == 0 || (header.slot_count & (header.slot_count - 1)) != 0 ||
+            header.slot_count > UINT32_MAX || header.data_words > UINT32_MAX ||
+            static_cast<size_t>(info.st_size) < fileBytes(header.slot_count, header.data_words) ||
+            header.data_used.load() > header.data_words || header.entries.load() > header.slot_count)
+        {
+            last_error = path + ": damaged or other format shearwater result cache";
+            ::close(fd);
+            return nullptr;
+        }
+        if (header.solver_version != kSolverVersion || header.cost_model_version != kCostModelVersion)
+        {
+            last_error = path + ": stale result cache (solver version " + std::to_string(header.solver_version) +
+                         ", cost model version " + std::to_string(header.cost_model_version) + ")";
+            ::close(fd);
+            return nullptr;
+        }
+        Mapping *mapping = mapFd(fd, header.slot_count, header.data_words, writable);
+        ::close(fd);
+        return mapping;
+    }
+
+    // Writes a fresh file holding the entries of from (if any) and renames it over the cache path.
+    // On success the new mapping replaces from, which is retired.
+    Mapping *build(uint64_t slots, uint64_t words, Mapping *from)
+    {
+        const std::string temporary = file_path + ".tmp";
+        int fd = ::open(temporary.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            fail(temporary);
+            return nullptr;
+        }
+        Mapping *mapping = nullptr;
+        if (::ftruncate(fd, static_cast<off_t>(fileBytes(slots, words))) == 0)
+        {
+            // The fresh file reads as zeros, so the counters start at 0 and every slot is empty;
+            // slot_count must be set before the mapping locates the path array.
+            Header header = {};
+            std::memcpy(header.magic, kDiskCacheMagic, sizeof(kDiskCacheMagic));
+            header.format = kDiskCacheFormatVersion;
+            header.solver_version = kSolverVersion;
+            header.cost_model_version = kCostModelVersion;
+            header.slot_count = slots;
+            header.data_words = words;
+            if (::pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)))
+            {
+                mapping = mapFd(fd, slots, words, true);
+            }
+        }
+        else
+        {
+            fail(temporary);
+        }
+        ::close(fd);
+        if (mapping && from)
+        {
+            for (uint64_t i = 0; i < from->slot_count; ++i)
+            {
+                const Slot &slot = from->slots[i];
+                uint64_t key = slot.key.load(std::memory_order_relaxed);
+                if (key != 0 && uint64_t(slot.path_offset) + slot.path_length <= from->data_words &&
+                    mapping->header->data_used.load(std::memory_order_relaxed) + slot.path_length <= words)
+                {
+                    place(*mapping, {key, slot.check}, slot.answer, from->data + slot.path_offset, slot.path_length);
+                }
+            }
+        }
+        if (!mapping || ::rename(temporary.c_str(), file_path.c_str()) < 0)
+        {
+            if (mapping)
+            {
+                fail(file_path);
+                delete mapping;
+            }
+            ::unlink(temporary.c_str());
+            return nullptr;
+        }
+        if (from)
+        {
+            from->header->replaced.store(1, std::memory_order_release);
+        }
+        retire(from);
+        return mapping;
+    }
+};
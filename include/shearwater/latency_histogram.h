@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <vector>
+
+#include "solve_phase.h"
+
+/**
+    HDR-style log-bucketed latency histogram in nanoseconds. Values below 32 ns are exact; above that
+    each power of two is split into 32 linear sub-buckets, so any recorded value is reported within
+    about 3% of its true value. Values beyond 2^40 ns (about 18 minutes) land in the last bucket.
+    Recording is an index computation and an increment; histograms merge by adding counts.
+*/
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr int kBuckets = kSubBuckets + (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram() : counts(kBuckets, 0) {}
+
+    void record(uint64_t ns)
+    {
+        counts[bucketOf(ns)]++;
+        total++;
+        sum += ns;
+        min_ns = std::min(min_ns, ns);
+        max_ns = std::max(max_ns, ns);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < kBuckets; ++i)
+        {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        min_ns = std::min(min_ns, other.min_ns);
+        max_ns = std::max(max_ns, other.max_ns);
+    }
+
+    uint64_t count() const
+    {
+        return total;
+    }
+
+    uint64_t max() const
+    {
+        return total == 0 ? 0 : max_ns;
+    }
+
+    uint64_t min() const
+    {
+        return total == 0 ? 0 : min_ns;
+    }
+
+    double mean() const
+    {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / total;
+    }
+
+    /**
+        Smallest bucket upper bound at or below which p percent of the values fall, clamped to the
+        exact recorded maximum.
+    */
+    uint64_t percentile(double p) const
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.999999);
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                return std::min(upperBoundOf(i), max_ns);
+            }
+        }
+        return max_ns;
+    }
+
+    static int bucketOf(uint64_t ns)
+    {
+        if (ns < kSubBuckets)
+        {
+            return static_cast<int>(ns);
+        }
+        int exponent = 63 - __builtin_clzll(ns);
+        if (exponent > kMaxExponent)
+        {
+            return kBuckets - 1;
+        }
+        int shift = exponent - kSubBucketBits;
+        return kSubBuckets + shift * kSubBuckets + static_cast<int>((ns >> shift) & (kSubBuckets - 1));
+    }
+
+    static uint64_t upperBoundOf(int bucket)
+    {
+        if (bucket < kSubBuckets)
+        {
+            return bucket;
+        }
+        int shift = (bucket - kSubBuckets) / kSubBuckets;
+        uint64_t mantissa = kSubBuckets + (bucket - kSubBuckets) % kSubBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+};
+
+/**
+    Per-thread latency record of a batch run: one histogram per pipeline phase, solve latency split
+    by course size (powers of two of N) and the slowest courses seen. Each worker owns one and
+    records without synchronisation; workers are merged once they are done.
+*/
+class LatencyRecorder
+{
+public:
+    static constexpr int kSizeClasses = 32;
+    static constexpr int kSlowestKept = 5;
+
+    struct SlowCourse
+    {
+        uint64_t ns;
+        size_t course;
+        size_t waypoints;
+    };
+
+    LatencyRecorder() : solve_by_size(kSizeClasses) {}
+
+    /**
+        Records one course's time in a phase. waypoints excludes the start and finish.
+    */
+    void record(SolvePhase phase, size_t course, size_t waypoints, uint64_t ns)
+    {
+        phases[static_cast<int>(phase)].record(ns);
+        if (phase != SolvePhase::Solve)
+        {
+            return;
+        }
+        solve_by_size[sizeClassOf(waypoints)].record(ns);
+        keepIfSlow({ns, course, waypoints});
+    }
+
+    void merge(const LatencyRecorder &other)
+    {
+        for (int p = 0; p < kSolvePhaseCount; ++p)
+        {
+            phases[p].merge(other.phases[p]);
+        }
+        for (int c = 0; c < kSizeClasses; ++c)
+        {
+            solve_by_size[c].merge(other.solve_by_size[c]);
+        }
+        for (int i = 0; i < other.slowest_count; ++i)
+        {
+            keepIfSlow(other.slowest_list[i]);
+        }
+    }
+
+    const LatencyHistogram &phase(SolvePhase phase) const
+    {
+        return phases[static_cast<int>(phase)];
+    }
+
+    /**
+        Solve latency of courses with N in [2^sizeClass, 2^(sizeClass+1)); class 0 also holds N = 0.
+    */
+    const LatencyHistogram &solveBySize(int size_class) const
+    {
+        return solve_by_size[size_class];
+    }
+
+    static int sizeClassOf(size_t waypoints)
+    {
+        return waypoints <= 1 ? 0 : std::min(kSizeClasses - 1, 63 - __builtin_clzll(waypoints));
+    }
+
+    /**
+        Slowest solves, slowest first.
+    */
+    std::vector<SlowCourse> slowest() const
+    {
+        std::vector<SlowCourse> sorted(slowest_list, slowest_list + slowest_count);
+        std::sort(sorted.begin(), sorted.end(), [](const SlowCourse &a, const SlowCourse &b)
+                  { return a.ns > b.ns; });
+        return sorted;
+    }
+
+    /**
+        Percentile table per phase, then solve latency by course size and the slowest courses.
+        Times are in microseconds.
+    */
+    void report(std::ostream &output) const
+    {
+        output << "phase          count       p50       p90       p99     p99.9       max  (us)\n";
+        for (int p = 0; p < kSolvePhaseCount; ++p)
+        {
+            if (phases[p].count() > 0)
+            {
+                writeRow(output, solvePhaseName(static_cast<SolvePhase>(p)), phases[p]);
+            }
+        }
+        output << "solve by N\n";
+        for (int c = 0; c < kSizeClasses; ++c)
+        {
+            if (solve_by_size[c].count() > 0)
+            {
+                char label[32];
+                std::snprintf(label, sizeof(label), "%llu-%llu", c == 0 ? 0ULL : 1ULL << c, (2ULL << c) - 1);
+                writeRow(output, label, solve_by_size[c]);
+            }
+        }
+        output << "slowest courses\n";
+        for (const SlowCourse &slow : slowest())
+        {
+            char line[96];
+            std::snprintf(line, sizeof(line), "  course %zu N=%zu %.3f us\n", slow.course, slow.waypoints, slow.ns / 1000.0);
+            output << line;
+        }
+    }
+
+private:
+    LatencyHistogram phases[kSolvePhaseCount];
+    std::vector<LatencyHistogram> solve_by_size;
+    SlowCourse slowest_list[kSlowestKept];
+    int slowest_count = 0;
+
+    void keepIfSlow(const SlowCourse &candidate)
+    {
+        if (slowest_count < kSlowestKept)
+        {
+            slowest_list[slowest_count++] = candidate;
+            return;
+        }
+        SlowCourse *fastest = std::min_element(slowest_list, slowest_list + kSlowestKept, [](const SlowCourse &a, const SlowCourse &b)
+                                               { return a.ns < b.ns; });
+        if (candidate.ns > fastest->ns)
+        {
+            *fastest = candidate;
+        }
+    }
+
+    static void writeRow(std::ostream &output, const char *label, const LatencyHistogram &histogram)
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-12s %7llu %9.3f %9.3f %9.3f %9.3f %9.3f\n", label,
+                      static_cast<unsigned long long>(histogram.count()), histogram.percentile(50) / 1000.0,
+                      histogram.percentile(90) / 1000.0, histogram.percentile(99) / 1000.0,
+                      histogram.percentile(99.9) / 1000.0, histogram.max() / 1000.0);
+        output << line;
+    }
+};
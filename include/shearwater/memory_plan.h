@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+/**
+    How Optimizer::findLowestTime() trades time for workspace under a memory budget, from most to
+    least memory:
+
+    Full         label-setting search with a lazy binary heap; the heap may hold one state per
+                 relaxation, O(N^2) in the worst case.
+    Compact      forward dynamic programming over the waypoint order with a cost and a predecessor
+                 per waypoint, O(N); no heap.
+    Reconstruct  as Compact without predecessors (a checkpoint per waypoint: its cost); the path is
+                 re-derived backwards from the costs, at up to O(N^2) extra time.
+    ScoreOnly    the costs alone: the answer without an optimal path.
+*/
+enum class MemoryStrategy
+{
+    Full,
+    Compact,
+    Reconstruct,
+    ScoreOnly,
+    Count
+};
+
+constexpr int kMemoryStrategyCount = static_cast<int>(MemoryStrategy::Count);
+
+inline const char *memoryStrategyName(MemoryStrategy strategy)
+{
+    static const char *names[kMemoryStrategyCount] = {"full", "compact", "reconstruct", "score_only"};
+    return names[static_cast<int>(strategy)];
+}
+
+inline std::string formatMemoryBytes(size_t bytes)
+{
+    char buffer[32];
+    if (bytes < 1024)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%zu B", bytes);
+    }
+    else if (bytes < 1024 * 1024)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.1f KB", bytes / 1024.0);
+    }
+    else
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / (1024.0 * 1024.0));
+    }
+    return buffer;
+}
+
+/**
+    The strategy Optimizer picked for a course and the workspace each strategy would have needed.
+    The course itself is not counted.
+*/
+struct MemoryPlan
+{
+    MemoryStrategy strategy = MemoryStrategy::Full;
+    bool fits = true;    // false when not even ScoreOnly fits; the course is refused
+    bool faster = false; // Compact although Full fits: the course is past the tuned forward DP crossover
+    size_t budget = 0;   // 0: unlimited
+    size_t bytes[kMemoryStrategyCount] = {};
+
+    size_t chosenBytes() const
+    {
+        return bytes[static_cast<int>(strategy)];
+    }
+
+    /**
+        Which strategy and why, e.g. "compact: full needs 120.3 MB (worst-case heap), over the
+        64.0 MB budget; compact needs 117.2 KB".
+    */
+    std::string describe() const
+    {
+        if (budget == 0)
+        {
+            return "full: no memory budget";
+        }
+        const size_t full = bytes[static_cast<int>(MemoryStrategy::Full)];
+        if (fits && strategy == MemoryStrategy::Full)
+        {
+            return "full: needs " + formatMemoryBytes(full) + " (worst-case heap), within the " + formatMemoryBytes(budget) + " budget";
+        }
+        if (fits && faster)
+        {
+            return std::string(memoryStrategyName(strategy)) + ": faster than full at this course size (tuning profile), needs " +
+                   formatMemoryBytes(chosenBytes()) + " within the " + formatMemoryBytes(budget) + " budget";
+        }
+        std::string text = std::string(fits ? memoryStrategyName(strategy) : "none") + ": full needs " + formatMemoryBytes(full) +
+                           " (worst-case heap), over the " + formatMemoryBytes(budget) + " budget";
+        for (int s = 1; s < kMemoryStrategyCount; ++s)
+        {
+            text += std::string("; ") + memoryStrategyName(static_cast<MemoryStrategy>(s)) + " needs " + formatMemoryBytes(bytes[s]);
+            if (fits && s == static_cast<int>(strategy))
+            {
+                break;
+            }
+        }
+        if (!fits)
+        {
+            text += ", course refused";
+        }
+        else if (strategy == MemoryStrategy::ScoreOnly)
+        {
+            text += ", no optimal path";
+        }
+        return text;
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "solver_stats.h"
+
+/**
+    Process-wide solver metrics in the Prometheus text exposition format (version 0.0.4). Updates are
+    relaxed atomic increments, so solving threads never lock; each counter sits on its own cache line.
+    A scrape reads every value once, without stopping writers, so values may be a few solves apart.
+*/
+enum class SolveError
+{
+    MalformedRequest, // unparseable or truncated input
+    Oversized,        // course larger than the solver was prepared for
+    Count
+};
+
+constexpr int kSolveErrorCount = static_cast<int>(SolveError::Count);
+
+inline const char *solveErrorName(SolveError error)
+{
+    static const char *names[kSolveErrorCount] = {"malformed_request", "oversized"};
+    return names[static_cast<int>(error)];
+}
+
+struct alignas(64) MetricCounter
+{
+    std::atomic<uint64_t> value{0};
+
+    void add(uint64_t n = 1)
+    {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+    Prometheus histogram over fixed upper bounds in nanoseconds. Buckets are stored non-cumulative
+    and summed at exposition.
+*/
+class PrometheusHistogram
+{
+public:
+    explicit PrometheusHistogram(std::vector<uint64_t> upper_bounds_ns = defaultBoundsNs())
+        : bounds(std::move(upper_bounds_ns)), buckets(new MetricCounter[bounds.size() + 1])
+    {
+    }
+
+    void observe(uint64_t ns)
+    {
+        size_t i = 0;
+        while (i < bounds.size() && ns > bounds[i])
+        {
+            ++i;
+        }
+        buckets[i].add();
+        sum_ns.add(ns);
+    }
+
+    /**
+        Writes name_bucket{le=...}, name_sum and name_count, in seconds.
+    */
+    void write(std::ostream &output, const char *name, const char *help) const
+    {
+        output << "# HELP " << name << " " << help << "\n# TYPE " << name << " histogram\n";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= bounds.size(); ++i)
+        {
+            cumulative += buckets[i].get();
+            output << name << "_bucket{le=\"";
+            if (i < bounds.size())
+            {
+                output << bounds[i] / 1e9;
+            }
+            else
+            {
+                output << "+Inf";
+            }
+            output << "\"} " << cumulative << "\n";
+        }
+        output << name << "_sum " << sum_ns.get() / 1e9 << "\n" << name << "_count " << cumulative << "\n";
+    }
+
+    // 1 us to 10 s in 1-2.5-5 steps.
+    static std::vector<uint64_t> defaultBoundsNs()
+    {
+        std::vector<uint64_t> result;
+        for (uint64_t decade = 1000; decade <= 1000000000; decade *= 10)
+        {
+            result.insert(result.end(), {decade, decade * 5 / 2, decade * 5});
+        }
+        result.push_back(10000000000ull);
+        return result;
+    }
+
+private:
+    std::vector<uint64_t> bounds;
+    std::unique_ptr<MetricCounter[]> buckets;
+    MetricCounter sum_ns;
+};
+
+class SolverMetrics
+{
+public:
+    /**
+        Records one solved course. waypoints excludes the start and finish; stats feed the pruning
+        counters, which stay zero unless built with SHEARWATER_STATS.
+    */
+    void recordSolve(size_t waypoints, uint64_t ns, const SolverStats &stats)
+    {
+        courses.add();
+        waypoint_count.add(waypoints);
+        latency.observe(ns);
+        if (kSolverStatsEnabled)
+        {
+            relaxations.add(stats.relaxations);
+            relaxations_pruned.add(stats.relaxations_pruned);
+        }
+    }
+
+    void recordCacheLookup(bool hit)
+    {
+        (hit ? cache_hits : cache_misses).add();
+    }
+
+    void recordError(SolveError error)
+    {
+        errors[static_cast<int>(error)].add();
+    }
+
+    uint64_t coursesSolved() const
+    {
+        return courses.get();
+    }
+
+    uint64_t errorCount(SolveError error) const
+    {
+        return errors[static_cast<int>(error)].get();
+    }
+
+    void writePrometheus(std::ostream &output) const
+    {
+        writeCounter(output, "shearwater_courses_solved_total", "Courses solved.", courses.get());
+        writeCounter(output, "shearwater_waypoints_processed_total", "Waypoints in solved courses, start and finish excluded.",
+                     waypoint_count.get());
+        latency.write(output, "shearwater_solve_duration_seconds", "Time to solve one course.");
+
+        output << "# HELP shearwater_errors_total Requests that could not be solved.\n# TYPE shearwater_errors_total counter\n";
+        for (int e = 0; e < kSolveErrorCount; ++e)
+        {
+            output << "shearwater_errors_total{kind=\"" << solveErrorName(static_cast<SolveError>(e)) << "\"} " << errors[e].get() << "\n";
+        }
+
+        output << "# HELP shearwater_cache_lookups_total Result cache lookups by outcome.\n# TYPE shearwater_cache_lookups_total counter\n"
+               << "shearwater_cache_lookups_total{result=\"hit\"} " << cache_hits.get() << "\n"
+               << "shearwater_cache_lookups_total{result=\"miss\"} " << cache_misses.get() << "\n";
+
+        if (kSolverStatsEnabled)
+        {
+            uint64_t evaluated = relaxations.get(), pruned = relaxations_pruned.get();
+            writeCounter(output, "shearwater_relaxations_total", "Legs whose cost was evaluated.", evaluated);
+            writeCounter(output, "shearwater_relaxations_pruned_total", "Legs skipped by the penalty bound.", pruned);
+            output << "# HELP shearwater_pruning_ratio Share of legs skipped by the penalty bound since start.\n"
+                   << "# TYPE shearwater_pruning_ratio gauge\n"
+                   << "shearwater_pruning_ratio " << (evaluated + pruned == 0 ? 0.0 : static_cast<double>(pruned) / (evaluated + pruned)) << "\n";
+        }
+    }
+
+private:
+    MetricCounter courses;
+    MetricCounter waypoint_count;
+    MetricCounter relaxations;
+    MetricCounter relaxations_pruned;
+    MetricCounter errors[kSolveErrorCount];
+    MetricCounter cache_hits;
+    MetricCounter cache_misses;
+    PrometheusHistogram latency;
+
+    static void writeCounter(std::ostream &output, const char *name, const char *help, uint64_t value)
+    {
+        output << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n" << name << " " << value << "\n";
+    }
+};
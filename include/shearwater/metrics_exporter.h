@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "unix_socket.h"
+
+/**
+    Writes the metrics as a node_exporter textfile: to PATH.tmp first, then renamed over PATH, so
+    the collector never reads a partial file.
+*/
+inline bool writeMetricsTextfile(const SolverMetrics &metrics, const std::string &path)
+{
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream output(temporary);
+        metrics.writePrometheus(output);
+        if (!output.flush())
+        {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+/**
+    Rewrites the textfile every interval from a background thread, and once more on destruction.
+*/
+class MetricsTextfile
+{
+public:
+    MetricsTextfile(const SolverMetrics &metrics, std::string path, std::chrono::milliseconds interval)
+        : metrics(metrics), path(std::move(path)), interval(interval)
+    {
+        writer = std::thread([this]
+                             { loop(); });
+    }
+
+    ~MetricsTextfile()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        writeMetricsTextfile(metrics, path);
+    }
+
+    MetricsTextfile(const MetricsTextfile &) = delete;
+    MetricsTextfile &operator=(const MetricsTextfile &) = delete;
+
+private:
+    const SolverMetrics &metrics;
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread writer;
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, interval, [this]
+                              { return stopping; }))
+        {
+            writeMetricsTextfile(metrics, path);
+        }
+    }
+};
+
+/**
+    Serves the metrics over HTTP/1.0 on 127.0.0.1:port from a background thread; every request,
+    typically GET /metrics, gets the full exposition. Port 0 picks a free port; see port(). Scrapes are handled one at a time, which is plenty
+    for a Prometheus server polling every few seconds.
+*/
+class MetricsHttpServer
+{
+public:
+    explicit MetricsHttpServer(const SolverMetrics &metrics) : metrics(metrics) {}
+
+    ~MetricsHttpServer()
+    {
+        stopping = true;
+        if (server.joinable())
+        {
+            server.join();
+        }
+        if (listen_fd >= 0)
+        {
+            ::close(listen_fd);
+        }
+    }
+
+    MetricsHttpServer(const MetricsHttpServer &) = delete;
+    MetricsHttpServer &operator=(const MetricsHttpServer &) = delete;
+
+    /**
+        Binds and starts serving. Returns false with error() set on failure.
+    */
+    bool start(int port)
+    {
+        listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        socklen_t length = sizeof(address);
+        if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+            ::listen(listen_fd, 16) < 0 || ::getsockname(listen_fd, reinterpret_cast<sockaddr *>(&address), &length) < 0)
+        {
+            last_error = "metrics port " + std::to_string(port) + ": " + std::strerror(errno);
+            return false;
+        }
+        bound_port = ntohs(address.sin_port);
+        server = std::thread([this]
+                             { loop(); });
+        return true;
+    }
+
+    int port() const
+    {
+        return bound_port;
+    }
+
+    const std::string &error() const
+    {
+        return last_error;
+    }
+
+private:
+    const SolverMetrics &metrics;
+    int listen_fd = -1;
+    int bound_port = 0;
+    std::string last_error;
+    std::atomic<bool> stopping{false};
+    std::thread server;
+
+    void loop()
+    {
+        while (!stopping.load())
+        {
+            pollfd ready = {listen_fd, POLLIN, 0};
+            if (::poll(&ready, 1, 100) <= 0)
+            {
+                continue;
+            }
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                respond(fd);
+                ::close(fd);
+            }
+        }
+    }
+
+    // Reads the request head (bounded, with a timeout) and answers with the current metrics.
+    void respond(int fd)
+    {
+        timeval timeout = {1, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+        {
+            ssize_t got = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (got <= 0)
+            {
+                break;
+            }
+            request.append(buffer, got);
+        }
+
+        std::ostringstream body;
+        metrics.writePrometheus(body);
+        const std::string text = body.str();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << text.size()
+                 << "\r\nConnection: close\r\n\r\n"
+                 << text;
+        const std::string bytes = response.str();
+        sendAll(fd, bytes.data(), bytes.size());
+    }
+};
@@ -0,0 +1,587 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "cost_model.h"
+#include "cpu_dispatch.h"
+#include "memory_plan.h"
+#include "perf_counters.h"
+#include "solver_stats.h"
+#include "solver_version.h"
+#include "trace.h"
+#include "tuning_profile.h"
+#include "waypoint.h"
+
+static_assert(sizeof(Waypoint) == 3 * sizeof(int), "the leg_times kernel reads waypoints as int triples");
+
+struct State
+{
+    int x;
+    int y;
+    int idx;
+    double cost;
+};
+
+struct StateCostGreater
+{
+    bool operator()(const State &a, const State &b) const
+    {
+        return a.cost > b.cost;
+    }
+};
+
+/**
+    The solver, specialized on a cost model (cost_model.h): the speed, the stop time and the
+    course frame. Use Optimizer, on StandardCostModel, whose constants fold into the code;
+    BasicOptimizer<RuntimeCostModel> takes them at runtime.
+*/
+template <typename CostModel = StandardCostModel>
+class BasicOptimizer
+{
+public:
+    BasicOptimizer() = default;
+
+    explicit BasicOptimizer(const CostModel &cost_model) : model(cost_model) {}
+
+    const CostModel &costModel() const
+    {
+        return model;
+    }
+
+    /**
+        The course is a directed acyclic graph: from waypoint i the UAV may fly to any later waypoint j,
+        paying the travel time, the stop at j and the penalties of every waypoint strictly
+        between i and j. The lowest time is the shortest path from the start to the finish, found
+        with a label-setting (Dijkstra) search.
+
+        Initialization:
+
+        Build a prefix sum of penalties so the skipped penalty of any leg is O(1).
+        Initialize the best known cost and predecessor per waypoint, the visited flags and a
+        binary heap of states ordered by cost, seeded with the start waypoint at cost 0. All of these
+        live in the Optimizer and are reused, so repeated calls do not allocate once warmed up.
+
+        Exploring Potential Paths:
+
+        Pop the cheapest state. States superseded by a cheaper push for the same waypoint are stale and
+        skipped via the visited flags. Once the finish is popped its cost is final.
+        Otherwise relax every later waypoint. The skipped penalty only grows with the leg length, so
+        once the current cost plus the stop plus the skipped penalty can no longer beat the
+        best known finish cost, no later waypoint can either: the window of waypoints worth relaxing
+        ends there, found by binary search on the prefix sums. Leg times across the window come
+        from the leg_times kernel (cpu_dispatch.h), a chunk at a time.
+
+        From the tuned crossover course size on (TuningProfile::forward_min_waypoints) the forward
+        DP of solveForward() is used instead; it finds the same answers.
+
+        Return Result:
+
+        The optimal path is rebuilt from the predecessors (see optimalPath()) and its total time,
+        travel plus stops plus missed penalties, is returned.
+    */
+    double findLowestTime(const std::vector<Waypoint> &waypoints)
+    {
+        const int n = waypoints.size();
+        SHEARWATER_TRACE_SPAN("findLowestTime", n);
+        optimal_path.clear();
+        SHEARWATER_STAT(last_stats = SolverStats(); uint64_t phase_start = statsNowNs();)
+        if (phase_counters)
+        {
+            phase_counters->enter(SolvePhase::Preprocess);
+        }
+        if (n == 0)
+        {
+            return 0.0;
+        }
+        // Past the tuned crossover the forward DP of the Compact strategy beats the heap search;
+        // it needs less memory, so it is taken whenever a budget allows the search.
+        const bool forward = tuning.forward_min_waypoints > 0 && n - 2 >= tuning.forward_min_waypoints;
+        if (strategy_forced)
+        {
+            last_plan = planMemory(n - 2, 0);
+            last_plan.strategy = forced_strategy;
+            if (forced_strategy != MemoryStrategy::Full)
+            {
+                return solveForward(waypoints, forced_strategy);
+            }
+        }
+        else if (memory_budget > 0)
+        {
+            last_plan = planMemory(n - 2, memory_budget);
+            if (last_plan.fits && last_plan.strategy == MemoryStrategy::Full && forward)
+            {
+                last_plan.strategy = MemoryStrategy::Compact;
+                last_plan.faster = true;
+            }
+            releaseUnused(last_plan);
+            if (!last_plan.fits)
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            if (last_plan.strategy != MemoryStrategy::Full)
+            {
+                return solveForward(waypoints, last_plan.strategy);
+            }
+            // Sized for the worst case up front: growing by doubling could overshoot the budget.
+            // Pages are only committed as the heap actually fills.
+            heap.reserve(static_cast<size_t>(n) * (n - 1) / 2 + 1);
+            optimal_path.reserve(n);
+        }
+        else if (forward)
+        {
+            return solveForward(waypoints, MemoryStrategy::Compact);
+        }
+
+        penalty_prefix.assign(n + 1, 0);
+        for (int i = 0; i < n; ++i)
+        {
+            penalty_prefix[i + 1] = penalty_prefix[i] + waypoints[i].penalty;
+        }
+
+        visited.assign(n, false);
+        dp.assign(n, std::numeric_limits<double>::infinity()); // Best known cost per waypoint
+        previous.assign(n, -1);
+        heap.clear();
+
+        dp[0] = 0.0;
+        pushState({waypoints[0].x, waypoints[0].y, 0, 0.0});
+        const CpuKernels &kernels = cpuKernels();
+        const int leg_chunk = tuning.leg_chunk;
+        double leg_times[TuningProfile::kMaxLegChunk];
+        SHEARWATER_STAT(last_stats.heap_pushes++; last_stats.setup_ns = statsNowNs() - phase_start; phase_start = statsNowNs();)
+        if (phase_counters)
+        {
+            phase_counters->enter(SolvePhase::Solve);
+        }
+
+        while (!heap.empty())
+        {
+            State current = popState();
+            SHEARWATER_STAT(last_stats.heap_pops++;)
+
+            if (visited[current.idx])
+            {
+                SHEARWATER_STAT(last_stats.stale_pops++;)
+                continue;
+            }
+
+            visited[current.idx] = true;
+            SHEARWATER_TRACE_EVENT("expand", current.idx);
+
+            if (current.idx == n - 1) // The finish cost is final once popped
+            {
+                break;
+            }
+
+            SHEARWATER_STAT(last_stats.expansions++;)
+            const long long skipped_base = penalty_prefix[current.idx + 1];
+            const int window_end = std::partition_point(penalty_prefix.begin() + current.idx + 1, penalty_prefix.begin() + n,
+                                                        [&](long long prefix)
+                                                        { return current.cost + model.stopSeconds() + static_cast<double>(prefix - skipped_base) < dp[n - 1]; }) -
+                                   penalty_prefix.begin();
+            SHEARWATER_STAT(last_stats.relaxations_pruned += n - window_end;)
+            for (int chunk = current.idx + 1; chunk < window_end; chunk += leg_chunk)
+            {
+                const int chunk_end = std::min(chunk + leg_chunk, window_end);
+                kernels.leg_times(&waypoints[0].x, chunk, chunk_end, current.x, current.y, model.speed(), model.stopSeconds(), leg_times);
+                for (int i = chunk; i < chunk_end; ++i)
+                {
+                    if (visited[i])
+                    {
+                        continue;
+                    }
+                    SHEARWATER_STAT(last_stats.relaxations++;)
+                    double skipped_cost = penalty_prefix[i] - skipped_base;
+                    double new_cost = current.cost + leg_times[i - chunk] + skipped_cost;
+                    if (new_cost < dp[i])
+                    {
+                        dp[i] = new_cost;
+                        previous[i] = current.idx;
+                        pushState({waypoints[i].x, waypoints[i].y, i, new_cost});
+                        SHEARWATER_STAT(last_stats.heap_pushes++;)
+                    }
+                }
+            }
+            SHEARWATER_STAT(
+                uint64_t window = window_end - current.idx - 1;
+                last_stats.window_total += window;
+                last_stats.window_max = std::max(last_stats.window_max, window);)
+        }
+        SHEARWATER_STAT(last_stats.search_ns = statsNowNs() - phase_start; phase_start = statsNowNs();)
+
+        for (int i = n - 1; i >= 0; i = previous[i])
+        {
+            optimal_path.push_back(i);
+        }
+        std::reverse(optimal_path.begin(), optimal_path.end());
+        SHEARWATER_TRACE_EVENT("path_length", optimal_path.size());
+
+        double total_time = calculateTotalTime(waypoints, optimal_path);
+        SHEARWATER_STAT(last_stats.path_ns = statsNowNs() - phase_start;)
+        return total_time;
+    }
+
+    /**
+        Allocates and touches the workspace for courses of up to max_waypoints waypoints (start and
+        finish not counted), so later calls on such courses neither allocate nor page-fault. The heap
+        is sized for its worst case, one entry per possible relaxation: about 12 MB at 1000
+        waypoints.
+    */
+    void reserve(int max_waypoints)
+    {
+        const size_t n = static_cast<size_t>(max_waypoints < 0 ? 0 : max_waypoints) + 2;
+        prefault(penalty_prefix, n + 1);
+        prefault(visited, n);
+        prefault(dp, n);
+        prefault(previous, n);
+        prefault(optimal_path, n);
+        prefault(heap, n * (n - 1) / 2 + 1);
+    }
+
+    /**
+        Caps the findLowestTime() workspace at bytes, 0 for no cap (the default). Each course then
+        gets the fastest strategy whose worst case fits (see MemoryStrategy and memoryPlan()), and
+        workspace the strategy does not use is released. A course that fits no strategy returns NaN.
+    */
+    void setMemoryBudget(size_t bytes)
+    {
+        memory_budget = bytes;
+        last_plan = MemoryPlan();
+    }
+
+    /**
+        Solves every course with strategy, whatever its size, the budget and the tuned crossover, and
+        keeps the workspace warm between calls, for running one strategy on its own (the windowed
+        engine, shadow comparison). autoStrategy() goes back to choosing per course.
+    */
+    void forceStrategy(MemoryStrategy strategy)
+    {
+        strategy_forced = true;
+        forced_strategy = strategy;
+        last_plan = MemoryPlan();
+    }
+
+    void autoStrategy()
+    {
+        strategy_forced = false;
+        last_plan = MemoryPlan();
+    }
+
+    /**
+        The strategy used by the last findLowestTime() call and why.
+    */
+    const MemoryPlan &memoryPlan() const
+    {
+        return last_plan;
+    }
+
+    /**
+        Replaces the tuned parameters this Optimizer started with (tuningProfile()): the leg chunk
+        size and the course size from which the forward DP replaces the heap search. Answers do not
+        depend on them. The profile's cpu_level and batch settings are not the Optimizer's.
+    */
+    void setTuning(const TuningProfile &profile)
+    {
+        tuning = profile;
+        tuning.leg_chunk = std::clamp(profile.leg_chunk, 1, TuningProfile::kMaxLegChunk);
+    }
+
+    const TuningProfile &tuningParameters() const
+    {
+        return tuning;
+    }
+
+    /**
+        Worst-case workspace of each strategy for a course of the given waypoint count (start and
+        finish not counted), and the fastest one within budget.
+    */
+    static MemoryPlan planMemory(int course_waypoints, size_t budget)
+    {
+        const size_t n = static_cast<size_t>(course_waypoints < 0 ? 0 : course_waypoints) + 2;
+        MemoryPlan plan;
+        plan.budget = budget;
+        plan.bytes[static_cast<int>(MemoryStrategy::Full)] =
+            (n + 1) * sizeof(long long) + (n + 7) / 8 + n * (sizeof(double) + 2 * sizeof(int)) + (n * (n - 1) / 2 + 1) * sizeof(State);
+        plan.bytes[static_cast<int>(MemoryStrategy::Compact)] = n * (sizeof(double) + 2 * sizeof(int));
+        plan.bytes[static_cast<int>(MemoryStrategy::Reconstruct)] = n * (sizeof(double) + sizeof(int));
+        plan.bytes[static_cast<int>(MemoryStrategy::ScoreOnly)] = n * sizeof(double);
+        plan.fits = false;
+        for (int s = 0; s < kMemoryStrategyCount; ++s)
+        {
+            if (budget == 0 || plan.bytes[s] <= budget)
+            {
+                plan.strategy = static_cast<MemoryStrategy>(s);
+                plan.fits = true;
+                break;
+            }
+        }
+        if (!plan.fits)
+        {
+            plan.strategy = MemoryStrategy::ScoreOnly;
+        }
+        return plan;
+    }
+
+    /**
+        Waypoint indices of the path found by the last findLowestTime() call, start and finish included.
+    */
+    const std::vector<int> &optimalPath() const
+    {
+        return optimal_path;
+    }
+
+    /**
+        Hot-path counters of the last findLowestTime() call. All zero unless built with
+        SHEARWATER_STATS.
+    */
+    const SolverStats &stats() const
+    {
+        return last_stats;
+    }
+
+    /**
+        Attributes hardware counters to the preprocess and solve phases of every findLowestTime()
+        call; the solve phase stays open on return. Pass nullptr to stop.
+    */
+    void setPhaseCounters(PhaseCounters *counters)
+    {
+        phase_counters = counters;
+    }
+
+private:
+    CostModel model;
+    std::vector<int> optimal_path;
+    SolverStats last_stats;
+    PhaseCounters *phase_counters = nullptr;
+    TuningProfile tuning = tuningProfile();
+
+    // findLowestTime() workspace, reused across calls
+    std::vector<long long> penalty_prefix;
+    std::vector<bool> visited;
+    std::vector<double> dp;
+    std::vector<int> previous;
+    std::vector<State> heap; // binary min-heap on cost
+    size_t memory_budget = 0;
+    bool strategy_forced = false;
+    MemoryStrategy forced_strategy = MemoryStrategy::Full;
+    MemoryPlan last_plan;
+
+    // Grows v to hold count elements and writes every page, leaving it empty with the capacity kept.
+    template <typename T>
+    static void prefault(std::vector<T> &v, size_t count)
+    {
+        v.assign(std::max(count, v.capacity()), T());
+        v.clear();
+    }
+
+    template <typename T>
+    static void release(std::vector<T> &v)
+    {
+        std::vector<T>().swap(v);
+    }
+
+    size_t workspaceBytes() const
+    {
+        return penalty_prefix.capacity() * sizeof(long long) + visited.capacity() / 8 + dp.capacity() * sizeof(double) +
+               previous.capacity() * sizeof(int) + optimal_path.capacity() * sizeof(int) + heap.capacity() * sizeof(State);
+    }
+
+    // Frees the workspace the planned strategy does not touch, and everything if what is left
+    // plus what the strategy needs could exceed the budget.
+    void releaseUnused(const MemoryPlan &plan)
+    {
+        if (plan.strategy != MemoryStrategy::Full)
+        {
+            release(heap);
+            release(penalty_prefix);
+            release(visited);
+        }
+        if (plan.strategy == MemoryStrategy::Reconstruct || plan.strategy == MemoryStrategy::ScoreOnly)
+        {
+            release(previous);
+        }
+        if (plan.strategy == MemoryStrategy::ScoreOnly)
+        {
+            release(optimal_path);
+        }
+        if (workspaceBytes() + plan.chosenBytes() > plan.budget)
+        {
+            release(heap);
+            release(penalty_prefix);
+            release(visited);
+            release(dp);
+            release(previous);
+            release(optimal_path);
+        }
+    }
+
+    /**
+        The Compact, Reconstruct and ScoreOnly strategies. Every leg goes from a lower to a higher
+        index, so a waypoint's cost is final once all earlier ones have been relaxed from: relax
+        forward in index order, with the skipped penalty summed as the leg grows and the same
+        pruning bound as the search. The leg times of each window come from the leg_times kernel.
+    */
+    double solveForward(const std::vector<Waypoint> &waypoints, MemoryStrategy strategy)
+    {
+        const int n = waypoints.size();
+        const bool predecessors = strategy == MemoryStrategy::Compact;
+        SHEARWATER_STAT(uint64_t phase_start = statsNowNs();)
+        dp.assign(n, std::numeric_limits<double>::infinity());
+        if (predecessors)
+        {
+            previous.assign(n, -1);
+        }
+        dp[0] = 0.0;
+        SHEARWATER_STAT(last_stats.setup_ns = statsNowNs() - phase_start; phase_start = statsNowNs();)
+        if (phase_counters)
+        {
+            phase_counters->enter(SolvePhase::Solve);
+        }
+
+        const CpuKernels &kernels = cpuKernels();
+        const int leg_chunk = tuning.leg_chunk;
+        double leg_times[TuningProfile::kMaxLegChunk];
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            SHEARWATER_STAT(last_stats.expansions++;)
+            SHEARWATER_TRACE_EVENT("expand", i);
+            int window_end = i + 1;
+            for (double skipped_cost = 0; window_end < n && dp[i] + model.stopSeconds() + skipped_cost < dp[n - 1]; ++window_end)
+            {
+                skipped_cost += waypoints[window_end].penalty;
+            }
+            SHEARWATER_STAT(
+                uint64_t window = window_end - i - 1;
+                last_stats.relaxations += window;
+                last_stats.relaxations_pruned += n - window_end;
+                last_stats.window_total += window;
+                last_stats.window_max = std::max(last_stats.window_max, window);)
+            double skipped_cost = 0;
+            for (int chunk = i + 1; chunk < window_end; chunk += leg_chunk)
+            {
+                const int chunk_end = std::min(chunk + leg_chunk, window_end);
+                kernels.leg_times(&waypoints[0].x, chunk, chunk_end, waypoints[i].x, waypoints[i].y, model.speed(), model.stopSeconds(), leg_times);
+                for (int j = chunk; j < chunk_end; ++j)
+                {
+                    double new_cost = dp[i] + leg_times[j - chunk] + skipped_cost;
+                    if (new_cost < dp[j])
+                    {
+                        dp[j] = new_cost;
+                        if (predecessors)
+                        {
+                            previous[j] = i;
+                        }
+                    }
+                    skipped_cost += waypoints[j].penalty;
+                }
+            }
+        }
+        SHEARWATER_STAT(last_stats.search_ns = statsNowNs() - phase_start; phase_start = statsNowNs();)
+
+        if (strategy == MemoryStrategy::ScoreOnly)
+        {
+            return dp[n - 1];
+        }
+        optimal_path.reserve(n);
+        for (int j = n - 1; j >= 0; j = predecessors ? previous[j] : bestPredecessor(waypoints, j))
+        {
+            optimal_path.push_back(j);
+        }
+        std::reverse(optimal_path.begin(), optimal_path.end());
+        SHEARWATER_TRACE_EVENT("path_length", optimal_path.size());
+        double total_time = calculateTotalTime(waypoints, optimal_path);
+        SHEARWATER_STAT(last_stats.path_ns = statsNowNs() - phase_start;)
+        return total_time;
+    }
+
+    // The i < j whose leg to j gives j its cost, the earliest on ties; -1 for the start. Leg costs
+    // are evaluated and reduced a chunk at a time with the leg_times and argmin kernels.
+    int bestPredecessor(const std::vector<Waypoint> &waypoints, int j)
+    {
+        const CpuKernels &kernels = cpuKernels();
+        const int leg_chunk = tuning.leg_chunk;
+        double costs[TuningProfile::kMaxLegChunk];
+        int best = -1;
+        double best_cost = std::numeric_limits<double>::infinity();
+        double skipped_cost = 0; // penalties strictly between i and j
+        for (int i = 1; i < j; ++i)
+        {
+            skipped_cost += waypoints[i].penalty;
+        }
+        for (int chunk = 0; chunk < j; chunk += leg_chunk)
+        {
+            const int chunk_end = std::min(chunk + leg_chunk, j);
+            kernels.leg_times(&waypoints[0].x, chunk, chunk_end, waypoints[j].x, waypoints[j].y, model.speed(), model.stopSeconds(), costs);
+            for (int i = chunk; i < chunk_end; ++i)
+            {
+                costs[i - chunk] = dp[i] + costs[i - chunk] + skipped_cost;
+                skipped_cost -= i + 1 < j ? waypoints[i + 1].penalty : 0;
+            }
+            const int lowest = chunk + static_cast<int>(kernels.argmin(costs, chunk_end - chunk));
+            if (costs[lowest - chunk] < best_cost)
+            {
+                best_cost = costs[lowest - chunk];
+                best = lowest;
+            }
+        }
+        return best;
+    }
+
+    void pushState(const State &state)
+    {
+        heap.push_back(state);
+        std::push_heap(heap.begin(), heap.end(), StateCostGreater());
+    }
+
+    State popState()
+    {
+        std::pop_heap(heap.begin(), heap.end(), StateCostGreater());
+        State state = heap.back();
+        heap.pop_back();
+        return state;
+    }
+
+    double distance(int x1, int y1, int x2, int y2)
+    {
+        return std::sqrt(std::pow(x2 - x1, 2) + std::pow(y2 - y1, 2));
+    }
+
+    double getSkippedTime(const std::vector<int> &path, const std::vector<Waypoint> &waypoints)
+    {
+        double skipped_time = 0.0;
+        size_t next_on_path = 0;
+        for (int i = 0; i < static_cast<int>(waypoints.size()); ++i)
+        {
+            if (next_on_path < path.size() && path[next_on_path] == i)
+            {
+                ++next_on_path;
+                continue;
+            }
+            skipped_time += waypoints[i].penalty;
+        }
+        return skipped_time;
+    }
+
+    double calculateTotalTime(const std::vector<Waypoint> &waypoints, const std::vector<int> &path)
+    {
+        double total_time = 0.0;
+        int current_x = model.start().x, current_y = model.start().y;
+        auto skipped_time = getSkippedTime(path, waypoints);
+
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            total_time += distance(current_x, current_y, waypoints[path[i]].x, waypoints[path[i]].y) / model.speed() + model.stopSeconds();
+            current_x = waypoints[path[i]].x;
+            current_y = waypoints[path[i]].y;
+        }
+        total_time -= model.stopSeconds(); // the start is not a stop
+
+        return total_time + skipped_time;
+    }
+};
+
+using Optimizer = BasicOptimizer<>;
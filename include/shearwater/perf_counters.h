@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "solve_phase.h"
+
+/**
+    Thin wrapper over Linux perf_event_open counting the calling thread in user space. Each event is
+    opened on its own, so an event the kernel, CPU or container refuses (hardware counters are
+    usually missing in containers and VMs) is simply reported as unavailable while the others keep
+    counting. On other platforms nothing is available and every read returns zeros.
+*/
+enum class PerfEvent
+{
+    TaskClock, // software: nanoseconds on CPU
+    Cycles,
+    Instructions,
+    L1DMisses, // L1 data cache read misses
+    LLCMisses, // last level cache read misses
+    BranchMisses,
+    Count
+};
+
+constexpr int kPerfEventCount = static_cast<int>(PerfEvent::Count);
+
+inline const char *perfEventName(PerfEvent event)
+{
+    static const char *names[kPerfEventCount] = {"task_clock_ns", "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+    return names[static_cast<int>(event)];
+}
+
+struct PerfSample
+{
+    uint64_t values[kPerfEventCount] = {};
+
+    uint64_t operator[](PerfEvent event) const
+    {
+        return values[static_cast<int>(event)];
+    }
+
+    PerfSample &operator+=(const PerfSample &other)
+    {
+        for (int i = 0; i < kPerfEventCount; ++i)
+        {
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+};
+
+inline PerfSample operator-(const PerfSample &a, const PerfSample &b)
+{
+    PerfSample delta;
+    for (int i = 0; i < kPerfEventCount; ++i)
+    {
+        delta.values[i] = a.values[i] - b.values[i];
+    }
+    return delta;
+}
+
+class PerfCounters
+{
+public:
+    PerfCounters()
+    {
+        for (int i = 0; i < kPerfEventCount; ++i)
+        {
+            fds[i] = open(static_cast<PerfEvent>(i));
+        }
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available(PerfEvent event) const
+    {
+        return fds[static_cast<int>(event)] >= 0;
+    }
+
+    /**
+        True when at least one hardware event could be opened.
+    */
+    bool hardwareAvailable() const
+    {
+        for (int i = static_cast<int>(PerfEvent::Cycles); i < kPerfEventCount; ++i)
+        {
+            if (fds[i] >= 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+        Why the first unavailable event failed to open, empty when everything opened.
+    */
+    const std::string &unavailableReason() const
+    {
+        return reason;
+    }
+
+    /**
+        Cumulative counts since construction, scaled for multiplexing. Unavailable events read 0.
+    */
+    PerfSample read() const
+    {
+        PerfSample sample;
+#ifdef __linux__
+        for (int i = 0; i < kPerfEventCount; ++i)
+        {
+            uint64_t data[3]; // value, time enabled, time running
+            if (fds[i] < 0 || ::read(fds[i], data, sizeof(data)) != sizeof(data))
+            {
+                continue;
+            }
+            sample.values[i] = (data[2] == 0 || data[2] == data[1])
+                                   ? data[0]
+                                   : static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+        }
+#endif
+        return sample;
+    }
+
+private:
+    int fds[kPerfEventCount];
+    std::string reason;
+
+    int open(PerfEvent event)
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        const uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        switch (event)
+        {
+        case PerfEvent::TaskClock:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+            break;
+        case PerfEvent::LLCMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | read_miss;
+            break;
+        case PerfEvent::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            return -1;
+        }
+
+        int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd < 0 && reason.empty())
+        {
+            reason = std::string(perfEventName(event)) + ": " + std::strerror(errno);
+        }
+        return fd;
+#else
+        if (reason.empty())
+        {
+            reason = "perf_event_open is Linux only";
+        }
+        return -1;
+#endif
+    }
+};
+
+/**
+    Attributes counter deltas to pipeline phases. enter() closes the current phase and opens the next
+    one, costing one read() per available event; stop() closes the current phase.
+*/
+class PhaseCounters
+{
+public:
+    void enter(SolvePhase phase)
+    {
+        PerfSample now = counters.read();
+        if (running)
+        {
+            totals[static_cast<int>(current)] += now - last;
+        }
+        last = now;
+        current = phase;
+        running = true;
+    }
+
+    void stop()
+    {
+        if (running)
+        {
+            totals[static_cast<int>(current)] += counters.read() - last;
+            running = false;
+        }
+    }
+
+    const PerfCounters &perf() const
+    {
+        return counters;
+    }
+
+    const PerfSample &total(SolvePhase phase) const
+    {
+        return totals[static_cast<int>(phase)];
+    }
+
+    /**
+        One line per phase with raw counts, IPC, and misses per thousand instructions (MPKI).
+    */
+    void report(std::ostream &output) const
+    {
+        if (!counters.hardwareAvailable())
+        {
+            output << "hardware counters unavailable (" << counters.unavailableReason() << "), reporting the remaining counters only\n";
+        }
+        for (int p = 0; p < kSolvePhaseCount; ++p)
+        {
+            const PerfSample &sample = totals[p];
+            output << solvePhaseName(static_cast<SolvePhase>(p));
+            for (int e = 0; e < kPerfEventCount; ++e)
+            {
+                if (counters.available(static_cast<PerfEvent>(e)))
+                {
+                    output << " " << perfEventName(static_cast<PerfEvent>(e)) << "=" << sample.values[e];
+                }
+            }
+            uint64_t instructions = sample[PerfEvent::Instructions];
+            if (counters.available(PerfEvent::Cycles) && counters.available(PerfEvent::Instructions) && sample[PerfEvent::Cycles] > 0)
+            {
+                output << " ipc=" << static_cast<double>(instructions) / sample[PerfEvent::Cycles];
+            }
+            if (counters.available(PerfEvent::Instructions) && instructions > 0)
+            {
+                for (PerfEvent miss : {PerfEvent::L1DMisses, PerfEvent::LLCMisses, PerfEvent::BranchMisses})
+                {
+                    if (counters.available(miss))
+                    {
+                        output << " " << perfEventName(miss) << "_pki=" << 1000.0 * sample[miss] / instructions;
+                    }
+                }
+            }
+            output << "\n";
+        }
+    }
+
+private:
+    PerfCounters counters;
+    PerfSample totals[kSolvePhaseCount];
+    PerfSample last;
+    SolvePhase current = SolvePhase::Parse;
+    bool running = false;
+};
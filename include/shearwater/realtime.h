@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "optimizer.h"
+
+/**
+    Real-time mode: trades memory and setup time for a flat latency tail. prepare(), called on the
+    thread that will solve, does everything that could stall a solve up front:
+
+        - reserves and prefaults the Optimizer workspace for max_waypoints (Optimizer::reserve())
+        - prefaults stack_bytes of the calling thread's stack
+        - locks all current and future pages of the process in RAM (mlockall)
+        - pins the calling thread to cpu, and optionally moves it to SCHED_FIFO at priority
+
+    Afterwards solve() on a course of at most max_waypoints waypoints runs Optimizer::findLowestTime()
+    with no allocation, no page fault and no syscall, provided the build keeps statistics, tracing
+    and phase counters off (their defaults). Larger courses are refused rather than solved with a
+    stall.
+
+    Locking, pinning and SCHED_FIFO need privileges or limits (RLIMIT_MEMLOCK, CAP_IPC_LOCK,
+    CAP_SYS_NICE) that containers often withhold. Each step is attempted independently; status()
+    says which took effect and why the others did not.
+*/
+struct RealtimeOptions
+{
+    int max_waypoints = 1000;
+    int cpu = -1;            // CPU to pin the solving thread to; -1 keeps the current affinity
+    int priority = 0;        // SCHED_FIFO priority; 0 keeps the current policy
+    bool lock_memory = true; // mlockall(MCL_CURRENT | MCL_FUTURE)
+    size_t stack_bytes = 256 << 10;
+};
+
+struct RealtimeStatus
+{
+    bool memory_locked = false;
+    bool pinned = false;
+    bool fifo = false;
+    std::string problems; // one "step: reason" line per step that failed
+};
+
+class RealtimeSolver
+{
+public:
+    RealtimeStatus prepare(const RealtimeOptions &realtime_options)
+    {
+        options = realtime_options;
+        RealtimeStatus result;
+
+        optimizer.reserve(options.max_waypoints);
+        prefaultStack(options.stack_bytes);
+
+        if (options.lock_memory)
+        {
+            result.memory_locked = ::mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+            if (!result.memory_locked)
+            {
+                result.problems += std::string("mlockall: ") + std::strerror(errno) + "\n";
+            }
+        }
+        if (options.cpu >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(options.cpu, &cpus);
+            int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+            result.pinned = error == 0;
+            if (!result.pinned)
+            {
+                result.problems += "pin to cpu " + std::to_string(options.cpu) + ": " + std::strerror(error) + "\n";
+            }
+        }
+        if (options.priority > 0)
+        {
+            sched_param param = {};
+            param.sched_priority = options.priority;
+            int error = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param);
+            result.fifo = error == 0;
+            if (!result.fifo)
+            {
+                result.problems += "SCHED_FIFO: " + std::string(std::strerror(error)) + "\n";
+            }
+        }
+
+        // One solve at the maximum size warms the code path and any lazily bound symbols.
+        std::vector<Waypoint> warmup(options.max_waypoints + 2, Waypoint{50, 50, 1});
+        warmup.front() = StandardCostModel::start();
+        warmup.back() = StandardCostModel::finish();
+        optimizer.findLowestTime(warmup);
+
+        prepared = true;
+        last_status = result;
+        return result;
+    }
+
+    const RealtimeStatus &status() const
+    {
+        return last_status;
+    }
+
+    /**
+        Solves a framed course. Returns false, without solving, before prepare() or when the course
+        has more than max_waypoints waypoints.
+    */
+    bool solve(const std::vector<Waypoint> &waypoints, double &answer)
+    {
+        if (!prepared || waypoints.size() > static_cast<size_t>(options.max_waypoints) + 2)
+        {
+            return false;
+        }
+        answer = optimizer.findLowestTime(waypoints);
+        return true;
+    }
+
+    const Optimizer &solver() const
+    {
+        return optimizer;
+    }
+
+private:
+    Optimizer optimizer;
+    RealtimeOptions options;
+    RealtimeStatus last_status;
+    bool prepared = false;
+
+    // Touches the stack pages below the caller's frame so deep calls later find them mapped.
+    __attribute__((noinline)) static void prefaultStack(size_t bytes)
+    {
+        volatile char *stack = static_cast<volatile char *>(__builtin_alloca(bytes));
+        for (size_t i = 0; i < bytes; i += 4096)
+        {
+            stack[i] = 0;
+        }
+    }
+};
+
+/**
+    Minor and major page faults of the calling thread so far, for checking that a region faulted none.
+*/
+inline long threadPageFaults()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_minflt + usage.ru_majflt;
+}
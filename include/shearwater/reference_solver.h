@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "optimizer.h"
+
+/**
+    Reference answer for a course, used to produce the expected outputs of generated inputs and to
+    cross-check faster engines. It is the textbook O(N^2) dynamic programme written for obviousness
+    rather than speed:
+
+        best[0] = 0
+        best[j] = min over i < j of best[i] + |w_i w_j| / speed + stop + sum of penalties of w_i+1 .. w_j-1
+
+    with the speed and stop time of the cost model (cost_model.h), 2 m/s and 10 s as standard.
+    The answer is best[n - 1]. No pruning, no heuristics; every leg is evaluated.
+*/
+template <typename CostModel = StandardCostModel>
+inline double referenceLowestTime(const std::vector<Waypoint> &waypoints, const CostModel &model = CostModel())
+{
+    const int n = waypoints.size();
+    if (n == 0)
+    {
+        return 0.0;
+    }
+
+    std::vector<double> best(n, std::numeric_limits<double>::infinity());
+    best[0] = 0.0;
+    for (int j = 1; j < n; ++j)
+    {
+        double skipped = 0.0; // Penalties of waypoints strictly between i and j
+        for (int i = j - 1; i >= 0; --i)
+        {
+            double dx = waypoints[j].x - waypoints[i].x;
+            double dy = waypoints[j].y - waypoints[i].y;
+            double cost = best[i] + std::sqrt(dx * dx + dy * dy) / model.speed() + model.stopSeconds() + skipped;
+            if (cost < best[j])
+            {
+                best[j] = cost;
+            }
+            skipped += waypoints[i].penalty;
+        }
+    }
+    return best[n - 1];
+}
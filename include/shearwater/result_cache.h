@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "optimizer.h"
+
+static_assert(sizeof(Waypoint) == 3 * sizeof(int), "waypoints are hashed and compared as packed bytes");
+
+/**
+    64-bit hash of a packed waypoint array. Eight independent lanes each take one word of every
+    64-byte stripe through a multiply and xor-shift, so the multiplies pipeline instead of chaining;
+    a lane is order-dependent, so swapped waypoints hash differently. Lanes, tail and length are
+    mixed at the end. Fast and well distributed, not cryptographic: the cache verifies every hit.
+    A nonzero seed gives an independent hash of the same bytes.
+*/
+inline uint64_t hashWaypoints(const Waypoint *waypoints, size_t count, uint64_t seed = 0)
+{
+    constexpr uint64_t kMultiplier = 0x9e3779b185ebca87ull;
+    auto read64 = [](const unsigned char *p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    };
+    auto mix = [](uint64_t lane, uint64_t data)
+    {
+        lane = (lane ^ data) * kMultiplier;
+        return lane ^ (lane >> 29);
+    };
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(waypoints);
+    size_t bytes = count * sizeof(Waypoint);
+    uint64_t lanes[8] = {0x243f6a8885a308d3ull, 0x13198a2e03707344ull, 0xa4093822299f31d0ull, 0x082efa98ec4e6c89ull,
+                         0x452821e638d01377ull, 0xbe5466cf34e90c6cull, 0xc0ac29b7c97c50ddull, 0x3f84d5b5b5470917ull};
+    for (uint64_t &lane : lanes)
+    {
+        lane ^= seed;
+    }
+    for (; bytes >= 64; bytes -= 64, p += 64)
+    {
+#pragma GCC unroll 8
+        for (int i = 0; i < 8; ++i)
+        {
+            lanes[i] = mix(lanes[i], read64(p + 8 * i));
+        }
+    }
+    for (int i = 0; bytes >= 8; bytes -= 8, p += 8, ++i)
+    {
+        lanes[i] = mix(lanes[i], read64(p));
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, bytes);
+
+    uint64_t h = mix(count * sizeof(Waypoint) ^ seed, tail);
+    for (uint64_t lane : lanes)
+    {
+        h = mix(h, lane);
+    }
+    return mix(h, h >> 32);
+}
+
+struct ResultCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t collisions = 0; // hash matched but the course differed; counted as misses too
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+};
+
+/**
+    Memoizes findLowestTime() for repeated courses. Entries are keyed by hashWaypoints() over the
+    whole framed course, and every hit is verified by comparing the stored waypoints, so a hash
+    collision costs a miss, never a wrong answer. The least recently used entries are evicted to keep
+    the estimated footprint (waypoints, path, node and index overhead) under max_bytes.
+
+    A hit costs a hash and a compare over the course, both linear in N, and allocates nothing. Not
+    thread-safe: give each solving thread its own cache, as with Optimizer.
+*/
+class ResultCache
+{
+public:
+    explicit ResultCache(size_t max_bytes, bool store_paths = false) : max_bytes(max_bytes), store_paths(store_paths) {}
+
+    /**
+        Answer for a framed course, from the cache or from optimizer, which then fills the cache.
+    */
+    double findLowestTime(Optimizer &optimizer, const std::vector<Waypoint> &waypoints)
+    {
+        double answer;
+        if (lookup(waypoints, answer))
+        {
+            return answer;
+        }
+        answer = optimizer.findLowestTime(waypoints);
+        insert(waypoints, answer, optimizer.optimalPath());
+        return answer;
+    }
+
+    /**
+        On a hit sets answer and, when paths are stored, path (valid until the next insert), and
+        marks the entry most recently used.
+    */
+    bool lookup(const std::vector<Waypoint> &waypoints, double &answer, const std::vector<int> **path = nullptr)
+    {
+        auto found = index.find(hashWaypoints(waypoints.data(), waypoints.size()));
+        if (found == index.end())
+        {
+            ++counters.misses;
+            return false;
+        }
+        Entry &entry = *found->second;
+        if (entry.waypoints.size() != waypoints.size() ||
+            std::memcmp(entry.waypoints.data(), waypoints.data(), waypoints.size() * sizeof(Waypoint)) != 0)
+        {
+            ++counters.misses;
+            ++counters.collisions;
+            return false;
+        }
+        ++counters.hits;
+        entries.splice(entries.begin(), entries, found->second);
+        answer = entry.answer;
+        if (path)
+        {
+            *path = store_paths ? &entry.path : nullptr;
+        }
+        return true;
+    }
+
+    /**
+        Stores a result, replacing any entry with the same hash. Courses larger than the whole
+        budget are not stored.
+    */
+    void insert(const std::vector<Waypoint> &waypoints, double answer, const std::vector<int> &path)
+    {
+        const uint64_t hash = hashWaypoints(waypoints.data(), waypoints.size());
+        const size_t bytes = footprint(waypoints.size(), store_paths ? path.size() : 0);
+        if (bytes > max_bytes)
+        {
+            return;
+        }
+        auto found = index.find(hash);
+        if (found != index.end())
+        {
+            erase(found->second);
+        }
+        while (used_bytes + bytes > max_bytes && !entries.empty())
+        {
+            erase(std::prev(entries.end()));
+            ++counters.evictions;
+        }
+        entries.push_front(Entry{hash, waypoints, answer, store_paths ? path : std::vector<int>(), bytes});
+        index[hash] = entries.begin();
+        used_bytes += bytes;
+    }
+
+    ResultCacheStats stats() const
+    {
+        ResultCacheStats result = counters;
+        result.entries = entries.size();
+        result.bytes = used_bytes;
+        return result;
+    }
+
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+        used_bytes = 0;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        std::vector<Waypoint> waypoints;
+        double answer;
+        std::vector<int> path;
+        size_t bytes;
+    };
+
+    size_t max_bytes;
+    bool store_paths;
+    size_t used_bytes = 0;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    ResultCacheStats counters;
+
+    // List node and index node (payload plus two pointers each) and the two arrays.
+    static size_t footprint(size_t waypoints, size_t path)
+    {
+        return sizeof(Entry) + 2 * sizeof(void *) + sizeof(std::pair<uint64_t, void *>) + 2 * sizeof(void *) +
+               waypoints * sizeof(Waypoint) + path * sizeof(int);
+    }
+
+    void erase(std::list<Entry>::iterator entry)
+    {
+        used_bytes -= entry->bytes;
+        index.erase(entry->hash);
+        entries.erase(entry);
+    }
+};
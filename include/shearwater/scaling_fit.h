@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+/**
+    Least-squares fit of y = c * x^k on log-log axes. exponent is k, the empirical complexity class
+    (1 for linear, 2 for quadratic); r_squared says how well a single power law explains the points.
+*/
+struct ScalingFit
+{
+    double exponent = 0.0;
+    double r_squared = 0.0;
+};
+
+inline ScalingFit fitPowerLaw(const std::vector<double> &x, const std::vector<double> &y)
+{
+    ScalingFit fit;
+    const size_t n = x.size() < y.size() ? x.size() : y.size();
+    if (n < 2)
+    {
+        return fit;
+    }
+
+    double mean_x = 0.0, mean_y = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        mean_x += std::log(x[i]);
+        mean_y += std::log(y[i]);
+    }
+    mean_x /= n;
+    mean_y /= n;
+
+    double sxx = 0.0, sxy = 0.0, syy = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double dx = std::log(x[i]) - mean_x;
+        double dy = std::log(y[i]) - mean_y;
+        sxx += dx * dx;
+        sxy += dx * dy;
+        syy += dy * dy;
+    }
+    if (sxx == 0.0)
+    {
+        return fit;
+    }
+    fit.exponent = sxy / sxx;
+    fit.r_squared = syy == 0.0 ? 1.0 : (sxy * sxy) / (sxx * syy);
+    return fit;
+}
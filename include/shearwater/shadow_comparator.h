@@ -0,0 +1,278 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "course_io.h"
+#include "latency_histogram.h"
+#include "optimizer.h"
+#include "reference_solver.h"
+#include "result_cache.h"
+#include "solver_engine.h"
+
+/**
+    A candidate engine run in shadow: the answer it gives for a framed course.
+*/
+using ShadowEngine = std::function<double(const std::vector<Waypoint> &)>;
+
+/**
+    The candidate engines available in this tree by name: "reference" (reference_solver.h), the
+    Optimizer memory strategies "full", "compact", "reconstruct" and "score_only" (memory_plan.h)
+    and the engines of solver_engine.h ("search", "dense", "windowed", "simd_batch",
+    "approximate").
+*/
+inline bool shadowEngineByName(const std::string &name, ShadowEngine &engine)
+{
+    if (name == "reference")
+    {
+        engine = [](const std::vector<Waypoint> &waypoints)
+        {
+            return referenceLowestTime(waypoints);
+        };
+        return true;
+    }
+    for (int s = 0; s < kMemoryStrategyCount; ++s)
+    {
+        if (name == memoryStrategyName(static_cast<MemoryStrategy>(s)))
+        {
+            auto optimizer = std::make_shared<Optimizer>();
+            optimizer->forceStrategy(static_cast<MemoryStrategy>(s)); // "full" is the heap search, whatever the tuned crossover
+            engine = [optimizer](const std::vector<Waypoint> &waypoints)
+            {
+                return optimizer->findLowestTime(waypoints);
+            };
+            return true;
+        }
+    }
+    if (std::shared_ptr<SolverEngine> registered = makeEngine(name))
+    {
+        engine = [registered](const std::vector<Waypoint> &waypoints)
+        {
+            return registered->solve(waypoints);
+        };
+        return true;
+    }
+    return false;
+}
+
+struct ShadowOptions
+{
+    double sample_rate = 0.01;  // fraction of courses also solved by the candidate
+    double tolerance = 1e-6;    // largest answer difference that is not a mismatch
+    size_t queue_capacity = 64; // sampled courses waiting for the shadow thread; more are dropped
+};
+
+struct ShadowCounters
+{
+    uint64_t offered = 0;
+    uint64_t sampled = 0;
+    uint64_t dropped = 0; // sampled while the queue was full or busy
+    uint64_t compared = 0;
+    uint64_t mismatches = 0;
+};
+
+/**
+    Runs a candidate engine next to the production solver on a sample of courses and compares the
+    answers and latencies, so an engine can be trusted before it takes over.
+
+    offer() is the only call on the critical path. It decides by course hash, so a given course is
+    always sampled or never, and a fraction sample_rate of distinct courses is. Only a sampled course is
+    copied, into a bounded queue, under a try-lock: when the queue is full or contended the sample
+    is dropped rather than waited for. The candidate runs on one background thread at SCHED_IDLE
+    where the host allows it, so the overhead stays proportional to the sample rate and off the
+    solving threads.
+
+    Each mismatch is written to the log as a '#' line with both answers and latencies followed by
+    the course in the challenge input format; drop the '#' lines to replay the courses.
+*/
+class ShadowComparator
+{
+public:
+    ShadowComparator(ShadowEngine candidate, ShadowOptions options = ShadowOptions(), std::ostream *mismatch_log = nullptr)
+        : candidate(std::move(candidate)), options(options), log(mismatch_log)
+    {
+        threshold = options.sample_rate >= 1.0 ? UINT64_MAX
+                    : options.sample_rate <= 0 ? 0
+                                               : static_cast<uint64_t>(options.sample_rate * 18446744073709551616.0);
+        worker = std::thread([this]
+                             { run(); });
+        sched_param param = {};
+        pthread_setschedparam(worker.native_handle(), SCHED_IDLE, &param); // best effort
+    }
+
+    ~ShadowComparator()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    ShadowComparator(const ShadowComparator &) = delete;
+    ShadowComparator &operator=(const ShadowComparator &) = delete;
+
+    /**
+        Hands a production answer over for comparison; cheap unless the course is sampled.
+        Thread-safe.
+    */
+    void offer(size_t course_id, const std::vector<Waypoint> &waypoints, double answer, uint64_t ns)
+    {
+        offered.fetch_add(1, std::memory_order_relaxed);
+        if (threshold == 0 || hashWaypoints(waypoints.data(), waypoints.size(), kSampleSeed) > threshold)
+        {
+            return;
+        }
+        sampled.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+        if (!lock.owns_lock() || queue.size() >= options.queue_capacity || stopping)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        queue.push_back(Job{course_id, waypoints, answer, ns});
+        lock.unlock();
+        wake.notify_one();
+    }
+
+    /**
+        Waits until every queued sample has been compared.
+    */
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]
+                  { return queue.empty() && !busy; });
+    }
+
+    ShadowCounters counters() const
+    {
+        ShadowCounters result;
+        result.offered = offered.load(std::memory_order_relaxed);
+        result.sampled = sampled.load(std::memory_order_relaxed);
+        result.dropped = dropped.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        result.compared = compared;
+        result.mismatches = mismatches;
+        return result;
+    }
+
+    /**
+        Counters and the production (wall) and candidate (CPU) latency percentiles over the compared
+        courses.
+    */
+    void report(std::ostream &output) const
+    {
+        ShadowCounters totals = counters();
+        output << "shadow: offered=" << totals.offered << " sampled=" << totals.sampled << " dropped=" << totals.dropped
+               << " compared=" << totals.compared << " mismatches=" << totals.mismatches << "\n";
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &[name, histogram] : {std::make_pair("primary", &primary_latency), std::make_pair("shadow", &shadow_latency)})
+        {
+            output << "shadow " << name << " p50=" << histogram->percentile(50) << "ns p99=" << histogram->percentile(99)
+                   << "ns max=" << histogram->max() << "ns mean=" << static_cast<uint64_t>(histogram->mean()) << "ns\n";
+        }
+    }
+
+private:
+    struct Job
+    {
+        size_t course_id;
+        std::vector<Waypoint> waypoints;
+        double answer;
+        uint64_t ns;
+    };
+
+    static constexpr uint64_t kSampleSeed = 0x2545f4914f6cdd1dull;
+
+    ShadowEngine candidate;
+    ShadowOptions options;
+    std::ostream *log;
+    uint64_t threshold;
+    std::atomic<uint64_t> offered{0};
+    std::atomic<uint64_t> sampled{0};
+    std::atomic<uint64_t> dropped{0};
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Job> queue;
+    bool busy = false;
+    bool stopping = false;
+    uint64_t compared = 0;
+    uint64_t mismatches = 0;
+    LatencyHistogram primary_latency;
+    LatencyHistogram shadow_latency;
+    std::thread worker;
+
+    // The candidate is timed in thread CPU time: at SCHED_IDLE its wall time mostly measures
+    // waiting for the solving threads.
+    static uint64_t threadCpuNs()
+    {
+        timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this]
+                      { return stopping || !queue.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            Job job = std::move(queue.front());
+            queue.pop_front();
+            busy = true;
+            lock.unlock();
+
+            uint64_t start = threadCpuNs();
+            double answer = candidate(job.waypoints);
+            uint64_t ns = threadCpuNs() - start;
+            bool mismatch = !(std::fabs(answer - job.answer) <= options.tolerance);
+            if (mismatch && log)
+            {
+                *log << "# mismatch course=" << job.course_id << " waypoints=" << job.waypoints.size() - 2 << " primary="
+                     << formatAnswer(job.answer) << " shadow=" << formatAnswer(answer) << " primary_ns=" << job.ns
+                     << " shadow_ns=" << ns << "\n";
+                *log << job.waypoints.size() - 2 << "\n";
+                for (size_t i = 1; i + 1 < job.waypoints.size(); ++i)
+                {
+                    *log << job.waypoints[i].x << " " << job.waypoints[i].y << " " << job.waypoints[i].penalty << "\n";
+                }
+                log->flush();
+            }
+
+            lock.lock();
+            busy = false;
+            ++compared;
+            mismatches += mismatch;
+            primary_latency.record(job.ns);
+            shadow_latency.record(ns);
+            if (queue.empty())
+            {
+                idle.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,485 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "optimizer.h"
+
+/**
+    Shared-memory transport between one client and one solver on the same host: a request ring of
+    variable-length course records and a response ring of (tag, answer) slots in a POSIX shared
+    memory segment. Each ring has exactly one producer and one consumer, so publishing is a single
+    store of a monotonically increasing byte count; no locks and no syscalls on the fast path.
+
+    A consumer that finds its ring empty spins briefly, yields a few times, then sleeps on a process-shared futex. The
+    producer only pays the wake syscall when the consumer has announced that it is sleeping. A
+    producer that finds its ring full yields until space appears.
+
+    The solver side create()s the segment, the client open()s it by name. Serve several clients with
+    one channel each.
+
+    Request record, 8-byte aligned: u32 N, u32 record bytes, u64 tag, then N Waypoints. A record with
+    N = kShmWrapMarker pads out the end of the ring; the next record starts at offset 0.
+*/
+constexpr uint64_t kShmChannelMagic = 0x314d48535257534eull; // "NSWRSHM1"
+constexpr uint32_t kShmChannelVersion = 1;
+constexpr uint32_t kShmWrapMarker = UINT32_MAX;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory rings need address-free atomics");
+
+struct ShmAnswer
+{
+    uint64_t tag;
+    double answer;
+};
+
+class ShmChannel
+{
+public:
+    ShmChannel() = default;
+
+    ~ShmChannel()
+    {
+        if (segment)
+        {
+            ::munmap(segment, segment_bytes);
+        }
+        if (owner)
+        {
+            ::shm_unlink(segment_name.c_str());
+        }
+    }
+
+    ShmChannel(const ShmChannel &) = delete;
+    ShmChannel &operator=(const ShmChannel &) = delete;
+
+    /**
+        Creates (or replaces) the segment named name, e.g. "/shearwater", with request_bytes of
+        request ring (rounded up to a power of two) and as many response slots as it holds minimal
+        records. The segment is unlinked when this channel is destroyed.
+    */
+    bool create(const std::string &name, size_t request_bytes = 1 << 20)
+    {
+        size_t ring = 4096;
+        while (ring < request_bytes)
+        {
+            ring <<= 1;
+        }
+        const size_t slots = ring / kMinRecordBytes;
+        ::shm_unlink(name.c_str());
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            return fail(name);
+        }
+        size_t bytes = sizeof(Header) + ring + slots * sizeof(ShmAnswer);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) < 0 || !map(fd, bytes))
+        {
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            return fail(name);
+        }
+        ::close(fd);
+        owner = true;
+        segment_name = name;
+
+        // A fresh segment is zero-filled, so every index and flag already starts at 0.
+        header->request_bytes = ring;
+        header->response_slots = slots;
+        header->version = kShmChannelVersion;
+        bind(ring, slots);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic.store(kShmChannelMagic, std::memory_order_release);
+        return true;
+    }
+
+    /**
+        Attaches to a segment made by create().
+    */
+    bool open(const std::string &name)
+    {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            return fail(name);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header) ||
+            !map(fd, static_cast<size_t>(info.st_size)))
+        {
+            ::close(fd);
+            return fail(name);
+        }
+        ::close(fd);
+        const uint64_t ring = header->request_bytes;
+        const uint64_t slots = header->response_slots;
+        const size_t space = segment_bytes - sizeof(Header);
+        if (header->magic.load(std::memory_order_acquire) != kShmChannelMagic || header->version != kShmChannelVersion ||
+            ring < 4096 || (ring & (ring - 1)) != 0 || ring > space || slots == 0 ||
+            slots > (space - ring) / sizeof(ShmAnswer))
+        {
+            last_error = name + ": not a shearwater channel";
+            return false;
+        }
+        segment_name = name;
+        bind(ring, slots);
+        return true;
+    }
+
+    const std::string &error() const
+    {
+        return last_error;
+    }
+
+    /**
+        Largest course, in waypoints between start and finish, that fits in one request record.
+    */
+    size_t maxWaypoints() const
+    {
+        return ((request_mask + 1) / 2 - kMinRecordBytes) / sizeof(Waypoint);
+    }
+
+    /**
+        True once nextRequest() has met a malformed record; the channel serves nothing more.
+    */
+    bool broken() const
+    {
+        return is_broken;
+    }
+
+    // Client side.
+
+    /**
+        Queues a framed course (as produced by readCourse()) under tag. Returns false without waiting
+        when the request ring is full, or when the course exceeds maxWaypoints().
+    */
+    bool submit(uint64_t tag, const std::vector<Waypoint> &waypoints)
+    {
+        const uint32_t n = waypoints.size() < 2 ? 0 : static_cast<uint32_t>(waypoints.size() - 2);
+        if (n > maxWaypoints())
+        {
+            return false;
+        }
+        const uint64_t size = recordBytes(n);
+        uint64_t head = header->request_head.load(std::memory_order_relaxed);
+        const uint64_t tail = header->request_tail.load(std::memory_order_acquire);
+        uint64_t offset = head & request_mask;
+        const uint64_t contiguous = request_bytes - offset;
+        const uint64_t pad = contiguous < size ? contiguous : 0;
+        if (head + pad + size - tail > request_bytes)
+        {
+            return false;
+        }
+        if (pad)
+        {
+            std::memcpy(requests + offset, &kShmWrapMarker, sizeof(kShmWrapMarker));
+            head += pad;
+            offset = 0;
+        }
+        RecordHeader record = {n, static_cast<uint32_t>(size), tag};
+        std::memcpy(requests + offset, &record, sizeof(record));
+        if (n)
+        {
+            std::memcpy(requests + offset + sizeof(record), waypoints.data() + 1, n * sizeof(Waypoint));
+        }
+        publish(header->request_head, head + size, header->request_wait);
+        return true;
+    }
+
+    /**
+        Takes the next answer if one is ready.
+    */
+    bool poll(ShmAnswer &answer)
+    {
+        const uint64_t tail = header->response_tail.load(std::memory_order_relaxed);
+        if (tail == header->response_head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        answer = responses[tail % response_slots];
+        header->response_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+        Takes the next answer, sleeping until one arrives or timeout_ns passes.
+    */
+    bool waitAnswer(ShmAnswer &answer, int64_t timeout_ns = 100000000)
+    {
+        const uint64_t tail = header->response_tail.load(std::memory_order_relaxed);
+        return waitFor(header->response_head, tail, header->response_wait, timeout_ns) && poll(answer);
+    }
+
+    /**
+        Solves courses in order, keeping the request ring full while draining answers.
+    */
+    bool solveAll(const std::vector<std::vector<Waypoint>> &courses, std::vector<double> &answers)
+    {
+        answers.assign(courses.size(), 0.0);
+        size_t sent = 0, received = 0;
+        ShmAnswer answer;
+        while (received < courses.size())
+        {
+            while (sent < courses.size() && submit(sent, courses[sent]))
+            {
+                ++sent;
+            }
+            if (sent < courses.size() && courses[sent].size() - 2 > maxWaypoints())
+            {
+                last_error = "course too large for the channel";
+                return false;
+            }
+            bool got = false;
+            while (poll(answer))
+            {
+                answers[answer.tag] = answer.answer;
+                ++received;
+                got = true;
+            }
+            if (!got && sent == courses.size() && waitAnswer(answer))
+            {
+                answers[answer.tag] = answer.answer;
+                ++received;
+            }
+            else if (!got && sent < courses.size())
+            {
+                ::sched_yield();
+            }
+        }
+        return true;
+    }
+
+    // Solver side.
+
+    /**
+        Takes the next request into waypoints (framed, capacity reused), sleeping up to timeout_ns
+        for one. Returns false on timeout, and from the first record no submit() could have written
+        on: the client can write anything into the segment, so the channel is then broken().
+    */
+    bool nextRequest(uint64_t &tag, std::vector<Waypoint> &waypoints, int64_t timeout_ns = 100000000)
+    {
+        if (is_broken)
+        {
+            return false;
+        }
+        uint64_t tail = header->request_tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (!waitFor(header->request_head, tail, header->request_wait, timeout_ns))
+            {
+                return false;
+            }
+            uint64_t offset = tail & request_mask;
+            RecordHeader record;
+            std::memcpy(&record.n, requests + offset, sizeof(record.n));
+            if (record.n == kShmWrapMarker)
+            {
+                tail += request_bytes - offset;
+                header->request_tail.store(tail, std::memory_order_release);
+                continue;
+            }
+            std::memcpy(&record, requests + offset, sizeof(record));
+            const uint64_t head = header->request_head.load(std::memory_order_acquire);
+            if (record.n > maxWaypoints() || record.bytes != recordBytes(record.n) || offset + record.bytes > request_bytes ||
+                record.bytes > head - tail)
+            {
+                is_broken = true;
+                last_error = segment_name + ": malformed request record";
+                return false;
+            }
+            waypoints.resize(record.n + 2);
+            waypoints.front() = StandardCostModel::start();
+            if (record.n)
+            {
+                std::memcpy(waypoints.data() + 1, requests + offset + sizeof(record), record.n * sizeof(Waypoint));
+            }
+            waypoints.back() = StandardCostModel::finish();
+            tag = record.tag;
+            header->request_tail.store(tail + record.bytes, std::memory_order_release);
+            return true;
+        }
+    }
+
+    /**
+        Publishes an answer, yielding while the client has not drained the response ring. Returns
+        false, dropping the answer, if stop (when given) becomes true first: a client that stops
+        draining must not hold the solver thread forever.
+    */
+    bool respond(uint64_t tag, double answer, const std::atomic<bool> *stop = nullptr)
+    {
+        const uint64_t head = header->response_head.load(std::memory_order_relaxed);
+        while (head - header->response_tail.load(std::memory_order_acquire) >= response_slots)
+        {
+            if (stop && stop->load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+            ::sched_yield();
+        }
+        responses[head % response_slots] = {tag, answer};
+        publish(header->response_head, head + 1, header->response_wait);
+        return true;
+    }
+
+    /**
+        Serves requests with optimizer until stop becomes true, checked at least every 100 ms and
+        while waiting for response space, or the channel is broken().
+    */
+    void serve(Optimizer &optimizer, const std::atomic<bool> &stop)
+    {
+        std::vector<Waypoint> course;
+        uint64_t tag;
+        while (!stop.load(std::memory_order_relaxed) && !is_broken)
+        {
+            if (nextRequest(tag, course) && !respond(tag, optimizer.findLowestTime(course), &stop))
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    static constexpr uint64_t kMinRecordBytes = 16;
+    static constexpr int kSpins = 2000;
+    static constexpr int kYields = 64;
+
+    struct RecordHeader
+    {
+        uint32_t n;
+        uint32_t bytes;
+        uint64_t tag;
+    };
+    static_assert(sizeof(RecordHeader) == kMinRecordBytes, "record header layout");
+
+    // Futex word plus the consumer's "about to sleep" flag.
+    struct Wait
+    {
+        std::atomic<uint32_t> signal;
+        std::atomic<uint32_t> sleeping;
+    };
+
+    // Indices written by different sides live on separate cache lines. The client can write all of
+    // it, so the ring sizes are only read once, into request_bytes and response_slots below.
+    struct Header
+    {
+        std::atomic<uint64_t> magic;
+        uint32_t version;
+        uint64_t request_bytes;
+        uint64_t response_slots;
+        alignas(64) std::atomic<uint64_t> request_head; // client
+        alignas(64) std::atomic<uint64_t> request_tail; // solver
+        alignas(64) std::atomic<uint64_t> response_head; // solver
+        alignas(64) std::atomic<uint64_t> response_tail; // client
+        alignas(64) Wait request_wait;
+        alignas(64) Wait response_wait;
+    };
+
+    void *segment = nullptr;
+    size_t segment_bytes = 0;
+    Header *header = nullptr;
+    char *requests = nullptr;
+    ShmAnswer *responses = nullptr;
+    uint64_t request_bytes = 0;
+    uint64_t response_slots = 0;
+    uint64_t request_mask = 0;
+    bool owner = false;
+    bool is_broken = false;
+    std::string segment_name;
+    std::string last_error;
+
+    static uint64_t recordBytes(uint32_t n)
+    {
+        return (sizeof(RecordHeader) + n * sizeof(Waypoint) + 7) & ~uint64_t(7);
+    }
+
+    bool fail(const std::string &what)
+    {
+        last_error = what + ": " + std::strerror(errno);
+        return false;
+    }
+
+    bool map(int fd, size_t bytes)
+    {
+        void *address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            return false;
+        }
+        segment = address;
+        segment_bytes = bytes;
+        header = static_cast<Header *>(address);
+        return true;
+    }
+
+    void bind(uint64_t ring, uint64_t slots)
+    {
+        request_bytes = ring;
+        response_slots = slots;
+        requests = static_cast<char *>(segment) + sizeof(Header);
+        responses = reinterpret_cast<ShmAnswer *>(requests + ring);
+        request_mask = ring - 1;
+        is_broken = false;
+    }
+
+    static long futex(std::atomic<uint32_t> &word, int op, uint32_t value, const timespec *timeout)
+    {
+        return ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), op, value, timeout, nullptr, 0);
+    }
+
+    /**
+        Producer side: publish the new head, then wake the consumer only if it said it may sleep.
+        The seq_cst store and load pair with the consumer's in waitFor(): either it sees the new
+        head, or we see its sleeping flag.
+    */
+    static void publish(std::atomic<uint64_t> &head, uint64_t value, Wait &wait)
+    {
+        head.store(value, std::memory_order_seq_cst);
+        if (wait.sleeping.load(std::memory_order_seq_cst))
+        {
+            wait.signal.fetch_add(1, std::memory_order_seq_cst);
+            futex(wait.signal, FUTEX_WAKE, INT_MAX, nullptr);
+        }
+    }
+
+    /**
+        Consumer side: true once head moves past position, false after timeout_ns.
+    */
+    static bool waitFor(const std::atomic<uint64_t> &head, uint64_t position, Wait &wait, int64_t timeout_ns)
+    {
+        for (int i = 0; i < kSpins + kYields; ++i)
+        {
+            if (head.load(std::memory_order_acquire) != position)
+            {
+                return true;
+            }
+            if (i >= kSpins)
+            {
+                ::sched_yield(); // lets a producer sharing this core run
+            }
+        }
+        timespec timeout = {static_cast<time_t>(timeout_ns / 1000000000), static_cast<long>(timeout_ns % 1000000000)};
+        uint32_t signal = wait.signal.load(std::memory_order_seq_cst);
+        wait.sleeping.store(1, std::memory_order_seq_cst);
+        if (head.load(std::memory_order_seq_cst) == position)
+        {
+            futex(wait.signal, FUTEX_WAIT, signal, &timeout);
+        }
+        wait.sleeping.store(0, std::memory_order_relaxed);
+        return head.load(std::memory_order_acquire) != position;
+    }
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+    Phases of the solve pipeline that counters and latency histograms are attributed to.
+*/
+enum class SolvePhase
+{
+    Parse,
+    Preprocess,
+    Solve,
+    Format,
+    Count
+};
+
+constexpr int kSolvePhaseCount = static_cast<int>(SolvePhase::Count);
+
+inline const char *solvePhaseName(SolvePhase phase)
+{
+    static const char *names[kSolvePhaseCount] = {"parse", "preprocess", "solve", "format"};
+    return names[static_cast<int>(phase)];
+}
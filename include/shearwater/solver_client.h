@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "solver_protocol.h"
+#include "unix_socket.h"
+
+/**
+    Client for SolverServer over the binary framing. solveAll() pipelines: it sends every request
+    before reading any answer, so the server can batch them.
+*/
+class SolverClient
+{
+public:
+    SolverClient() = default;
+
+    ~SolverClient()
+    {
+        close();
+    }
+
+    SolverClient(const SolverClient &) = delete;
+    SolverClient &operator=(const SolverClient &) = delete;
+
+    /**
+        Returns false with error() set when the daemon is not reachable.
+    */
+    bool connect(const std::string &path)
+    {
+        close();
+        fd = unixConnect(path);
+        if (fd < 0 || !sendAll(fd, kBinaryProtocolMagic, sizeof(kBinaryProtocolMagic)))
+        {
+            return fail(path);
+        }
+        return true;
+    }
+
+    const std::string &error() const
+    {
+        return last_error;
+    }
+
+    bool solve(const std::vector<Waypoint> &course, double &answer)
+    {
+        std::vector<double> answers;
+        if (!solveAll({course}, answers))
+        {
+            return false;
+        }
+        answer = answers[0];
+        return true;
+    }
+
+    /**
+        Solves framed courses (as produced by readCourse()); answers come back in order. A course
+        with no waypoints between start and finish cannot be framed (N = 0 ends a connection) and is
+        answered locally with the direct run.
+    */
+    bool solveAll(const std::vector<std::vector<Waypoint>> &courses, std::vector<double> &answers)
+    {
+        answers.assign(courses.size(), 0.0);
+        frames.clear();
+        size_t sent = 0;
+        for (size_t c = 0; c < courses.size(); ++c)
+        {
+            if (courses[c].size() > 2)
+            {
+                appendCourseFrame(frames, courses[c]);
+                ++sent;
+            }
+        }
+        if (fd < 0 || !sendAll(fd, frames.data(), frames.size()))
+        {
+            return fail("send");
+        }
+
+        frames.resize(sent * 8);
+        if (!recvAll(fd, frames.data(), frames.size()))
+        {
+            return fail("receive");
+        }
+        const char *next = frames.data();
+        for (size_t c = 0; c < courses.size(); ++c)
+        {
+            if (courses[c].size() > 2)
+            {
+                answers[c] = decodeAnswer(next);
+                next += 8;
+            }
+            else
+            {
+                answers[c] = directTime(courses[c]);
+            }
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (fd >= 0)
+        {
+            std::vector<char> end;
+            putLE32(end, 0);
+            sendAll(fd, end.data(), end.size());
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+private:
+    int fd = -1;
+    std::vector<char> frames;
+    std::string last_error;
+
+    bool fail(const std::string &what)
+    {
+        last_error = what + ": " + (errno ? std::strerror(errno) : "connection closed");
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+
+    static double directTime(const std::vector<Waypoint> &course)
+    {
+        Optimizer optimizer;
+        return optimizer.findLowestTime(course);
+    }
+};
@@ -0,0 +1,587 @@
+#pragma once
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "optimizer.h"
+#include "tuning_profile.h"
+
+/**
+    What an engine promises about its answers.
+*/
+struct EngineTraits
+{
+    bool exact = true; // the lowest time; otherwise the time of a real path, never below the lowest
+    bool path = true;  // path() holds the path of the answer
+};
+
+/**
+    One algorithm for the lowest time of a course under the standard cost model (cost_model.h).
+    Engines sit behind this interface so they can be swapped, compared under one harness
+    (tests/cpp/solver_engine_test.cpp, benchmarks/cpp/optimizer_benchmark.cpp) and picked per
+    course by EngineDispatcher. An engine keeps its workspace across calls, so it serves one thread
+    at a time.
+*/
+class SolverEngine
+{
+public:
+    virtual ~SolverEngine() = default;
+
+    virtual const char *name() const = 0;
+
+    virtual EngineTraits traits() const = 0;
+
+    virtual double solve(const std::vector<Waypoint> &waypoints) = 0;
+
+    /**
+        Waypoint indices of the last solve()'s answer, start and finish included. Empty when
+        traits().path is false.
+    */
+    virtual const std::vector<int> &path() const
+    {
+        return no_path;
+    }
+
+    /**
+        Answers for count courses, in order. Engines that gain from seeing several courses at once
+        override it.
+    */
+    virtual void solveBatch(const std::vector<Waypoint> *const *courses, size_t count, double *answers)
+    {
+        for (size_t c = 0; c < count; ++c)
+        {
+            answers[c] = solve(*courses[c]);
+        }
+    }
+
+    void solveBatch(const std::vector<std::vector<Waypoint>> &courses, double *answers)
+    {
+        std::vector<const std::vector<Waypoint> *> pointers;
+        for (const auto &course : courses)
+        {
+            pointers.push_back(&course);
+        }
+        solveBatch(pointers.data(), pointers.size(), answers);
+    }
+
+private:
+    std::vector<int> no_path;
+};
+
+/**
+    The Optimizer's label-setting search with its binary heap (optimizer.h), whatever the tuned
+    crossover says.
+*/
+class SearchEngine : public SolverEngine
+{
+public:
+    SearchEngine()
+    {
+        TuningProfile profile = tuningProfile();
+        profile.forward_min_waypoints = 0;
+        optimizer.setTuning(profile);
+    }
+
+    const char *name() const override
+    {
+        return "search";
+    }
+
+    EngineTraits traits() const override
+    {
+        return {};
+    }
+
+    double solve(const std::vector<Waypoint> &waypoints) override
+    {
+        return optimizer.findLowestTime(waypoints);
+    }
+
+    const std::vector<int> &path() const override
+    {
+        return optimizer.optimalPath();
+    }
+
+private:
+    Optimizer optimizer;
+};
+
+/**
+    The textbook dynamic programme of reference_solver.h with predecessors kept for the path: every
+    leg of the course is evaluated, O(N^2) with no pruning.
+*/
+class DenseEngine : public SolverEngine
+{
+public:
+    const char *name() const override
+    {
+        return "dense";
+    }
+
+    EngineTraits traits() const override
+    {
+        return {};
+    }
+
+    double solve(const std::vector<Waypoint> &waypoints) override
+    {
+        const int n = waypoints.size();
+        optimal_path.clear();
+        if (n == 0)
+        {
+            return 0.0;
+        }
+        best.assign(n, std::numeric_limits<double>::infinity());
+        previous.assign(n, -1);
+        best[0] = 0.0;
+        for (int j = 1; j < n; ++j)
+        {
+            double skipped = 0.0; // penalties of waypoints strictly between i and j
+            for (int i = j - 1; i >= 0; --i)
+            {
+                double dx = waypoints[j].x - waypoints[i].x;
+                double dy = waypoints[j].y - waypoints[i].y;
+                double cost = best[i] + (std::sqrt(dx * dx + dy * dy) / StandardCostModel::speed() + StandardCostModel::stopSeconds()) + skipped;
+                if (cost < best[j])
+                {
+                    best[j] = cost;
+                    previous[j] = i;
+                }
+                skipped += waypoints[i].penalty;
+            }
+        }
+        for (int i = n - 1; i >= 0; i = previous[i])
+        {
+            optimal_path.push_back(i);
+        }
+        std::reverse(optimal_path.begin(), optimal_path.end());
+        return best[n - 1];
+    }
+
+    const std::vector<int> &path() const override
+    {
+        return optimal_path;
+    }
+
+private:
+    std::vector<double> best;
+    std::vector<int> previous;
+    std::vector<int> optimal_path;
+};
+
+/**
+    The Optimizer's forward DP (the Compact strategy of memory_plan.h): relaxes in index order, each
+    waypoint only across the window its cost can still improve.
+*/
+class WindowedEngine : public SolverEngine
+{
+public:
+    WindowedEngine()
+    {
+        optimizer.forceStrategy(MemoryStrategy::Compact);
+    }
+
+    const char *name() const override
+    {
+        return "windowed";
+    }
+
+    EngineTraits traits() const override
+    {
+        return {};
+    }
+
+    double solve(const std::vector<Waypoint> &waypoints) override
+    {
+        return optimizer.findLowestTime(waypoints);
+    }
+
+    const std::vector<int> &path() const override
+    {
+        return optimizer.optimalPath();
+    }
+
+private:
+    Optimizer optimizer;
+};
+
+/**
+    The dense DP run on kLanes courses at once, one course per SIMD lane: courses are sorted by
+    size, taken kLanes at a time and interleaved, shorter ones padded at the end (legs only go
+    forward, so padding after a finish cannot change it). Each lane does the arithmetic of
+    DenseEngine, so answers are identical. On batches of small courses it is 10-25% faster than
+    DenseEngine; solve() on one course leaves the other lanes idle. No paths.
+*/
+class SimdBatchEngine : public SolverEngine
+{
+public:
+    static constexpr int kLanes = 4;
+
+    const char *name() const override
+    {
+        return "simd_batch";
+    }
+
+    EngineTraits traits() const override
+    {
+        return {true, false};
+    }
+
+    double solve(const std::vector<Waypoint> &waypoints) override
+    {
+        const std::vector<Waypoint> *course = &waypoints;
+        double answer;
+        solveLanes(&course, 1, &answer);
+        return answer;
+    }
+
+    using SolverEngine::solveBatch;
+
+    void solveBatch(const std::vector<Waypoint> *const *courses, size_t count, double *answers) override
+    {
+        order.resize(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                         { return courses[a]->size() < courses[b]->size(); });
+        for (size_t first = 0; first < order.size(); first += kLanes)
+        {
+            const int lanes = std::min<size_t>(kLanes, order.size() - first);
+            const std::vector<Waypoint> *group[kLanes];
+            double group_answers[kLanes];
+            for (int l = 0; l < lanes; ++l)
+            {
+                group[l] = courses[order[first + l]];
+            }
+            solveLanes(group, lanes, group_answers);
+            for (int l = 0; l < lanes; ++l)
+            {
+                answers[order[first + l]] = group_answers[l];
+            }
+        }
+    }
+
+private:
+    typedef double Lanes __attribute__((vector_size(kLanes * sizeof(double))));
+
+    std::vector<Lanes> xs, ys, penalties, best;
+    std::vector<size_t> order;
+
+    // In place: passing Lanes by value would depend on whether AVX is enabled.
+    static void sqrtLanes(Lanes &v)
+    {
+#if defined(__SSE2__)
+        // sqrtpd is correctly rounded, like std::sqrt.
+        __m128d halves[kLanes / 2];
+        std::memcpy(halves, &v, sizeof(v));
+        for (auto &half : halves)
+        {
+            half = _mm_sqrt_pd(half);
+        }
+        std::memcpy(&v, halves, sizeof(v));
+#else
+        for (int l = 0; l < kLanes; ++l)
+        {
+            v[l] = std::sqrt(v[l]);
+        }
+#endif
+    }
+
+    void solveLanes(const std::vector<Waypoint> *const *courses, int lanes, double *answers)
+    {
+        size_t n = 0;
+        for (int l = 0; l < lanes; ++l)
+        {
+            n = std::max(n, courses[l]->size());
+        }
+        const Lanes zero = {};
+        xs.assign(n, zero);
+        ys.assign(n, zero);
+        penalties.assign(n, zero);
+        best.assign(n, zero + std::numeric_limits<double>::infinity());
+        for (int l = 0; l < lanes; ++l)
+        {
+            for (size_t i = 0; i < courses[l]->size(); ++i)
+            {
+                const Waypoint &waypoint = (*courses[l])[i];
+                xs[i][l] = waypoint.x;
+                ys[i][l] = waypoint.y;
+                penalties[i][l] = waypoint.penalty;
+            }
+        }
+        if (n > 0)
+        {
+            best[0] = zero;
+        }
+        for (size_t j = 1; j < n; ++j)
+        {
+            Lanes lowest = best[j];
+            Lanes skipped = zero; // penalties of waypoints strictly between i and j
+            for (size_t i = j; i-- > 0;)
+            {
+                const Lanes dx = xs[j] - xs[i];
+                const Lanes dy = ys[j] - ys[i];
+                Lanes distance = dx * dx + dy * dy;
+                sqrtLanes(distance);
+                const Lanes cost = best[i] + (distance / StandardCostModel::speed() + StandardCostModel::stopSeconds()) + skipped;
+                lowest = cost < lowest ? cost : lowest;
+                skipped += penalties[i];
+            }
+            best[j] = lowest;
+        }
+        for (int l = 0; l < lanes; ++l)
+        {
+            answers[l] = courses[l]->empty() ? 0.0 : best[courses[l]->size() - 1][l];
+        }
+    }
+};
+
+/**
+    A forward DP that only flies legs skipping fewer than lookahead waypoints, O(N * lookahead)
+    whatever the penalties. The answer is the time of a real path, so never below the lowest time,
+    and is exact whenever the optimal path has no longer leg: with penalties of a few seconds and
+    more, skipping dozens of waypoints rarely pays.
+*/
+class ApproximateEngine : public SolverEngine
+{
+public:
+    static constexpr int kDefaultLookahead = 32;
+
+    explicit ApproximateEngine(int lookahead = kDefaultLookahead) : lookahead(std::clamp(lookahead, 1, TuningProfile::kMaxLegChunk)) {}
+
+    const char *name() const override
+    {
+        return "approximate";
+    }
+
+    EngineTraits traits() const override
+    {
+        return {false, true};
+    }
+
+    int lookaheadWaypoints() const
+    {
+        return lookahead;
+    }
+
+    double solve(const std::vector<Waypoint> &waypoints) override
+    {
+        const int n = waypoints.size();
+        optimal_path.clear();
+        if (n == 0)
+        {
+            return 0.0;
+        }
+        best.assign(n, std::numeric_limits<double>::infinity());
+        previous.assign(n, -1);
+        best[0] = 0.0;
+        const CpuKernels &kernels = cpuKernels();
+        double leg_times[TuningProfile::kMaxLegChunk];
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            const int end = std::min(n, i + 1 + lookahead);
+            kernels.leg_times(&waypoints[0].x, i + 1, end, waypoints[i].x, waypoints[i].y, StandardCostModel::speed(),
+                              StandardCostModel::stopSeconds(), leg_times);
+            double skipped = 0;
+            for (int j = i + 1; j < end; ++j)
+            {
+                double cost = best[i] + leg_times[j - i - 1] + skipped;
+                if (cost < best[j])
+                {
+                    best[j] = cost;
+                    previous[j] = i;
+                }
+                skipped += waypoints[j].penalty;
+            }
+        }
+        for (int i = n - 1; i >= 0; i = previous[i])
+        {
+            optimal_path.push_back(i);
+        }
+        std::reverse(optimal_path.begin(), optimal_path.end());
+        return best[n - 1];
+    }
+
+    const std::vector<int> &path() const override
+    {
+        return optimal_path;
+    }
+
+private:
+    int lookahead;
+    std::vector<double> best;
+    std::vector<int> previous;
+    std::vector<int> optimal_path;
+};
+
+struct EngineRegistration
+{
+    const char *name;
+    std::unique_ptr<SolverEngine> (*make)();
+};
+
+/**
+    Every engine by name, for tools, the shadow comparator and the dispatcher.
+*/
+inline const std::vector<EngineRegistration> &engineRegistry()
+{
+    static const std::vector<EngineRegistration> registry = {
+        {"search", []() -> std::unique_ptr<SolverEngine> { return std::make_unique<SearchEngine>(); }},
+        {"dense", []() -> std::unique_ptr<SolverEngine> { return std::make_unique<DenseEngine>(); }},
+        {"windowed", []() -> std::unique_ptr<SolverEngine> { return std::make_unique<WindowedEngine>(); }},
+        {"simd_batch", []() -> std::unique_ptr<SolverEngine> { return std::make_unique<SimdBatchEngine>(); }},
+        {"approximate", []() -> std::unique_ptr<SolverEngine> { return std::make_unique<ApproximateEngine>(); }},
+    };
+    return registry;
+}
+
+/**
+    A new engine of the given name, or nullptr if there is none.
+*/
+inline std::unique_ptr<SolverEngine> makeEngine(const std::string &name)
+{
+    for (const auto &registration : engineRegistry())
+    {
+        if (name == registration.name)
+        {
+            return registration.make();
+        }
+    }
+    return nullptr;
+}
+
+/**
+    The guarantees a caller needs from an answer.
+*/
+struct EngineRequest
+{
+    bool exact = true; // false also accepts the approximate engine
+    bool path = true;  // false also accepts engines that return no path
+};
+
+/**
+    Picks an engine per course by size and the caller's EngineRequest, and keeps one of each engine
+    it has used, so like an engine it serves one thread at a time. See select() for the rules.
+*/
+class EngineDispatcher
+{
+public:
+    /**
+        Up to this size the dense DP's short loops beat the windowed DP's window scans, and the
+        search's heap, outright; batches without paths go four lanes at a time to simd_batch.
+        Measured with benchmarks/cpp/optimizer_benchmark.cpp.
+    */
+    static constexpr int kDenseMaxWaypoints = 100;
+
+    explicit EngineDispatcher(const TuningProfile &profile = tuningProfile()) : tuning(profile) {}
+
+    /**
+        The engine for a course of the given waypoint count (start and finish not counted):
+
+        - approximate, when allowed and the course is longer than its lookahead;
+        - up to kDenseMaxWaypoints, simd_batch for batches that need no path, else dense;
+        - windowed from the tuned crossover on (TuningProfile::forward_min_waypoints);
+        - search otherwise.
+    */
+    const char *select(int waypoints, EngineRequest request, bool batch = false) const
+    {
+        if (!request.exact && waypoints > ApproximateEngine::kDefaultLookahead)
+        {
+            return "approximate";
+        }
+        if (waypoints <= kDenseMaxWaypoints)
+        {
+            return batch && !request.path ? "simd_batch" : "dense";
+        }
+        if (tuning.forward_min_waypoints > 0 && waypoints >= tuning.forward_min_waypoints)
+        {
+            return "windowed";
+        }
+        return "search";
+    }
+
+    /**
+        The dispatcher's engine of that name, made on first use; nullptr for a name not in
+        engineRegistry().
+    */
+    SolverEngine *engine(const std::string &name)
+    {
+        for (auto &engine : engines)
+        {
+            if (name == engine->name())
+            {
+                return engine.get();
+            }
+        }
+        std::unique_ptr<SolverEngine> made = makeEngine(name);
+        if (!made)
+        {
+            return nullptr;
+        }
+        engines.push_back(std::move(made));
+        return engines.back().get();
+    }
+
+    /**
+        Solves with the selected engine; its path, if any, is in engine(lastEngine())->path().
+    */
+    double solve(const std::vector<Waypoint> &waypoints, EngineRequest request = {})
+    {
+        last_engine = select(static_cast<int>(waypoints.size()) - 2, request);
+        return engine(last_engine)->solve(waypoints);
+    }
+
+    const char *lastEngine() const
+    {
+        return last_engine;
+    }
+
+    /**
+        Answers for every course, in order: courses are grouped by selected engine and each group
+        is one solveBatch() call. No paths are kept.
+    */
+    void solveBatch(const std::vector<std::vector<Waypoint>> &courses, double *answers, EngineRequest request = {})
+    {
+        for (const auto &registration : engineRegistry())
+        {
+            group.clear();
+            group_index.clear();
+            for (size_t c = 0; c < courses.size(); ++c)
+            {
+                if (std::strcmp(select(static_cast<int>(courses[c].size()) - 2, request, true), registration.name) == 0)
+                {
+                    group.push_back(&courses[c]);
+                    group_index.push_back(c);
+                }
+            }
+            if (group.empty())
+            {
+                continue;
+            }
+            group_answers.resize(group.size());
+            engine(registration.name)->solveBatch(group.data(), group.size(), group_answers.data());
+            for (size_t g = 0; g < group.size(); ++g)
+            {
+                answers[group_index[g]] = group_answers[g];
+            }
+        }
+    }
+
+private:
+    TuningProfile tuning;
+    std::vector<std::unique_ptr<SolverEngine>> engines;
+    const char *last_engine = "";
+    std::vector<const std::vector<Waypoint> *> group;
+    std::vector<size_t> group_index;
+    std::vector<double> group_answers;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "optimizer.h"
+
+/**
+    Binary framing spoken by the solver daemon next to the challenge text format. All integers are
+    little-endian.
+
+    A binary connection opens with the four bytes kBinaryProtocolMagic. Each request is then
+        u32 N, followed by N * (i32 x, i32 y, i32 penalty)
+    and is answered, in request order, by one f64 lowest time. A request with N = 0 ends the
+    connection, as the terminating 0 does in the text format. The implicit start and finish
+    waypoints are never sent.
+*/
+constexpr char kBinaryProtocolMagic[4] = {'S', 'W', 'B', '1'};
+
+// Larger requests are rejected as malformed rather than allocated.
+constexpr uint32_t kProtocolMaxWaypoints = 1 << 24;
+
+inline void putLE32(std::vector<char> &out, uint32_t value)
+{
+    for (int b = 0; b < 4; ++b)
+    {
+        out.push_back(static_cast<char>(value >> (8 * b)));
+    }
+}
+
+inline uint32_t getLE32(const char *in)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(in);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+/**
+    Appends the request frame for a framed course (as produced by readCourse()).
+*/
+inline void appendCourseFrame(std::vector<char> &out, const std::vector<Waypoint> &waypoints)
+{
+    const size_t n = waypoints.size() < 2 ? 0 : waypoints.size() - 2;
+    putLE32(out, static_cast<uint32_t>(n));
+    for (size_t i = 1; i <= n; ++i)
+    {
+        putLE32(out, static_cast<uint32_t>(waypoints[i].x));
+        putLE32(out, static_cast<uint32_t>(waypoints[i].y));
+        putLE32(out, static_cast<uint32_t>(waypoints[i].penalty));
+    }
+}
+
+/**
+    Decodes the N waypoints of a frame body into a framed course, reusing its capacity.
+*/
+inline void decodeCourseFrame(const char *body, uint32_t n, std::vector<Waypoint> &waypoints)
+{
+    waypoints.clear();
+    waypoints.reserve(n + 2);
+    waypoints.push_back(StandardCostModel::start());
+    for (uint32_t i = 0; i < n; ++i, body += 12)
+    {
+        waypoints.push_back({static_cast<int>(getLE32(body)), static_cast<int>(getLE32(body + 4)), static_cast<int>(getLE32(body + 8))});
+    }
+    waypoints.push_back(StandardCostModel::finish());
+}
+
+inline void appendAnswer(std::vector<char> &out, double answer)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &answer, sizeof(bits));
+    putLE32(out, static_cast<uint32_t>(bits));
+    putLE32(out, static_cast<uint32_t>(bits >> 32));
+}
+
+inline double decodeAnswer(const char *in)
+{
+    uint64_t bits = getLE32(in) | static_cast<uint64_t>(getLE32(in + 4)) << 32;
+    double answer;
+    std::memcpy(&answer, &bits, sizeof(answer));
+    return answer;
+}
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <istream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "batch_solver.h"
+#include "course_io.h"
+#include "solver_protocol.h"
+#include "unix_socket.h"
+
+struct SolverServerOptions
+{
+    int threads = 1;                             // BatchSolver workers
+    size_t max_batch = 64;                       // requests solved together at most
+    std::chrono::microseconds batch_window{100}; // how long a waiting request lingers for company
+    SolverMetrics *metrics = nullptr;            // updated per solve and per malformed request
+    size_t cache_bytes = 0;                      // per-worker result cache budget, 0 for none
+    ShadowComparator *shadow = nullptr;          // compares a candidate engine on sampled requests
+};
+
+struct SolverServerCounters
+{
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+    uint64_t largest_batch = 0;
+};
+
+/**
+    Resident solver service on a Unix domain socket, so a query pays neither process startup nor a
+    cold Optimizer. Each connection speaks either the challenge text format (one "%.3f" line per
+    course) or the binary framing of solver_protocol.h, told apart by its first byte.
+
+    Every connection has a reader thread, which queues requests as soon as they are parsed, and a
+    writer thread, which returns answers in request order; clients may pipeline. One batcher thread
+    drains the queue: when a request arrives it waits up to batch_window for more, up to max_batch,
+    then solves them together on a BatchSolver, whose worker threads and Optimizers stay warm across
+    batches.
+
+    run() serves until stop(). Shutdown is graceful: the socket stops accepting, open connections
+    stop reading, and every request already received is still answered.
+*/
+class SolverServer
+{
+public:
+    explicit SolverServer(SolverServerOptions options = SolverServerOptions()) : options(options)
+    {
+        if (this->options.max_batch == 0)
+        {
+            this->options.max_batch = 1;
+        }
+    }
+
+    ~SolverServer()
+    {
+        stop();
+        if (listen_fd >= 0)
+        {
+            ::close(listen_fd);
+        }
+    }
+
+    SolverServer(const SolverServer &) = delete;
+    SolverServer &operator=(const SolverServer &) = delete;
+
+    /**
+        Binds the socket. Returns false with error() set on failure.
+    */
+    bool listen(const std::string &path)
+    {
+        listen_fd = unixListen(path);
+        if (listen_fd < 0)
+        {
+            last_error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        socket_path = path;
+        return true;
+    }
+
+    const std::string &error() const
+    {
+        return last_error;
+    }
+
+    /**
+        Accepts and serves connections until stop(), then drains and returns.
+    */
+    void run()
+    {
+        std::thread batcher([this]
+                            { batchLoop(); });
+        while (!stopping.load())
+        {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                break;
+            }
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            reapConnections();
+            if (stopping.load())
+            {
+                ::close(fd);
+                break;
+            }
+            connections.push_back(std::make_unique<Connection>(*this, fd));
+            ++counter_values.connections;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            for (auto &connection : connections)
+            {
+                connection->stopReading();
+            }
+        }
+        for (auto &connection : connections)
+        {
+            connection->join();
+        }
+        connections.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            batcher_stopping = true;
+        }
+        queue_ready.notify_all();
+        batcher.join();
+        ::unlink(socket_path.c_str());
+    }
+
+    /**
+        Asks run() to finish. Safe from any thread, not from a signal handler.
+    */
+    void stop()
+    {
+        if (!stopping.exchange(true) && listen_fd >= 0)
+        {
+            ::shutdown(listen_fd, SHUT_RDWR);
+        }
+    }
+
+    SolverServerCounters counters() const
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return counter_values;
+    }
+
+private:
+    struct Request
+    {
+        std::vector<Waypoint> course;
+        std::promise<double> answer;
+    };
+
+    /**
+        One client: a reader thread queueing requests and a writer thread sending answers in order.
+        The writer closes the socket once the reader has finished and every answer is out.
+    */
+    struct Connection
+    {
+        SolverServer &server;
+        int fd;
+        bool binary = false;
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::future<double>> answers;
+        bool reading = true;
+        std::atomic<bool> finished{false};
+        std::thread reader;
+        std::thread writer;
+
+        Connection(SolverServer &server, int fd) : server(server), fd(fd)
+        {
+            reader = std::thread([this]
+                                 { read(); });
+            writer = std::thread([this]
+                                 { write(); });
+        }
+
+        void stopReading()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fd >= 0)
+            {
+                ::shutdown(fd, SHUT_RD);
+            }
+        }
+
+        void join()
+        {
+            reader.join();
+            writer.join();
+        }
+
+        void read()
+        {
+            try
+            {
+                readRequests();
+            }
+            catch (const std::exception &)
+            {
+                // Whatever a client sends costs it its own connection, never the daemon.
+                server.recordError(SolveError::MalformedRequest);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            reading = false;
+            ready.notify_one();
+        }
+
+        void readRequests()
+        {
+            char first;
+            if (recvAll(fd, &first, 1))
+            {
+                char magic[sizeof(kBinaryProtocolMagic)] = {first};
+                if (first == kBinaryProtocolMagic[0])
+                {
+                    binary = recvAll(fd, magic + 1, sizeof(magic) - 1) && std::memcmp(magic, kBinaryProtocolMagic, sizeof(magic)) == 0;
+                    if (binary)
+                    {
+                        readBinary();
+                    }
+                }
+                else
+                {
+                    readText(first);
+                }
+            }
+        }
+
+        void readText(char first)
+        {
+            SocketStreamBuf buffer(fd);
+            buffer.prime(&first, 1);
+            std::istream input(&buffer);
+            std::vector<Waypoint> course;
+            long long n;
+            while (input >> n && n != 0)
+            {
+                // Stricter than readCourse(): a course is only submitted once all of it has arrived.
+                if (n < 0 || n > kProtocolMaxWaypoints)
+                {
+                    server.recordError(SolveError::MalformedRequest);
+                    return;
+                }
+                course.clear(); // not reserved up front: the count is untrusted
+                course.push_back(StandardCostModel::start());
+                for (long long j = 0; j < n; ++j)
+                {
+                    Waypoint waypoint;
+                    if (!(input >> waypoint.x >> waypoint.y >> waypoint.penalty))
+                    {
+                        server.recordError(SolveError::MalformedRequest);
+                        return;
+                    }
+                    course.push_back(waypoint);
+                }
+                course.push_back(StandardCostModel::finish());
+                submit(std::move(course));
+            }
+            if (input.fail() && !input.eof())
+            {
+                server.recordError(SolveError::MalformedRequest);
+            }
+        }
+
+        void readBinary()
+        {
+            std::vector<char> body;
+            std::vector<Waypoint> course;
+            char header[4];
+            while (recvAll(fd, header, sizeof(header)))
+            {
+                uint32_t n = getLE32(header);
+                if (n == 0)
+                {
+                    break;
+                }
+                if (n > kProtocolMaxWaypoints || !receiveBody(body, static_cast<size_t>(n) * 12))
+                {
+                    server.recordError(SolveError::MalformedRequest);
+                    break;
+                }
+                decodeCourseFrame(body.data(), n, course);
+                submit(std::move(course));
+            }
+        }
+
+        // Receives bytes into body, growing it as they arrive rather than trusting the announced
+        // length: a short header alone must not commit the memory for a maximal course.
+        bool receiveBody(std::vector<char> &body, size_t bytes)
+        {
+            body.clear();
+            while (body.size() < bytes)
+            {
+                size_t have = body.size();
+                body.resize(std::min(bytes, std::max<size_t>(2 * have, 64 << 10)));
+                if (!recvAll(fd, body.data() + have, body.size() - have))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void submit(std::vector<Waypoint> &&course)
+        {
+            std::future<double> answer = server.enqueue(std::move(course));
+            std::lock_guard<std::mutex> lock(mutex);
+            answers.push_back(std::move(answer));
+            ready.notify_one();
+        }
+
+        void write()
+        {
+            SocketStreamBuf buffer(fd);
+            std::ostream text(&buffer);
+            std::vector<char> frames;
+            bool ok = true;
+            for (;;)
+            {
+                std::future<double> answer;
+                bool more;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [this]
+                               { return !answers.empty() || !reading; });
+                    if (answers.empty())
+                    {
+                        break;
+                    }
+                    answer = std::move(answers.front());
+                    answers.pop_front();
+                    more = !answers.empty();
+                }
+                double value = answer.get();
+                if (!ok)
+                {
+                    continue; // peer gone: keep draining so the batcher never blocks on us
+                }
+                if (binary)
+                {
+                    appendAnswer(frames, value);
+                    if (!more)
+                    {
+                        ok = sendAll(fd, frames.data(), frames.size());
+                        frames.clear();
+                    }
+                }
+                else
+                {
+                    text << formatAnswer(value) << "\n";
+                    if (!more)
+                    {
+                        ok = static_cast<bool>(text.flush());
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            ::close(fd);
+            fd = -1; // the number may be reused at once; stopReading() must not touch it
+            finished = true;
+        }
+    };
+
+    SolverServerOptions options;
+    int listen_fd = -1;
+    std::string socket_path;
+    std::string last_error;
+    std::atomic<bool> stopping{false};
+
+    std::mutex connections_mutex;
+    std::list<std::unique_ptr<Connection>> connections;
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::deque<Request> queue;
+    bool batcher_stopping = false;
+    SolverServerCounters counter_values;
+
+    // Joins connections whose client has gone. Caller holds connections_mutex.
+    void reapConnections()
+    {
+        for (auto it = connections.begin(); it != connections.end();)
+        {
+            if ((*it)->finished.load())
+            {
+                (*it)->join();
+                it = connections.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void recordError(SolveError error)
+    {
+        if (options.metrics)
+        {
+            options.metrics->recordError(error);
+        }
+    }
+
+    std::future<double> enqueue(std::vector<Waypoint> &&course)
+    {
+        Request request{std::move(course), std::promise<double>()};
+        std::future<double> answer = request.answer.get_future();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push_back(std::move(request));
+        }
+        queue_ready.notify_one();
+        return answer;
+    }
+
+    void batchLoop()
+    {
+        BatchSolver solver(options.threads);
+        solver.setMetrics(options.metrics);
+        solver.enableCache(options.cache_bytes);
+        solver.setShadow(options.shadow);
+        std::vector<Request> batch;
+        std::vector<std::vector<Waypoint>> courses;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_ready.wait(lock, [this]
+                                 { return batcher_stopping || !queue.empty(); });
+                if (queue.empty())
+                {
+                    return;
+                }
+                if (queue.size() < options.max_batch && !batcher_stopping)
+                {
+                    queue_ready.wait_for(lock, options.batch_window, [this]
+                                         { return batcher_stopping || queue.size() >= options.max_batch; });
+                }
+                size_t take = std::min(queue.size(), options.max_batch);
+                for (size_t i = 0; i < take; ++i)
+                {
+                    batch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+                counter_values.requests += take;
+                ++counter_values.batches;
+                counter_values.largest_batch = std::max<uint64_t>(counter_values.largest_batch, take);
+            }
+
+            courses.resize(batch.size());
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                courses[i].swap(batch[i].course);
+            }
+            std::vector<double> answers = solver.solve(courses);
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                batch[i].answer.set_value(answers[i]);
+            }
+            batch.clear();
+        }
+    }
+};
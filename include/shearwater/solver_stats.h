@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+    Hot-path counters for Optimizer. They are compiled in only when SHEARWATER_STATS is defined
+    (e.g. -DSHEARWATER_STATS); otherwise every SHEARWATER_STAT(...) statement expands to nothing and
+    the counters stay zero.
+*/
+#ifdef SHEARWATER_STATS
+constexpr bool kSolverStatsEnabled = true;
+#define SHEARWATER_STAT(...) __VA_ARGS__
+#else
+constexpr bool kSolverStatsEnabled = false;
+#define SHEARWATER_STAT(...)
+#endif
+
+struct SolverStats
+{
+    uint64_t heap_pushes = 0;
+    uint64_t heap_pops = 0;
+    uint64_t stale_pops = 0;         // pops skipped because the waypoint was already visited
+    uint64_t expansions = 0;         // waypoints whose successors were scanned
+    uint64_t relaxations = 0;        // legs whose cost was evaluated
+    uint64_t relaxations_pruned = 0; // legs never evaluated because the skip penalty alone was too high
+    uint64_t window_total = 0;       // sum over expansions of successors scanned
+    uint64_t window_max = 0;         // widest successor scan of any expansion
+    uint64_t setup_ns = 0;           // prefix sums and workspace initialisation
+    uint64_t search_ns = 0;          // label-setting search
+    uint64_t path_ns = 0;            // path reconstruction and total time
+
+    double meanWindow() const
+    {
+        return expansions == 0 ? 0.0 : static_cast<double>(window_total) / expansions;
+    }
+
+    /**
+        Calls f(name, value) for every exported field, in a fixed order shared by the JSON and CSV
+        writers.
+    */
+    template <typename F>
+    void forEachField(F &&f) const
+    {
+        f("heap_pushes", static_cast<double>(heap_pushes));
+        f("heap_pops", static_cast<double>(heap_pops));
+        f("stale_pops", static_cast<double>(stale_pops));
+        f("expansions", static_cast<double>(expansions));
+        f("relaxations", static_cast<double>(relaxations));
+        f("relaxations_pruned", static_cast<double>(relaxations_pruned));
+        f("window_mean", meanWindow());
+        f("window_max", static_cast<double>(window_max));
+        f("setup_ns", static_cast<double>(setup_ns));
+        f("search_ns", static_cast<double>(search_ns));
+        f("path_ns", static_cast<double>(path_ns));
+    }
+};
+
+inline uint64_t statsNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+    One JSON object per course, on its own line (JSON Lines).
+*/
+inline void writeStatsJson(std::ostream &output, size_t course, size_t waypoints, const SolverStats &stats)
+{
+    auto precision = output.precision(15); // counters print as integers, not in exponent form
+    output << "{\"course\":" << course << ",\"waypoints\":" << waypoints;
+    stats.forEachField([&](const char *name, double value)
+                       { output << ",\"" << name << "\":" << value; });
+    output << "}\n";
+    output.precision(precision);
+}
+
+inline void writeStatsCsvHeader(std::ostream &output)
+{
+    output << "course,waypoints";
+    SolverStats().forEachField([&](const char *name, double)
+                               { output << "," << name; });
+    output << "\n";
+}
+
+inline void writeStatsCsvRow(std::ostream &output, size_t course, size_t waypoints, const SolverStats &stats)
+{
+    auto precision = output.precision(15);
+    output << course << "," << waypoints;
+    stats.forEachField([&](const char *, double value)
+                       { output << "," << value; });
+    output << "\n";
+    output.precision(precision);
+}
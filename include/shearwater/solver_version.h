@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+    Version stamps of persisted answers (include/shearwater/disk_cache.h) and tuning profiles
+    (include/shearwater/tuning_profile.h). Bump kSolverVersion when answers, optimal paths or the
+    engine's performance trade-offs may change, kCostModelVersion when the speed, the stop time or the
+    course frame does.
+*/
+constexpr uint32_t kSolverVersion = 1;
+constexpr uint32_t kCostModelVersion = 1;
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+    Compile-time levelled tracing into per-thread ring buffers, dumped as Chrome trace JSON (load it
+    in chrome://tracing or ui.perfetto.dev).
+
+    SHEARWATER_TRACE_LEVEL selects what is compiled in:
+        0  nothing (default); every macro below expands to nothing
+        1  phase spans: parse, each findLowestTime() call, format
+        2  detail: instant events inside the search loop
+
+    Recording is a timestamp and a store into the calling thread's buffer; no locks, no allocation
+    after the buffer exists. When a buffer is full the oldest events are overwritten.
+*/
+#ifndef SHEARWATER_TRACE_LEVEL
+#define SHEARWATER_TRACE_LEVEL 0
+#endif
+
+constexpr int kTraceLevel = SHEARWATER_TRACE_LEVEL;
+
+#define SHEARWATER_TRACE_CONCAT_INNER(a, b) a##b
+#define SHEARWATER_TRACE_CONCAT(a, b) SHEARWATER_TRACE_CONCAT_INNER(a, b)
+
+#if SHEARWATER_TRACE_LEVEL >= 1
+#define SHEARWATER_TRACE_SPAN(name, arg) TraceSpan SHEARWATER_TRACE_CONCAT(trace_span_, __LINE__)(name, arg)
+#else
+#define SHEARWATER_TRACE_SPAN(name, arg)
+#endif
+
+#if SHEARWATER_TRACE_LEVEL >= 2
+#define SHEARWATER_TRACE_EVENT(name, arg) TraceRecorder::instance().local().instant(name, arg)
+#else
+#define SHEARWATER_TRACE_EVENT(name, arg)
+#endif
+
+struct TraceEvent
+{
+    const char *name; // must point to a string literal
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int64_t arg;
+    bool instant;
+};
+
+inline uint64_t traceNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class TraceBuffer
+{
+public:
+    TraceBuffer(int tid, size_t capacity) : tid(tid), events(capacity) {}
+
+    void complete(const char *name, uint64_t start_ns, uint64_t end_ns, int64_t arg)
+    {
+        record({name, start_ns, end_ns - start_ns, arg, false});
+    }
+
+    void instant(const char *name, int64_t arg)
+    {
+        record({name, traceNowNs(), 0, arg, true});
+    }
+
+    int threadId() const
+    {
+        return tid;
+    }
+
+    size_t capacity() const
+    {
+        return events.size();
+    }
+
+    /**
+        Calls f(event) for the retained events, oldest first.
+    */
+    template <typename F>
+    void forEach(F &&f) const
+    {
+        size_t count = written < events.size() ? written : events.size();
+        for (size_t i = written - count; i < written; ++i)
+        {
+            f(events[i % events.size()]);
+        }
+    }
+
+    void clear()
+    {
+        written = 0;
+    }
+
+private:
+    int tid;
+    std::vector<TraceEvent> events;
+    size_t written = 0;
+
+    void record(const TraceEvent &event)
+    {
+        events[written % events.size()] = event;
+        ++written;
+    }
+};
+
+class TraceRecorder
+{
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 16;
+
+    static TraceRecorder &instance()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    /**
+        The calling thread's buffer. The first call on a thread takes one under a lock, reusing a
+        buffer left by an exited thread when one of the current capacity is free; later calls are a
+        thread_local read. Buffers therefore number the most threads ever tracing at once, not every
+        thread ever started, and an exited thread's events stay until its buffer wraps.
+    */
+    TraceBuffer &local()
+    {
+        thread_local Lease lease;
+        if (!lease.buffer)
+        {
+            lease.buffer = acquire();
+            lease.recorder = this;
+        }
+        return *lease.buffer;
+    }
+
+    /**
+        Buffers registered so far, in use or free.
+    */
+    size_t bufferCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffers.size();
+    }
+
+    /**
+        Capacity, in events, of buffers handed out from now on.
+    */
+    void setCapacity(size_t events)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = events == 0 ? 1 : events;
+    }
+
+    /**
+        Writes every thread's events as Chrome trace JSON. Call once the traced threads are idle;
+        buffers are read without synchronisation with their writers.
+    */
+    void writeChromeTrace(std::ostream &output)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto &buffer : buffers)
+        {
+            buffer->forEach([&](const TraceEvent &event)
+                            {
+                output << (first ? "\n" : ",\n");
+                first = false;
+                output << "{\"name\":\"" << event.name << "\",\"ph\":\"" << (event.instant ? "i" : "X")
+                       << "\",\"pid\":1,\"tid\":" << buffer->threadId()
+                       << ",\"ts\":";
+                writeMicros(output, event.start_ns);
+                if (event.instant)
+                {
+                    output << ",\"s\":\"t\"";
+                }
+                else
+                {
+                    output << ",\"dur\":";
+                    writeMicros(output, event.duration_ns);
+                }
+                output << ",\"args\":{\"v\":" << event.arg << "}}"; });
+        }
+        output << "\n]}\n";
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &buffer : buffers)
+        {
+            buffer->clear();
+        }
+    }
+
+private:
+    // Returns the thread's buffer to the free list when the thread exits.
+    struct Lease
+    {
+        TraceRecorder *recorder = nullptr;
+        TraceBuffer *buffer = nullptr;
+
+        ~Lease()
+        {
+            if (buffer)
+            {
+                recorder->release(buffer);
+            }
+        }
+    };
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer *> free_buffers;
+    size_t capacity = kDefaultCapacity;
+
+    TraceRecorder() = default;
+
+    TraceBuffer *acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < free_buffers.size(); ++i)
+        {
+            if (free_buffers[i]->capacity() == capacity)
+            {
+                TraceBuffer *buffer = free_buffers[i];
+                free_buffers.erase(free_buffers.begin() + i);
+                return buffer;
+            }
+        }
+        buffers.push_back(std::make_unique<TraceBuffer>(static_cast<int>(buffers.size()) + 1, capacity));
+        return buffers.back().get();
+    }
+
+    void release(TraceBuffer *buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_buffers.push_back(buffer);
+    }
+
+    // Chrome trace timestamps are microseconds; keep nanosecond resolution as three decimals.
+    static void writeMicros(std::ostream &output, uint64_t ns)
+    {
+        uint64_t fraction = ns % 1000;
+        output << ns / 1000 << '.' << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10)
+               << static_cast<char>('0' + fraction % 10);
+    }
+};
+
+/**
+    Records a complete ("X") event covering its own lifetime.
+*/
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name, int64_t arg) : name(name), arg(arg), start_ns(traceNowNs()) {}
+
+    ~TraceSpan()
+    {
+        TraceRecorder::instance().local().complete(name, start_ns, traceNowNs(), arg);
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name;
+    int64_t arg;
+    uint64_t start_ns;
+};
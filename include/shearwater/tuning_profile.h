@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "cpu_dispatch.h"
+#include "solver_version.h"
+
+/**
+    Engine parameters measured on one machine by shearwater_tune (tools/cpp/shearwater_tune.cpp).
+    The defaults reproduce the untuned behaviour.
+*/
+struct TuningProfile
+{
+    static constexpr int kMaxLegChunk = 256;
+
+    CpuLevel cpu_level = detectCpuLevel(); // kernel instruction set level (cpu_dispatch.h)
+    int threads = 1;                       // BatchSolver workers when the caller does not say
+    int claim_size = 1;                    // courses a BatchSolver worker takes per claim
+    int leg_chunk = 64;                    // leg times per kernel call, 1..kMaxLegChunk
+    int forward_min_waypoints = 0;         // from this course size on, forward DP instead of the heap search; 0: never
+    std::string host;                      // where it was measured, for the record
+
+    /**
+        The profile file format: "key=value" lines, '#' comments. solver_version must match
+        kSolverVersion, since timings of another solver say nothing about this one.
+    */
+    std::string format() const
+    {
+        std::ostringstream text;
+        text << "# shearwater tuning profile, written by shearwater_tune\n";
+        text << "solver_version=" << kSolverVersion << "\n";
+        if (!host.empty())
+        {
+            text << "host=" << host << "\n";
+        }
+        text << "cpu_level=" << cpuLevelName(cpu_level) << "\n";
+        text << "threads=" << threads << "\n";
+        text << "claim_size=" << claim_size << "\n";
+        text << "leg_chunk=" << leg_chunk << "\n";
+        text << "forward_min_waypoints=" << forward_min_waypoints << "\n";
+        return text.str();
+    }
+
+    /**
+        Reads a profile in format(). On error returns false with the reason in error, leaving this
+        profile unchanged.
+    */
+    bool parse(const std::string &text, std::string &error)
+    {
+        TuningProfile parsed = *this;
+        bool versioned = false;
+        std::istringstream lines(text);
+        std::string line;
+        for (int number = 1; std::getline(lines, line); ++number)
+        {
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            const size_t equals = line.find('=');
+            const std::string key = line.substr(0, equals);
+            const std::string value = equals == std::string::npos ? "" : line.substr(equals + 1);
+            int number_value = 0;
+            const bool numeric = parseInt(value, number_value);
+            const std::string where = "line " + std::to_string(number) + ": ";
+            if (key == "solver_version")
+            {
+                if (!numeric || number_value != static_cast<int>(kSolverVersion))
+                {
+                    error = where + "measured with solver version " + value + ", this is " + std::to_string(kSolverVersion);
+                    return false;
+                }
+                versioned = true;
+            }
+            else if (key == "host")
+            {
+                parsed.host = value;
+            }
+            else if (key == "cpu_level")
+            {
+                if (!parseCpuLevel(value, parsed.cpu_level))
+                {
+                    error = where + "unknown cpu_level " + value;
+                    return false;
+                }
+            }
+            else if (key == "threads" && numeric && number_value >= 1)
+            {
+                parsed.threads = number_value;
+            }
+            else if (key == "claim_size" && numeric && number_value >= 1)
+            {
+                parsed.claim_size = number_value;
+            }
+            else if (key == "leg_chunk" && numeric && number_value >= 1 && number_value <= kMaxLegChunk)
+            {
+                parsed.leg_chunk = number_value;
+            }
+            else if (key == "forward_min_waypoints" && numeric && number_value >= 0)
+            {
+                parsed.forward_min_waypoints = number_value;
+            }
+            else
+            {
+                error = where + "bad or unknown setting '" + line + "'";
+                return false;
+            }
+        }
+        if (!versioned)
+        {
+            error = "no solver_version";
+            return false;
+        }
+        *this = parsed;
+        return true;
+    }
+
+    bool load(const std::string &path, std::string &error)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        if (!parse(text.str(), error))
+        {
+            error = path + ": " + error;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+        Writes the profile through a temporary file renamed into place, so readers never see half
+        a profile.
+    */
+    bool save(const std::string &path, std::string &error) const
+    {
+        const std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            if (!(file << format()) || !file.flush())
+            {
+                error = "cannot write " + temporary;
+                return false;
+            }
+        }
+        if (std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            error = "cannot rename " + temporary + " to " + path;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static bool parseInt(const std::string &text, int &value)
+    {
+        char *end = nullptr;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || parsed < 0 || parsed > 1 << 30)
+        {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+};
+
+constexpr const char *kTuningProfileEnvironment = "SHEARWATER_TUNING_PROFILE";
+constexpr const char *kDefaultTuningProfilePath = "/etc/shearwater/tuning.profile";
+
+/**
+    The profile in effect for the process and where it came from.
+*/
+struct StartupTuning
+{
+    TuningProfile profile;
+    std::string source; // the file read, or empty for the defaults
+    std::string error;  // why a profile file was not used, if one was named or present
+};
+
+inline bool &defaultTuningPinned()
+{
+    static bool pinned = false;
+    return pinned;
+}
+
+/**
+    Loaded once, on first use: from the file named by SHEARWATER_TUNING_PROFILE, else from
+    /etc/shearwater/tuning.profile if it exists, else the defaults. The profile's cpu_level is
+    selected for the kernels unless SHEARWATER_CPU_LEVEL overrides it or the CPU lacks it. Every
+    Optimizer and BatchSolver starts from this profile; tools call it early to report errors.
+*/
+inline const StartupTuning &startupTuning()
+{
+    static const StartupTuning tuning = []
+    {
+        StartupTuning result;
+        if (defaultTuningPinned())
+        {
+            return result;
+        }
+        const char *named = std::getenv(kTuningProfileEnvironment);
+        const std::string path = named ? named : kDefaultTuningProfilePath;
+        if (!named && !std::ifstream(path))
+        {
+            return result;
+        }
+        if (!result.profile.load(path, result.error))
+        {
+            result.profile = TuningProfile();
+            return result;
+        }
+        result.source = path;
+        if (!std::getenv("SHEARWATER_CPU_LEVEL") && !selectCpuLevel(result.profile.cpu_level))
+        {
+            result.error = path + ": cpu_level " + cpuLevelName(result.profile.cpu_level) + " is not supported here, using " +
+                           cpuLevelName(cpuKernels().level);
+            result.profile.cpu_level = cpuKernels().level;
+        }
+        return result;
+    }();
+    return tuning;
+}
+
+inline const TuningProfile &tuningProfile()
+{
+    return startupTuning().profile;
+}
+
+/**
+    Makes the process ignore the machine's tuning profile and start every Optimizer and
+    BatchSolver from TuningProfile(), so tests and benchmarks measure the same engine on every
+    host. Call it first thing in main(); returns false if a profile file was already loaded.
+*/
+inline bool pinDefaultTuning()
+{
+    defaultTuningPinned() = true;
+    return startupTuning().source.empty();
+}
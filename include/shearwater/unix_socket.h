@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <streambuf>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+    Minimal Unix domain stream socket helpers shared by the solver daemon and its client. Functions
+    return -1 (or false) on failure and leave the reason in errno.
+*/
+inline bool unixAddress(const std::string &path, sockaddr_un &address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+/**
+    Binds and listens on path, replacing a stale socket file left by an earlier run.
+*/
+inline int unixListen(const std::string &path, int backlog = 64)
+{
+    sockaddr_un address;
+    if (!unixAddress(path, address))
+    {
+        return -1;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(fd, backlog) < 0)
+    {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+inline int unixConnect(const std::string &path)
+{
+    sockaddr_un address;
+    if (!unixAddress(path, address))
+    {
+        return -1;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+    Writes all of data, retrying short writes. MSG_NOSIGNAL: a vanished peer is an error, not SIGPIPE.
+*/
+inline bool sendAll(int fd, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        ssize_t sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+/**
+    Reads exactly size bytes. Returns false at end of stream or on error.
+*/
+inline bool recvAll(int fd, void *data, size_t size)
+{
+    char *bytes = static_cast<char *>(data);
+    while (size > 0)
+    {
+        ssize_t got = ::recv(fd, bytes, size, 0);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return false;
+        }
+        bytes += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+/**
+    Buffered std::streambuf over a socket, so the text protocol can reuse readCourse(). Input and
+    output have separate buffers; the descriptor is not owned.
+*/
+class SocketStreamBuf : public std::streambuf
+{
+public:
+    explicit SocketStreamBuf(int fd) : fd(fd)
+    {
+        setg(in, in, in);
+        setp(out, out + sizeof(out));
+    }
+
+    /**
+        Puts back bytes already taken off the socket, e.g. a protocol sniff, ahead of further input.
+    */
+    void prime(const char *data, size_t size)
+    {
+        size = size < sizeof(in) ? size : sizeof(in);
+        std::memcpy(in, data, size);
+        setg(in, in, in + size);
+    }
+
+protected:
+    int_type underflow() override
+    {
+        ssize_t got;
+        do
+        {
+            got = ::recv(fd, in, sizeof(in), 0);
+        } while (got < 0 && errno == EINTR);
+        if (got <= 0)
+        {
+            return traits_type::eof();
+        }
+        setg(in, in, in + got);
+        return traits_type::to_int_type(in[0]);
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if (sync() < 0)
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        size_t pending = static_cast<size_t>(pptr() - pbase());
+        if (pending > 0 && !sendAll(fd, pbase(), pending))
+        {
+            return -1;
+        }
+        setp(out, out + sizeof(out));
+        return 0;
+    }
+
+private:
+    int fd;
+    char in[8192];
+    char out[8192];
+};
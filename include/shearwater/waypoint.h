@@ -0,0 +1,8 @@
+#pragma once
+
+struct Waypoint
+{
+    int x;
+    int y;
+    int penalty;
+};
@@ -2,17 +2,22 @@
 # Date: January 21, 2024
 
 import argparse
+import glob
 import os
 import re
 import subprocess
+import time
 
 class TestRunner:
-    def __init__(self, test_directory, output_directory="bin", language="cpp", blacklist=None):
+    def __init__(self, test_directory, output_directory="bin", language="cpp", blacklist=None, suite="tests", run_args=None, cxxflags=""):
         self.test_directory = os.path.join(test_directory, language)
         print(f"Test path: {self.test_directory}")
         self.output_directory = os.path.join(output_directory, language)
         self.language = language.lower()
         self.blacklist = blacklist or  []
+        self.suite = suite
+        self.run_args = run_args or []
+        self.cxxflags = cxxflags
         os.makedirs(self.output_directory, exist_ok=True)
         
     def discover_tests(self):
@@ -52,6 +57,10 @@ class TestRunner:
             exit(1)  # Exit with a non-zero status code
 
     def run_and_check(self, output_binary):
+        if self.suite == "tools":
+            # Tools are command line utilities; building them is the check.
+            return
+
         run_command = self.get_run_command(output_binary)
         if run_command == "":
             return
@@ -66,9 +75,20 @@ class TestRunner:
             exit(1)  # Exit with a non-zero status code
 
     def get_compile_command(self, test_file, output_binary):
+        command = self.get_base_compile_command(test_file, output_binary)
+        if self.cxxflags:
+            command += f" {self.cxxflags}"
+        return command
+
+    def get_base_compile_command(self, test_file, output_binary):
         # Customize compile commands for different languages
-        if self.language == "cpp":
-            return f"g++ -fdiagnostics-color=always -g -std=c++17 {os.path.join(self.test_directory, test_file)} -o {output_binary} -lgtest -lgtest_main -pthread -I cget/include/ -L cget/lib/**"
+        if self.language == "cpp" and self.suite == "benchmarks":
+            # Benchmarks measure optimized code; they provide their own main().
+            return f"g++ -fdiagnostics-color=always -O2 -DNDEBUG -std=c++17 {os.path.join(self.test_directory, test_file)} -o {output_binary} -lbenchmark -pthread -I include/ -I cget/include/ -L cget/lib/**"
+        elif self.language == "cpp" and self.suite == "tools":
+            return f"g++ -fdiagnostics-color=always -O2 -std=c++17 {os.path.join(self.test_directory, test_file)} -o {output_binary} -pthread -I include/"
+        elif self.language == "cpp":
+            return f"g++ -fdiagnostics-color=always -g -std=c++17 {os.path.join(self.test_directory, test_file)} -o {output_binary} -lgtest -lgtest_main -pthread -I include/ -I cget/include/ -L cget/lib/**"
         elif self.language == "go":
             return f"go test -v {test_file}"
         elif self.language == "py":
@@ -80,7 +100,7 @@ class TestRunner:
     def get_run_command(self, output_binary):
         # Customize run commands for different languages
         if self.language == "cpp":
-            return output_binary
+            return " ".join([output_binary] + self.run_args)
         elif self.language == "go":
             # Go tests do not produce standalone binaries, 'go build' does. Main application runs 'go build'. 
             return ""
@@ -108,15 +128,131 @@ class TestRunner:
 
             self.compile_and_run_test(test_file)
 
+class ReleaseBuilder:
+    """
+    Optimized release build of the solver CLI (tools/cpp/shearwater_solve.cpp) with link-time and
+    profile-guided optimization, next to a plain -O2 build it is compared against:
+
+    1. An instrumented -O2 -flto build is run on the training corpus: every sample input in
+       data/shearwater_challenge plus generated large courses of every profile.
+    2. The release binary is rebuilt with -flto and -fprofile-use from those profiles.
+    3. Both builds solve a held-out benchmark corpus (generated with other seeds) several times,
+       alternating. Their outputs must match; the fastest wall time of each is reported.
+
+    The object file is compiled at the same path in both stages, so its profile (the .gcda file next
+    to it) is found.
+    """
+
+    PROFILES = ["uniform", "clustered", "collinear", "low_penalty", "high_penalty", "max_penalty", "zigzag"]
+    SOURCE = "tools/cpp/shearwater_solve.cpp"
+
+    def __init__(self, output_directory="bin", cxxflags="", repeats=5):
+        self.output_directory = os.path.join(output_directory, "cpp", "release")
+        self.object_file = os.path.join(self.output_directory, "obj", "shearwater_solve.o")
+        self.corpus_directory = os.path.join(self.output_directory, "corpus")
+        self.cxxflags = cxxflags
+        self.repeats = repeats
+        os.makedirs(self.corpus_directory, exist_ok=True)
+
+    def run(self, command, **kwargs):
+        print(f"Command: {command}")
+        result = subprocess.run(command, shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True, **kwargs)
+        if result.returncode != 0:
+            print(result.stderr)
+            exit(1)
+        return result
+
+    def compile(self, output_binary, flags):
+        os.makedirs(os.path.dirname(self.object_file), exist_ok=True)
+        self.run(f"g++ -fdiagnostics-color=always -std=c++17 -pthread -I include/ {flags} {self.cxxflags} -c {self.SOURCE} -o {self.object_file}")
+        self.run(f"g++ -pthread {flags} {self.cxxflags} {self.object_file} -o {output_binary}")
+
+    def generate(self, name, seed, waypoints, courses):
+        path = os.path.join(self.corpus_directory, name)
+        generator = os.path.join(self.output_directory, "course_generator")
+        self.run(f"{generator} --profile {name.split('-')[0]} --waypoints {waypoints} --courses {courses} --seed {seed} --input {path}")
+        return path
+
+    def corpora(self):
+        self.run(f"g++ -O2 -std=c++17 -I include/ tools/cpp/course_generator.cpp -o {os.path.join(self.output_directory, 'course_generator')}")
+        training = sorted(glob.glob("data/shearwater_challenge/sample_input_*.txt"))
+        benchmark = []
+        for index, profile in enumerate(self.PROFILES):
+            training.append(self.generate(f"{profile}-train-1000.txt", 100 + index, 1000, 20))
+            training.append(self.generate(f"{profile}-train-100.txt", 200 + index, 100, 500))
+            benchmark.append(self.generate(f"{profile}-bench-1000.txt", 300 + index, 1000, 20))
+            benchmark.append(self.generate(f"{profile}-bench-50.txt", 400 + index, 50, 5000))
+        return training, benchmark
+
+    def solve(self, binary, input_path):
+        with open(input_path) as input_file:
+            start = time.perf_counter()
+            result = subprocess.run([binary], stdin=input_file, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+            elapsed = time.perf_counter() - start
+        if result.returncode != 0:
+            print(f"{binary} failed on {input_path}")
+            print(result.stderr)
+            exit(1)
+        return elapsed, result.stdout
+
+    def build(self):
+        training, benchmark = self.corpora()
+
+        plain = os.path.join(self.output_directory, "shearwater_solve_o2")
+        self.compile(plain, "-O2")
+
+        instrumented = os.path.join(self.output_directory, "shearwater_solve_instrumented")
+        profile = os.path.splitext(self.object_file)[0] + ".gcda"
+        if os.path.exists(profile):
+            os.remove(profile)
+        self.compile(instrumented, "-O2 -flto=auto -fprofile-generate -fprofile-update=atomic")
+        for input_path in training:
+            print(f"Training: {input_path}")
+            self.solve(instrumented, input_path)
+        if not os.path.exists(profile):
+            print(f"Training wrote no profile to {profile}")
+            exit(1)
+
+        release = os.path.join(self.output_directory, "shearwater_solve")
+        self.compile(release, "-O2 -flto=auto -fprofile-use -fprofile-correction")
+        self.compare(plain, release, benchmark)
+
+    def compare(self, plain, release, benchmark):
+        print(f"")
+        print(f"{'input':<28} {'-O2 (s)':>10} {'PGO+LTO (s)':>12} {'speedup':>8}")
+        totals = [0.0, 0.0]
+        for input_path in benchmark:
+            best = [float("inf"), float("inf")]
+            outputs = [None, None]
+            for _ in range(self.repeats):
+                for which, binary in enumerate([plain, release]):
+                    elapsed, output = self.solve(binary, input_path)
+                    best[which] = min(best[which], elapsed)
+                    outputs[which] = output
+            if outputs[0] != outputs[1]:
+                print(f"Release output differs from -O2 on {input_path}")
+                exit(1)
+            totals = [totals[0] + best[0], totals[1] + best[1]]
+            print(f"{os.path.basename(input_path):<28} {best[0]:>10.3f} {best[1]:>12.3f} {best[0] / best[1]:>7.2f}x")
+        print(f"{'total':<28} {totals[0]:>10.3f} {totals[1]:>12.3f} {totals[0] / totals[1]:>7.2f}x")
+        print(f"Release binary: {release}")
+
 if __name__ == "__main__":
 
     parser = argparse.ArgumentParser(description='Run tests with blacklist.')
     parser.add_argument('--language', choices=['cpp', 'go', 'py', 'all'], required=True, help='Programming language to run tests on')
-    parser.add_argument('--test-directory', default='tests', help='Directory containing the tests')
+    parser.add_argument('--suite', choices=['tests', 'benchmarks', 'tools', 'release'], default='tests', help='Build and run the gtest suite or the benchmarks, build the tools, or build the PGO+LTO release solver and compare it with -O2')
+    parser.add_argument('--test-directory', default=None, help='Directory containing the tests (defaults to the suite name)')
+    parser.add_argument('--cxxflags', default='', help='Extra compiler flags, e.g. --cxxflags=-DSHEARWATER_STATS')
+    parser.add_argument('--run-args', nargs=argparse.REMAINDER, help='Arguments passed through to every test binary, e.g. --benchmark_filter=sample')
     parser.add_argument('--blacklist', nargs='+', help='List of files to blacklist')
 
     args = parser.parse_args()
 
+    if args.suite == 'release':
+        ReleaseBuilder(cxxflags=args.cxxflags).build()
+        exit(0)
+
     if args.language == 'all':
         languages = ['cpp', 'go', 'py']
     else:
@@ -125,5 +261,6 @@ if __name__ == "__main__":
     for language in languages:
         blacklist = args.blacklist if args.blacklist else []
         print(language)
-        test_runner = TestRunner(test_directory=args.test_directory, language=language, blacklist=blacklist)
+        test_directory = args.test_directory or args.suite
+        test_runner = TestRunner(test_directory=test_directory, language=language, blacklist=blacklist, suite=args.suite, run_args=args.run_args, cxxflags=args.cxxflags)
         test_runner.run_tests()
\ No newline at end of file
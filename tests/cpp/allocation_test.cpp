@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "shearwater/alloc_tracker.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/tuning_profile.h"
+
+SHEARWATER_DEFINE_ALLOCATION_HOOKS
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Peak heap bytes a cold Optimizer may use for one N = 1000 course. Dominated by the search heap,
+// which keeps an entry per improving relaxation (about 19 MB today on the worst profiles). Raise it
+// deliberately, never to silence a regression.
+static constexpr int64_t kPeakBytesBudgetN1000 = 24 << 20;
+
+static vector<vector<Waypoint>> batch()
+{
+    vector<vector<Waypoint>> courses;
+    for (const char *size : {"small", "medium", "large"})
+    {
+        ifstream input(fs::current_path() / "data/shearwater_challenge" / (string("sample_input_") + size + ".txt"));
+        for (auto &course : readCourses(input))
+        {
+            courses.push_back(move(course));
+        }
+    }
+    CourseGenerator generator(17);
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        courses.push_back(generator.generate(profile, 400));
+    }
+    return courses;
+}
+
+TEST(AllocationTest, TrackerCountsAllocations)
+{
+    AllocationScope scope;
+    {
+        auto block = make_unique<char[]>(1000);
+        vector<int> values(10);
+        AllocationCounts inside = scope.counts();
+        EXPECT_EQ(2u, inside.allocations);
+        EXPECT_EQ(1000 + 10 * sizeof(int), inside.bytes_allocated);
+        EXPECT_EQ(static_cast<int64_t>(inside.bytes_allocated), inside.live_bytes);
+    }
+    AllocationCounts after = scope.counts();
+    EXPECT_EQ(2u, after.deallocations);
+    EXPECT_EQ(0, after.live_bytes);
+    EXPECT_EQ(static_cast<int64_t>(1000 + 10 * sizeof(int)), after.peak_live_bytes);
+}
+
+TEST(AllocationTest, EveryOperatorFormIsCounted)
+{
+    AllocationScope scope;
+    void *plain = operator new(16, nothrow);
+    void *array = operator new[](16, nothrow);
+    void *aligned = operator new(16, align_val_t(64), nothrow);
+    void *aligned_array = operator new[](16, align_val_t(64), nothrow);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned) % 64);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned_array) % 64);
+    EXPECT_EQ(4u, scope.counts().allocations);
+    operator delete(plain, nothrow);
+    operator delete[](array, nothrow);
+    operator delete(aligned, align_val_t(64), nothrow);
+    operator delete[](aligned_array, align_val_t(64)); // freed through another aligned form
+    AllocationCounts after = scope.counts();
+    EXPECT_EQ(4u, after.deallocations);
+    EXPECT_EQ(0, after.live_bytes);
+}
+
+TEST(AllocationTest, SteadyStateBatchDoesNotAllocate)
+{
+    auto courses = batch();
+    Optimizer optimizer;
+
+    vector<double> warm;
+    for (const auto &course : courses)
+    {
+        warm.push_back(optimizer.findLowestTime(course));
+    }
+
+    AllocationScope scope;
+    for (size_t c = 0; c < courses.size(); ++c)
+    {
+        EXPECT_EQ(warm[c], optimizer.findLowestTime(courses[c]));
+    }
+    AllocationCounts counts = scope.counts();
+    EXPECT_EQ(0u, counts.allocations) << counts.bytes_allocated << " bytes over " << courses.size() << " courses";
+}
+
+TEST(AllocationTest, PeakBytesPerCourseWithinBudget)
+{
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        CourseGenerator generator(23);
+        auto course = generator.generate(profile, 1000);
+
+        AllocationScope scope;
+        Optimizer optimizer;
+        optimizer.findLowestTime(course);
+        AllocationCounts counts = scope.counts();
+        std::cout << profileName(profile) << ": " << counts.allocations << " allocations, peak "
+                  << counts.peak_live_bytes << " bytes" << std::endl;
+        EXPECT_LE(counts.peak_live_bytes, kPeakBytesBudgetN1000) << profileName(profile);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
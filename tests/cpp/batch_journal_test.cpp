@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shearwater/batch_journal.h"
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/metrics.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+class BatchJournalTest : public ::testing::Test
+{
+protected:
+    string path = "/tmp/shearwater_batch_journal_test_" + to_string(getpid()) + ".journal";
+    vector<vector<Waypoint>> courses;
+
+    void SetUp() override
+    {
+        CourseGenerator generator(99);
+        for (int c = 0; c < 60; ++c)
+        {
+            courses.push_back(generator.generate(kAllCourseProfiles[c % 7], 40 + c));
+        }
+    }
+
+    void TearDown() override
+    {
+        remove(path.c_str());
+    }
+
+    size_t fileSize() const
+    {
+        struct stat info;
+        return ::stat(path.c_str(), &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+    }
+};
+
+TEST_F(BatchJournalTest, ResumeAfterCrashSolvesOnlyTheRestWithIdenticalAnswers)
+{
+    const vector<double> expected = BatchSolver(1).solve(courses);
+
+    // The first run dies after every third course is journaled, without closing the journal.
+    pid_t child = fork();
+    if (child == 0)
+    {
+        BatchJournal journal;
+        if (!journal.open(path, courses, chrono::milliseconds(0)))
+        {
+            _exit(1);
+        }
+        Optimizer optimizer;
+        for (size_t c = 0; c < courses.size(); c += 3)
+        {
+            journal.record(c, optimizer.findLowestTime(courses[c]));
+        }
+        abort();
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFSIGNALED(status));
+
+    BatchJournal journal;
+    ASSERT_TRUE(journal.open(path, courses)) << journal.error();
+    EXPECT_EQ(journal.finishedCount(), courses.size() / 3);
+
+    SolverMetrics metrics;
+    BatchSolver solver(3);
+    solver.setMetrics(&metrics);
+    solver.setJournal(&journal);
+    vector<double> answers = solver.solve(courses);
+    EXPECT_EQ(metrics.coursesSolved(), courses.size() - courses.size() / 3);
+    ASSERT_EQ(answers.size(), expected.size());
+    for (size_t c = 0; c < answers.size(); ++c)
+    {
+        EXPECT_EQ(answers[c], expected[c]) << "course " << c; // bit for bit
+    }
+    journal.close();
+
+    BatchJournal finished;
+    ASSERT_TRUE(finished.open(path, courses));
+    EXPECT_EQ(finished.finishedCount(), courses.size());
+}
+
+TEST_F(BatchJournalTest, TornRecordIsCutOffOnReopen)
+{
+    {
+        BatchJournal journal;
+        ASSERT_TRUE(journal.open(path, courses));
+        journal.record(4, 123.5);
+        journal.record(7, 456.25);
+    }
+    const size_t complete = fileSize();
+    {
+        ofstream file(path, ios::binary | ios::app);
+        file.write("\x07\x00\x00\x00\x00\x00\x00\x00\x01\x02\x03", 11); // half of a third record
+    }
+
+    BatchJournal journal;
+    ASSERT_TRUE(journal.open(path, courses));
+    EXPECT_EQ(journal.finishedCount(), 2u);
+    EXPECT_TRUE(journal.finished(4));
+    EXPECT_TRUE(journal.finished(7));
+    EXPECT_FALSE(journal.finished(5));
+    EXPECT_EQ(journal.answer(7), 456.25);
+    EXPECT_EQ(fileSize(), complete);
+    journal.record(5, 1.0);
+    journal.close();
+    EXPECT_GT(fileSize(), complete);
+}
+
+TEST_F(BatchJournalTest, JournalOfAnotherBatchIsRefused)
+{
+    {
+        BatchJournal journal;
+        ASSERT_TRUE(journal.open(path, courses));
+        journal.record(0, 1.0);
+    }
+    auto changed = courses;
+    changed[30][5].penalty += 1;
+    BatchJournal journal;
+    EXPECT_FALSE(journal.open(path, changed));
+    EXPECT_NE(journal.error().find("different batch"), string::npos);
+
+    changed = courses;
+    changed.pop_back();
+    EXPECT_FALSE(journal.open(path, changed));
+    EXPECT_TRUE(journal.open(path, courses));
+    EXPECT_EQ(journal.finishedCount(), 1u);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/capture_log.h"
+#include "shearwater/course_generator.h"
+
+using namespace std;
+
+static void expectSameCourse(const vector<Waypoint> &expected, const vector<Waypoint> &actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_EQ(expected[i].x, actual[i].x);
+        EXPECT_EQ(expected[i].y, actual[i].y);
+        EXPECT_EQ(expected[i].penalty, actual[i].penalty);
+    }
+}
+
+TEST(CaptureLogTest, RoundTripsCoursesAndArrivalTimes)
+{
+    CourseGenerator generator(5);
+    vector<vector<Waypoint>> courses = {generator.generate(CourseProfile::Uniform, 100),
+                                        generator.generate(CourseProfile::Clustered, 0),
+                                        generator.generate(CourseProfile::MaxPenalty, 7)};
+    stringstream log;
+    CaptureWriter writer(log);
+    writer.writeHeader();
+    for (size_t c = 0; c < courses.size(); ++c)
+    {
+        ASSERT_TRUE(writer.append(1000 * c + 7, courses[c]));
+    }
+
+    CaptureReader reader(log);
+    ASSERT_TRUE(reader.valid());
+    CapturedCourse captured;
+    for (size_t c = 0; c < courses.size(); ++c)
+    {
+        ASSERT_TRUE(reader.next(captured));
+        EXPECT_EQ(1000 * c + 7, captured.arrival_ns);
+        expectSameCourse(courses[c], captured.waypoints);
+    }
+    EXPECT_FALSE(reader.next(captured));
+}
+
+TEST(CaptureLogTest, ValidCoursesTakeThreeBytesPerWaypoint)
+{
+    CourseGenerator generator(5);
+    stringstream log;
+    CaptureWriter writer(log);
+    writer.writeHeader();
+    writer.append(0, generator.generate(CourseProfile::Uniform, 1000));
+    EXPECT_EQ(12u + 13u + 3000u, log.str().size());
+}
+
+TEST(CaptureLogTest, OutOfRangeValuesAreKept)
+{
+    vector<Waypoint> course = {{0, 0, 0}, {-5, 300, 70000}, {100, 100, 0}};
+    stringstream log;
+    CaptureWriter writer(log);
+    writer.writeHeader();
+    writer.append(42, course);
+
+    CaptureReader reader(log);
+    CapturedCourse captured;
+    ASSERT_TRUE(reader.next(captured));
+    expectSameCourse(course, captured.waypoints);
+}
+
+TEST(CaptureLogTest, RejectsForeignAndTruncatedLogs)
+{
+    stringstream foreign("not a capture log");
+    EXPECT_FALSE(CaptureReader(foreign).valid());
+
+    CourseGenerator generator(5);
+    stringstream log;
+    CaptureWriter writer(log);
+    writer.writeHeader();
+    writer.append(0, generator.generate(CourseProfile::Uniform, 10));
+    writer.append(1, generator.generate(CourseProfile::Uniform, 10));
+    string bytes = log.str();
+    stringstream truncated(bytes.substr(0, bytes.size() - 1));
+
+    CaptureReader reader(truncated);
+    CapturedCourse captured;
+    EXPECT_TRUE(reader.next(captured));
+    EXPECT_FALSE(reader.next(captured));
+    EXPECT_FALSE(reader.valid());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
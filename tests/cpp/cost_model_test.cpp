@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/reference_solver.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+static vector<vector<Waypoint>> generatedCourses()
+{
+    CourseGenerator generator(75);
+    vector<vector<Waypoint>> courses;
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        for (int n : {0, 1, 2, 9, 70, 300})
+        {
+            courses.push_back(generator.generate(profile, n));
+        }
+    }
+    return courses;
+}
+
+// The generator frames courses in the standard field; move the finish to the model's.
+static vector<Waypoint> reframed(vector<Waypoint> course, const RuntimeCostModel &model)
+{
+    course.front() = model.start();
+    course.back() = model.finish();
+    return course;
+}
+
+TEST(CostModelTest, RuntimeModelWithStandardValuesGivesIdenticalAnswers)
+{
+    const RuntimeCostModel model;
+    ASSERT_TRUE(model.isStandard());
+    for (int forward_min_waypoints : {0, 1})
+    {
+        TuningProfile profile;
+        profile.forward_min_waypoints = forward_min_waypoints;
+        Optimizer standard;
+        standard.setTuning(profile);
+        BasicOptimizer<RuntimeCostModel> runtime(model);
+        runtime.setTuning(profile);
+        for (const auto &course : generatedCourses())
+        {
+            EXPECT_EQ(runtime.findLowestTime(course), standard.findLowestTime(course)) << course.size() - 2 << " waypoints";
+            EXPECT_EQ(runtime.optimalPath(), standard.optimalPath()) << course.size() - 2 << " waypoints";
+        }
+    }
+}
+
+TEST(CostModelTest, OtherModelsMatchTheReferenceSolver)
+{
+    for (RuntimeCostModel model : {RuntimeCostModel{4.0, 5.0, 50}, RuntimeCostModel{0.5, 0.0, 200}, RuntimeCostModel{3.0, 30.0, 100}})
+    {
+        ASSERT_TRUE(model.valid());
+        ASSERT_FALSE(model.isStandard());
+        for (int forward_min_waypoints : {0, 1})
+        {
+            TuningProfile profile;
+            profile.forward_min_waypoints = forward_min_waypoints;
+            BasicOptimizer<RuntimeCostModel> optimizer(model);
+            optimizer.setTuning(profile);
+            for (const auto &generated : generatedCourses())
+            {
+                const vector<Waypoint> course = reframed(generated, model);
+                EXPECT_NEAR(optimizer.findLowestTime(course), referenceLowestTime(course, model), 1e-9)
+                    << "speed " << model.speed() << " stop " << model.stopSeconds() << ", " << course.size() - 2 << " waypoints";
+            }
+        }
+    }
+}
+
+TEST(CostModelTest, DirectFlightAndInvalidModels)
+{
+    const RuntimeCostModel model{4.0, 5.0, 30};
+    BasicOptimizer<RuntimeCostModel> optimizer(model);
+    // 30√2 m at 4 m/s, and the stop at the finish.
+    EXPECT_DOUBLE_EQ(optimizer.findLowestTime({model.start(), model.finish()}), sqrt(1800.0) / 4 + 5);
+    EXPECT_EQ(optimizer.costModel().field_size, 30);
+
+    EXPECT_FALSE((RuntimeCostModel{0.0, 10.0, 100}.valid()));
+    EXPECT_FALSE((RuntimeCostModel{-2.0, 10.0, 100}.valid()));
+    EXPECT_FALSE((RuntimeCostModel{2.0, -1.0, 100}.valid()));
+    EXPECT_TRUE(StandardCostModel::valid());
+}
+
+TEST(CostModelTest, ParsersFrameCoursesWithTheModel)
+{
+    const string input = "2\n10 20 5\n30 40 6\n0\n";
+    const RuntimeCostModel model{2.0, 10.0, 250};
+
+    istringstream stream(input);
+    vector<vector<Waypoint>> courses = readCourses(stream, model);
+    ASSERT_EQ(courses.size(), 1u);
+    ASSERT_EQ(courses[0].size(), 4u);
+    EXPECT_EQ(courses[0].back().x, 250);
+    EXPECT_EQ(courses[0].back().y, 250);
+
+    CourseParser parser(input.data(), input.size(), model);
+    vector<Waypoint> course;
+    ASSERT_TRUE(parser.next(course));
+    ASSERT_EQ(course.size(), 4u);
+    EXPECT_EQ(course.front().x, 0);
+    EXPECT_EQ(course[2].penalty, 6);
+    EXPECT_EQ(course.back().x, 250);
+    EXPECT_FALSE(parser.next(course));
+
+    CourseParser standard(input.data(), input.size());
+    ASSERT_TRUE(standard.next(course));
+    EXPECT_EQ(course.back().x, StandardCostModel::finish().x);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/reference_solver.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const fs::path kDataPath = fs::current_path() / "data/shearwater_challenge/";
+
+// Seed the checked-in generated/ data sets were written with.
+static constexpr uint64_t kGeneratedSeed = 2024;
+
+static vector<double> readAnswers(const fs::path &path)
+{
+    ifstream input(path);
+    vector<double> answers;
+    double answer;
+    while (input >> answer)
+    {
+        answers.push_back(answer);
+    }
+    return answers;
+}
+
+TEST(CourseGeneratorTest, SameSeedSameCourse)
+{
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        CourseGenerator a(42), b(42), c(43);
+        auto first = a.generate(profile, 200);
+        auto second = b.generate(profile, 200);
+        auto other = c.generate(profile, 200);
+        ASSERT_EQ(first.size(), second.size());
+        bool differs = false;
+        for (size_t i = 0; i < first.size(); ++i)
+        {
+            EXPECT_EQ(first[i].x, second[i].x);
+            EXPECT_EQ(first[i].y, second[i].y);
+            EXPECT_EQ(first[i].penalty, second[i].penalty);
+            differs |= first[i].x != other[i].x || first[i].y != other[i].y || first[i].penalty != other[i].penalty;
+        }
+        EXPECT_TRUE(differs) << profileName(profile);
+    }
+}
+
+TEST(CourseGeneratorTest, WaypointsAreValidAndUnique)
+{
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        for (int n : {1, 100, 1000, kFieldCells})
+        {
+            CourseGenerator generator(7);
+            auto course = generator.generate(profile, n);
+            ASSERT_EQ(n + 2, course.size());
+            EXPECT_EQ(0, course.front().x);
+            EXPECT_EQ(100, course.back().y);
+
+            set<pair<int, int>> positions;
+            for (int i = 1; i <= n; ++i)
+            {
+                EXPECT_GE(course[i].x, 1);
+                EXPECT_LE(course[i].x, 99);
+                EXPECT_GE(course[i].y, 1);
+                EXPECT_LE(course[i].y, 99);
+                EXPECT_GE(course[i].penalty, 1);
+                EXPECT_LE(course[i].penalty, 100);
+                positions.insert({course[i].x, course[i].y});
+            }
+            EXPECT_EQ(n, positions.size()) << profileName(profile) << " N=" << n;
+        }
+    }
+}
+
+TEST(CourseGeneratorTest, ReferenceSolverMatchesPublishedSamples)
+{
+    for (const char *size : {"small", "medium", "large"})
+    {
+        ifstream input(kDataPath / (string("sample_input_") + size + ".txt"));
+        auto courses = readCourses(input);
+        auto expected = readAnswers(kDataPath / (string("sample_output_") + size + ".txt"));
+        ASSERT_EQ(expected.size(), courses.size()) << size;
+        for (size_t i = 0; i < courses.size(); ++i)
+        {
+            EXPECT_EQ(formatAnswer(expected[i]), formatAnswer(referenceLowestTime(courses[i]))) << size << " course " << i;
+        }
+    }
+}
+
+TEST(CourseGeneratorTest, GeneratedDataIsReproducible)
+{
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        fs::path path = kDataPath / "generated" / (string("sample_input_") + profileName(profile) + ".txt");
+        ifstream input(path);
+        ASSERT_TRUE(input.is_open()) << path;
+        stringstream checked_in;
+        checked_in << input.rdbuf();
+
+        CourseGenerator generator(kGeneratedSeed);
+        vector<vector<Waypoint>> courses;
+        for (int c = 0; c < 3; ++c)
+        {
+            courses.push_back(generator.generate(profile, 1000));
+        }
+        stringstream regenerated;
+        writeCourses(regenerated, courses);
+        EXPECT_EQ(checked_in.str(), regenerated.str()) << path;
+    }
+}
+
+TEST(CourseGeneratorTest, OptimizerMatchesGeneratedOutputs)
+{
+    Optimizer optimizer;
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        string name = profileName(profile);
+        ifstream input(kDataPath / "generated" / ("sample_input_" + name + ".txt"));
+        auto courses = readCourses(input);
+        auto expected = readAnswers(kDataPath / "generated" / ("sample_output_" + name + ".txt"));
+        ASSERT_EQ(expected.size(), courses.size()) << name;
+        for (size_t i = 0; i < courses.size(); ++i)
+        {
+            EXPECT_EQ(formatAnswer(expected[i]), formatAnswer(optimizer.findLowestTime(courses[i]))) << name << " course " << i;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
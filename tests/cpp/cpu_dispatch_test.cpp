@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/cpu_dispatch.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+// Every level this host can run.
+static vector<CpuLevel> supportedLevels()
+{
+    vector<CpuLevel> levels;
+    for (int l = 0; l <= static_cast<int>(detectCpuLevel()); ++l)
+    {
+        levels.push_back(static_cast<CpuLevel>(l));
+    }
+    return levels;
+}
+
+TEST(CpuDispatchTest, LevelsParseAndOnlySupportedOnesCanBeSelected)
+{
+    for (int l = 0; l < kCpuLevelCount; ++l)
+    {
+        CpuLevel level;
+        ASSERT_TRUE(parseCpuLevel(cpuLevelName(static_cast<CpuLevel>(l)), level));
+        EXPECT_EQ(static_cast<int>(level), l);
+        EXPECT_EQ(selectCpuLevel(level), level <= detectCpuLevel());
+    }
+    CpuLevel level;
+    EXPECT_FALSE(parseCpuLevel("sse9", level));
+    ASSERT_TRUE(selectCpuLevel(detectCpuLevel()));
+    EXPECT_EQ(cpuKernels().level, detectCpuLevel());
+}
+
+TEST(CpuDispatchTest, LegTimesAndArgminAreIdenticalAtEveryLevel)
+{
+    mt19937 rng(71);
+    vector<Waypoint> points(300);
+    for (auto &point : points)
+    {
+        point = {static_cast<int>(rng() % 201) - 50, static_cast<int>(rng() % 201) - 50, 0};
+    }
+    points[7] = {2000000000, -2000000000, 0}; // differences beyond int, squares beyond 2^53
+    const CpuKernels &baseline = cpuKernels(CpuLevel::Baseline);
+    for (CpuLevel level : supportedLevels())
+    {
+        const CpuKernels &kernels = cpuKernels(level);
+        for (int begin : {0, 1, 6})
+        {
+            for (int end : {begin, begin + 3, begin + 9, begin + 17, 300})
+            {
+                for (double speed : {2.0, 3.0}) // multiplied by the reciprocal, divided
+                {
+                    vector<double> want(300), got(300);
+                    baseline.leg_times(&points[0].x, begin, end, 13, -2, speed, 10, want.data());
+                    kernels.leg_times(&points[0].x, begin, end, 13, -2, speed, 10, got.data());
+                    EXPECT_EQ(memcmp(want.data(), got.data(), (end - begin) * sizeof(double)), 0)
+                        << cpuLevelName(level) << " " << begin << ".." << end << " speed " << speed;
+                }
+            }
+        }
+
+        vector<double> values(100);
+        for (size_t count = 1; count <= values.size(); ++count)
+        {
+            for (auto &value : values)
+            {
+                value = rng() % 5 == 0 ? INFINITY : static_cast<double>(rng() % 9);
+            }
+            size_t want = 0;
+            for (size_t i = 1; i < count; ++i)
+            {
+                want = values[i] < values[want] ? i : want;
+            }
+            EXPECT_EQ(kernels.argmin(values.data(), count), want) << cpuLevelName(level) << " count=" << count;
+        }
+    }
+}
+
+TEST(CpuDispatchTest, TokenizerMatchesStreamParsingAtEveryLevel)
+{
+    CourseGenerator generator(71);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 40; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], 1 + c * 7));
+    }
+    ostringstream text;
+    writeCourses(text, courses);
+    string input = "\t" + text.str();
+    for (size_t at = input.find('\n'); at != string::npos; at = input.find('\n', at + 8))
+    {
+        input.insert(at, "  \r"); // odd whitespace runs straddling block boundaries
+    }
+    istringstream stream(input);
+    auto expected = readCourses(stream);
+    ASSERT_EQ(expected.size(), courses.size());
+
+    for (CpuLevel level : supportedLevels())
+    {
+        ASSERT_TRUE(selectCpuLevel(level));
+        CourseParser parser(input.data(), input.size());
+        vector<Waypoint> course;
+        for (const auto &want : expected)
+        {
+            ASSERT_TRUE(parser.next(course)) << cpuLevelName(level);
+            ASSERT_EQ(course.size(), want.size());
+            EXPECT_EQ(memcmp(course.data(), want.data(), want.size() * sizeof(Waypoint)), 0) << cpuLevelName(level);
+        }
+        EXPECT_FALSE(parser.next(course)); // the terminating 0
+
+        int values[8];
+        size_t used;
+        const CpuKernels &kernels = cpuKernels(level);
+        string edges = " -2147483648 2147483647\n007 -0 ";
+        EXPECT_EQ(kernels.parse_ints(edges.data(), edges.size(), values, 8, &used), 4u);
+        EXPECT_EQ(values[0], INT32_MIN);
+        EXPECT_EQ(values[1], INT32_MAX);
+        EXPECT_EQ(values[2], 7);
+        EXPECT_EQ(values[3], 0);
+        EXPECT_EQ(used, edges.size() - 1);
+        for (string bad : {"12 34x 5", "12 2147483648", "12 - 3", "12 +3"})
+        {
+            EXPECT_EQ(kernels.parse_ints(bad.data(), bad.size(), values, 8, &used), 1u) << bad;
+            EXPECT_EQ(used, 2u) << bad;
+        }
+        for (string truncated : {"2\n1 2 3\n4 5", "2000000000\n1 2 3\n0\n", "-5\n1 2 3\n"})
+        {
+            CourseParser short_parser(truncated.data(), truncated.size());
+            EXPECT_FALSE(short_parser.next(course)) << truncated;
+        }
+        string tight = "2\n1 2 3 4 5 6";
+        CourseParser tight_parser(tight.data(), tight.size());
+        EXPECT_TRUE(tight_parser.next(course));
+    }
+    selectCpuLevel(detectCpuLevel());
+}
+
+TEST(CpuDispatchTest, FormatterMatchesPrintfAtEveryLevel)
+{
+    mt19937_64 rng(71);
+    vector<double> values = {0, -0.0, 0.0005, 0.0015, 1.0005, 2.5, 0.1234995, 1e-300, -1.25, 1e15, 1e300, INFINITY, -INFINITY, NAN};
+    for (int i = 0; i < 20000; ++i)
+    {
+        values.push_back(static_cast<double>(rng() % 100000000) / 1000 + (rng() % 3) * 0.0005);
+        values.push_back(static_cast<double>(rng() % 1000000) * 0.01);
+    }
+    for (CpuLevel level : supportedLevels())
+    {
+        string output;
+        cpuKernels(level).format_fixed3(values.data(), values.size(), output);
+        istringstream lines(output);
+        string line;
+        for (double value : values)
+        {
+            ASSERT_TRUE(getline(lines, line));
+            ASSERT_EQ(line, formatAnswer(value)) << cpuLevelName(level);
+        }
+        EXPECT_FALSE(getline(lines, line));
+    }
+}
+
+TEST(CpuDispatchTest, OptimizerAnswersAreIdenticalAtEveryLevel)
+{
+    CourseGenerator generator(71);
+    vector<vector<Waypoint>> courses;
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        for (int n : {0, 1, 9, 150})
+        {
+            courses.push_back(generator.generate(profile, n));
+        }
+    }
+    vector<vector<double>> expected(kMemoryStrategyCount);
+    vector<vector<vector<int>>> expected_paths(kMemoryStrategyCount);
+    for (CpuLevel level : supportedLevels())
+    {
+        ASSERT_TRUE(selectCpuLevel(level));
+        for (int s = 0; s < kMemoryStrategyCount; ++s)
+        {
+            Optimizer optimizer;
+            for (size_t c = 0; c < courses.size(); ++c)
+            {
+                optimizer.setMemoryBudget(Optimizer::planMemory(courses[c].size() - 2, 0).bytes[s]);
+                double answer = optimizer.findLowestTime(courses[c]);
+                if (level == CpuLevel::Baseline)
+                {
+                    expected[s].push_back(answer);
+                    expected_paths[s].push_back(optimizer.optimalPath());
+                    continue;
+                }
+                EXPECT_EQ(memcmp(&answer, &expected[s][c], sizeof(double)), 0) << cpuLevelName(level) << " course " << c;
+                EXPECT_EQ(optimizer.optimalPath(), expected_paths[s][c]) << cpuLevelName(level) << " course " << c;
+            }
+        }
+    }
+    selectCpuLevel(detectCpuLevel());
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
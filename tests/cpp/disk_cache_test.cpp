@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/disk_cache.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+class DiskCacheTest : public ::testing::Test
+{
+protected:
+    string path = "/tmp/shearwater_disk_cache_test_" + to_string(getpid()) + ".bin";
+
+    void TearDown() override
+    {
+        remove(path.c_str());
+        remove((path + ".lock").c_str());
+    }
+
+    static vector<vector<Waypoint>> courses(int count, int waypoints)
+    {
+        CourseGenerator generator(2024);
+        vector<vector<Waypoint>> result;
+        for (int c = 0; c < count; ++c)
+        {
+            result.push_back(generator.generate(kAllCourseProfiles[c % 7], waypoints));
+        }
+        return result;
+    }
+};
+
+TEST_F(DiskCacheTest, AnswersAndPathsPersistAcrossProcesses)
+{
+    auto batch = courses(20, 100);
+    vector<double> expected;
+    vector<vector<int>> expected_paths;
+    {
+        DiskResultCache cache;
+        ASSERT_TRUE(cache.open(path)) << cache.error();
+        ASSERT_TRUE(cache.writable());
+        Optimizer optimizer;
+        for (const auto &course : batch)
+        {
+            expected.push_back(optimizer.findLowestTime(course));
+            expected_paths.push_back(optimizer.optimalPath());
+            cache.insert(course, expected.back(), optimizer.optimalPath());
+        }
+        EXPECT_EQ(cache.stats().entries, batch.size());
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        DiskResultCache cache;
+        bool ok = cache.open(path, false) && !cache.writable();
+        for (size_t c = 0; ok && c < batch.size(); ++c)
+        {
+            double answer;
+            vector<int> path;
+            ok = cache.lookup(batch[c], answer, &path) && answer == expected[c] && path == expected_paths[c];
+        }
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+TEST_F(DiskCacheTest, ChangedCourseMissesAndSecondWriterIsReadOnly)
+{
+    auto batch = courses(2, 50);
+    DiskResultCache writer;
+    ASSERT_TRUE(writer.open(path));
+    writer.insert(batch[0], 42.0, {0, 51});
+
+    DiskResultCache second;
+    ASSERT_TRUE(second.open(path));
+    EXPECT_FALSE(second.writable());
+    second.insert(batch[1], 1.0, {}); // ignored
+    double answer = 0;
+    EXPECT_TRUE(second.lookup(batch[0], answer));
+    EXPECT_EQ(answer, 42.0);
+    EXPECT_FALSE(second.lookup(batch[1], answer));
+
+    vector<Waypoint> changed = batch[0];
+    changed[10].penalty += 1;
+    EXPECT_FALSE(second.lookup(changed, answer));
+}
+
+TEST_F(DiskCacheTest, VersionStampMismatchInvalidatesTheFile)
+{
+    auto batch = courses(1, 30);
+    {
+        DiskResultCache cache;
+        ASSERT_TRUE(cache.open(path));
+        cache.insert(batch[0], 7.0, {});
+    }
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        uint32_t old_version = kSolverVersion - 1;
+        file.seekp(12); // magic, format, then the solver version
+        file.write(reinterpret_cast<const char *>(&old_version), sizeof(old_version));
+    }
+
+    DiskResultCache reader;
+    EXPECT_FALSE(reader.open(path, false));
+    EXPECT_NE(reader.error().find("stale"), string::npos);
+
+    DiskResultCache writer;
+    ASSERT_TRUE(writer.open(path));
+    double answer;
+    EXPECT_FALSE(writer.lookup(batch[0], answer));
+    EXPECT_EQ(writer.stats().entries, 0u);
+}
+
+TEST_F(DiskCacheTest, ForeignFilesAreNeverOverwritten)
+{
+    const string contents = "precious data, not a cache\n";
+    ofstream(path) << contents;
+    DiskResultCache writer;
+    EXPECT_FALSE(writer.open(path));
+    EXPECT_NE(writer.error().find("not a shearwater result cache"), string::npos) << writer.error();
+    ifstream file(path);
+    EXPECT_EQ(string(istreambuf_iterator<char>(file), istreambuf_iterator<char>()), contents);
+
+    ofstream(path, ios::trunc); // empty: not a cache either
+    EXPECT_FALSE(writer.open(path));
+    remove(path.c_str());
+    EXPECT_TRUE(writer.open(path)) << writer.error();
+    EXPECT_TRUE(writer.writable());
+}
+
+TEST_F(DiskCacheTest, GrowingKeepsEntriesAndReadersFollow)
+{
+    auto batch = courses(200, 20);
+    DiskResultCache writer;
+    ASSERT_TRUE(writer.open(path, true, 16));
+    writer.insert(batch[0], 0.0, {0, 21});
+
+    DiskResultCache reader;
+    ASSERT_TRUE(reader.open(path, false));
+    for (size_t c = 1; c < batch.size(); ++c)
+    {
+        writer.insert(batch[c], c, vector<int>(c % 21 + 1, static_cast<int>(c)));
+    }
+    EXPECT_GE(writer.stats().slots, 2 * batch.size());
+
+    // The writer flagged the file the reader maps as replaced; the next lookup switches.
+    double answer;
+    for (size_t c = 0; c < batch.size(); ++c)
+    {
+        vector<int> path;
+        ASSERT_TRUE(reader.lookup(batch[c], answer, &path));
+        EXPECT_EQ(answer, c);
+        EXPECT_EQ(path.size(), c == 0 ? 2 : c % 21 + 1);
+    }
+}
+
+TEST_F(DiskCacheTest, DamagedSlotsAreMissesNotCrashes)
+{
+    auto batch = courses(2, 20);
+    {
+        DiskResultCache writer;
+        ASSERT_TRUE(writer.open(path, true, 16));
+        writer.insert(batch[0], 3.0, {0, 21});
+    }
+    fstream file(path, ios::in | ios::out | ios::binary);
+    const long kSlots = 4096, kSlotBytes = 32;
+    for (long i = 0; i < 16; ++i)
+    {
+        uint64_t key;
+        file.seekg(kSlots + i * kSlotBytes);
+        file.read(reinterpret_cast<char *>(&key), sizeof(key));
+        if (key != 0)
+        {
+            uint32_t offset = 0xfffffff0u; // path_offset, far past the mapping
+            file.seekp(kSlots + i * kSlotBytes + 24);
+            file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+        }
+    }
+    file.flush();
+
+    DiskResultCache reader;
+    ASSERT_TRUE(reader.open(path, false));
+    double answer;
+    vector<int> stored;
+    EXPECT_FALSE(reader.lookup(batch[0], answer, &stored));
+
+    // Every slot taken: probing must stop rather than loop.
+    for (long i = 0; i < 16; ++i)
+    {
+        uint64_t key = 0x9e3779b97f4a7c15ull + i;
+        file.seekp(kSlots + i * kSlotBytes);
+        file.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    }
+    file.flush();
+    EXPECT_FALSE(reader.lookup(batch[1], answer));
+
+    DiskResultCache writer;
+    ASSERT_TRUE(writer.open(path));
+    writer.insert(batch[1], 4.0, {0, 21});
+    ASSERT_TRUE(writer.lookup(batch[1], answer));
+    EXPECT_EQ(answer, 4.0);
+}
+
+TEST_F(DiskCacheTest, SecondBatchRunSolvesNothing)
+{
+    auto batch = courses(40, 60);
+    vector<double> expected = BatchSolver(1).solve(batch);
+    for (int run = 0; run < 2; ++run)
+    {
+        DiskResultCache cache;
+        ASSERT_TRUE(cache.open(path));
+        BatchSolver solver(4);
+        solver.setDiskCache(&cache);
+        EXPECT_EQ(solver.solve(batch), expected);
+        EXPECT_EQ(cache.stats().hits, run == 0 ? 0u : batch.size());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
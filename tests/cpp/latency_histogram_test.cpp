@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/latency_histogram.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+TEST(LatencyHistogramTest, BucketsBoundRelativeError)
+{
+    for (uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456ull, 987654321ull, 1ull << 40})
+    {
+        int bucket = LatencyHistogram::bucketOf(value);
+        uint64_t upper = LatencyHistogram::upperBoundOf(bucket);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / 32) << value;
+        if (bucket > 0)
+        {
+            EXPECT_LT(LatencyHistogram::upperBoundOf(bucket - 1), value) << value;
+        }
+    }
+}
+
+TEST(LatencyHistogramTest, PercentilesOfUniformValues)
+{
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 10000; ++v)
+    {
+        histogram.record(v * 1000);
+    }
+    EXPECT_EQ(10000u, histogram.count());
+    EXPECT_NEAR(5000000.0, histogram.percentile(50), 5000000.0 * 0.035);
+    EXPECT_NEAR(9900000.0, histogram.percentile(99), 9900000.0 * 0.035);
+    EXPECT_NEAR(9990000.0, histogram.percentile(99.9), 9990000.0 * 0.035);
+    EXPECT_EQ(10000000u, histogram.percentile(100));
+    EXPECT_EQ(1000u, histogram.min());
+    EXPECT_DOUBLE_EQ(5000500.0, histogram.mean());
+}
+
+TEST(LatencyHistogramTest, MergeEqualsRecordingEverything)
+{
+    LatencyHistogram all, even, odd;
+    for (uint64_t v = 0; v < 5000; ++v)
+    {
+        all.record(v * 37);
+        (v % 2 ? odd : even).record(v * 37);
+    }
+    even.merge(odd);
+    for (double p : {1.0, 50.0, 90.0, 99.0, 99.9})
+    {
+        EXPECT_EQ(all.percentile(p), even.percentile(p)) << p;
+    }
+    EXPECT_EQ(all.count(), even.count());
+    EXPECT_EQ(all.max(), even.max());
+}
+
+TEST(LatencyRecorderTest, GroupsBySizeAndKeepsSlowest)
+{
+    LatencyRecorder recorder;
+    for (size_t c = 0; c < 100; ++c)
+    {
+        recorder.record(SolvePhase::Solve, c, c < 50 ? 10 : 1000, c * 100);
+    }
+    recorder.record(SolvePhase::Parse, 0, 10, 5);
+
+    EXPECT_EQ(50u, recorder.solveBySize(LatencyRecorder::sizeClassOf(10)).count());
+    EXPECT_EQ(50u, recorder.solveBySize(LatencyRecorder::sizeClassOf(1000)).count());
+    EXPECT_EQ(1u, recorder.phase(SolvePhase::Parse).count());
+
+    auto slowest = recorder.slowest();
+    ASSERT_EQ(static_cast<size_t>(LatencyRecorder::kSlowestKept), slowest.size());
+    EXPECT_EQ(99u, slowest[0].course);
+    EXPECT_EQ(1000u, slowest[0].waypoints);
+    EXPECT_EQ(95u, slowest.back().course);
+
+    ostringstream report;
+    recorder.report(report);
+    EXPECT_NE(string::npos, report.str().find("512-1023"));
+    EXPECT_NE(string::npos, report.str().find("course 99 N=1000"));
+}
+
+TEST(BatchSolverTest, ThreadsAgreeWithSequentialAndRecordEveryCourse)
+{
+    CourseGenerator generator(31);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 40; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], 20 + c * 5));
+    }
+
+    Optimizer optimizer;
+    vector<double> expected;
+    for (const auto &course : courses)
+    {
+        expected.push_back(optimizer.findLowestTime(course));
+    }
+
+    for (int threads : {1, 4})
+    {
+        LatencyRecorder latencies;
+        BatchSolver solver(threads);
+        solver.setLatencyRecorder(&latencies);
+        EXPECT_EQ(expected, solver.solve(courses)) << threads;
+        EXPECT_EQ(courses.size(), latencies.phase(SolvePhase::Solve).count());
+
+        // A second batch adds to the attached recorder rather than replacing it.
+        solver.solve(courses);
+        EXPECT_EQ(2 * courses.size(), latencies.phase(SolvePhase::Solve).count());
+    }
+}
+
+static int threadCount()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+    {
+        if (line.rfind("Threads:", 0) == 0)
+        {
+            return stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+TEST(BatchSolverTest, WorkersPersistAcrossBatches)
+{
+    CourseGenerator generator(32);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 12; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], 30));
+    }
+    const int before = threadCount();
+    {
+        BatchSolver solver(4);
+        const vector<double> first = solver.solve(courses);
+        EXPECT_EQ(before + 3, threadCount()); // the caller is worker 0
+        for (int batch = 0; batch < 50; ++batch)
+        {
+            ASSERT_EQ(first, solver.solve(courses));
+        }
+        EXPECT_EQ(before + 3, threadCount());
+    }
+    EXPECT_EQ(before, threadCount());
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
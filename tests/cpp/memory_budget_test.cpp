@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "shearwater/alloc_tracker.h"
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/tuning_profile.h"
+
+SHEARWATER_DEFINE_ALLOCATION_HOOKS
+
+using namespace std;
+
+static size_t strategyBytes(int waypoints, MemoryStrategy strategy)
+{
+    return Optimizer::planMemory(waypoints, 0).bytes[static_cast<int>(strategy)];
+}
+
+TEST(MemoryBudgetTest, EveryStrategyFindsTheSameLowestTime)
+{
+    CourseGenerator generator(2024);
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        for (int n : {0, 1, 2, 17, 300})
+        {
+            vector<Waypoint> course = generator.generate(profile, n);
+            Optimizer full;
+            const double expected = full.findLowestTime(course);
+            for (int s = 0; s < kMemoryStrategyCount; ++s)
+            {
+                Optimizer optimizer;
+                optimizer.setMemoryBudget(strategyBytes(n, static_cast<MemoryStrategy>(s)));
+                double answer = optimizer.findLowestTime(course);
+                ASSERT_EQ(static_cast<int>(optimizer.memoryPlan().strategy), s);
+                EXPECT_NEAR(answer, expected, 1e-9) << profileName(profile) << " n=" << n << " " << memoryStrategyName(static_cast<MemoryStrategy>(s));
+
+                const vector<int> &path = optimizer.optimalPath();
+                if (static_cast<MemoryStrategy>(s) == MemoryStrategy::ScoreOnly)
+                {
+                    EXPECT_TRUE(path.empty());
+                    continue;
+                }
+                ASSERT_GE(path.size(), 2u);
+                EXPECT_EQ(path.front(), 0);
+                EXPECT_EQ(path.back(), n + 1);
+                for (size_t i = 1; i < path.size(); ++i)
+                {
+                    EXPECT_LT(path[i - 1], path[i]);
+                }
+            }
+        }
+    }
+}
+
+TEST(MemoryBudgetTest, ForcedStrategyKeepsTheWorkspaceWarm)
+{
+    CourseGenerator generator(7);
+    vector<Waypoint> course = generator.generate(CourseProfile::Uniform, 200);
+    const double expected = Optimizer().findLowestTime(course);
+    for (int s = 0; s < kMemoryStrategyCount; ++s)
+    {
+        Optimizer optimizer;
+        optimizer.forceStrategy(static_cast<MemoryStrategy>(s));
+        optimizer.findLowestTime(course);
+
+        // Unlike a budget of exactly the strategy's worst case, nothing is released and regrown.
+        AllocationScope scope;
+        const double answer = optimizer.findLowestTime(course);
+        EXPECT_EQ(0u, scope.counts().allocations) << memoryStrategyName(static_cast<MemoryStrategy>(s));
+        EXPECT_NEAR(answer, expected, 1e-9);
+        EXPECT_EQ(static_cast<int>(optimizer.memoryPlan().strategy), s);
+    }
+}
+
+TEST(MemoryBudgetTest, PlanPicksTheFastestStrategyThatFitsAndSaysWhy)
+{
+    MemoryPlan unlimited = Optimizer::planMemory(1000, 0);
+    EXPECT_EQ(unlimited.strategy, MemoryStrategy::Full);
+    EXPECT_EQ(unlimited.describe(), "full: no memory budget");
+    for (int s = 1; s < kMemoryStrategyCount; ++s)
+    {
+        EXPECT_LT(unlimited.bytes[s], unlimited.bytes[s - 1]);
+    }
+
+    MemoryPlan compact = Optimizer::planMemory(1000, 1 << 20);
+    EXPECT_EQ(compact.strategy, MemoryStrategy::Compact);
+    EXPECT_TRUE(compact.fits);
+    EXPECT_EQ(compact.describe().rfind("compact: full needs 11.5 MB (worst-case heap), over the 1.0 MB budget; compact needs", 0), 0u)
+        << compact.describe();
+
+    MemoryPlan score = Optimizer::planMemory(1000, strategyBytes(1000, MemoryStrategy::ScoreOnly));
+    EXPECT_EQ(score.strategy, MemoryStrategy::ScoreOnly);
+    EXPECT_NE(score.describe().find("no optimal path"), string::npos);
+
+    Optimizer optimizer;
+    optimizer.setMemoryBudget(64);
+    CourseGenerator generator(1);
+    EXPECT_TRUE(std::isnan(optimizer.findLowestTime(generator.generate(CourseProfile::Uniform, 1000))));
+    EXPECT_FALSE(optimizer.memoryPlan().fits);
+    EXPECT_NE(optimizer.memoryPlan().describe().find("course refused"), string::npos);
+}
+
+TEST(MemoryBudgetTest, PeakWorkspaceStaysWithinTheBudget)
+{
+    CourseGenerator generator(7);
+    vector<Waypoint> large = generator.generate(CourseProfile::MaxPenalty, 1000);
+    vector<Waypoint> small = generator.generate(CourseProfile::Uniform, 50);
+    for (size_t budget : {size_t(64) << 20, size_t(1) << 20, size_t(12) << 10})
+    {
+        Optimizer optimizer;
+        optimizer.setMemoryBudget(budget);
+        AllocationScope scope;
+        optimizer.findLowestTime(small); // full at every budget here; leaves workspace behind
+        optimizer.findLowestTime(large);
+        EXPECT_LE(scope.counts().peak_live_bytes, static_cast<int64_t>(budget)) << optimizer.memoryPlan().describe();
+    }
+}
+
+TEST(MemoryBudgetTest, BatchSolverReportsPlansPerCourse)
+{
+    CourseGenerator generator(3);
+    vector<vector<Waypoint>> courses = {generator.generate(CourseProfile::Uniform, 20), generator.generate(CourseProfile::Uniform, 2000)};
+    BatchSolver solver(2);
+    solver.setMemoryBudget(4 << 20);
+    vector<double> answers = solver.solve(courses);
+    ASSERT_EQ(solver.memoryPlans().size(), 2u);
+    EXPECT_EQ(solver.memoryPlans()[0].strategy, MemoryStrategy::Full);
+    EXPECT_EQ(solver.memoryPlans()[1].strategy, MemoryStrategy::Compact);
+    EXPECT_NEAR(answers[1], Optimizer().findLowestTime(courses[1]), 1e-9);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
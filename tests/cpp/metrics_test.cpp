@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/metrics.h"
+#include "shearwater/metrics_exporter.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+static string exposition(const SolverMetrics &metrics)
+{
+    ostringstream output;
+    metrics.writePrometheus(output);
+    return output.str();
+}
+
+static bool hasLine(const string &text, const string &line)
+{
+    return ("\n" + text).find("\n" + line + "\n") != string::npos;
+}
+
+TEST(MetricsTest, HistogramBucketsAreCumulativeAndEndInCount)
+{
+    PrometheusHistogram histogram({1000, 10000});
+    for (uint64_t ns : {500, 1000, 1001, 9000, 20000})
+    {
+        histogram.observe(ns);
+    }
+    ostringstream output;
+    histogram.write(output, "h", "help");
+    string text = output.str();
+    EXPECT_TRUE(hasLine(text, "# TYPE h histogram"));
+    EXPECT_TRUE(hasLine(text, "h_bucket{le=\"1e-06\"} 2"));
+    EXPECT_TRUE(hasLine(text, "h_bucket{le=\"1e-05\"} 4"));
+    EXPECT_TRUE(hasLine(text, "h_bucket{le=\"+Inf\"} 5"));
+    EXPECT_TRUE(hasLine(text, "h_count 5"));
+    EXPECT_TRUE(hasLine(text, "h_sum 3.1501e-05"));
+}
+
+TEST(MetricsTest, ConcurrentBatchSolvesAreAllCounted)
+{
+    CourseGenerator generator(64);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 200; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], c % 30));
+    }
+    SolverMetrics metrics;
+    BatchSolver solver(4);
+    solver.setMetrics(&metrics);
+    solver.solve(courses);
+    solver.solve(courses);
+    metrics.recordError(SolveError::Oversized);
+
+    size_t waypoints = 0;
+    for (const auto &course : courses)
+    {
+        waypoints += course.size() - 2;
+    }
+    string text = exposition(metrics);
+    EXPECT_TRUE(hasLine(text, "shearwater_courses_solved_total 400"));
+    EXPECT_TRUE(hasLine(text, "shearwater_waypoints_processed_total " + to_string(2 * waypoints)));
+    EXPECT_TRUE(hasLine(text, "shearwater_solve_duration_seconds_count 400"));
+    EXPECT_TRUE(hasLine(text, "shearwater_errors_total{kind=\"oversized\"} 1"));
+    EXPECT_TRUE(hasLine(text, "shearwater_errors_total{kind=\"malformed_request\"} 0"));
+}
+
+TEST(MetricsTest, TextfileIsReplacedWhole)
+{
+    SolverMetrics metrics;
+    metrics.recordSolve(10, 5000, SolverStats());
+    const string path = "/tmp/shearwater_metrics_test_" + to_string(::getpid()) + ".prom";
+    {
+        MetricsTextfile textfile(metrics, path, chrono::milliseconds(5));
+        this_thread::sleep_for(chrono::milliseconds(20));
+        metrics.recordSolve(10, 5000, SolverStats());
+    }
+    ifstream input(path);
+    stringstream contents;
+    contents << input.rdbuf();
+    EXPECT_TRUE(hasLine(contents.str(), "shearwater_courses_solved_total 2"));
+    EXPECT_FALSE(ifstream(path + ".tmp").good());
+    ::unlink(path.c_str());
+}
+
+TEST(MetricsTest, HttpEndpointServesTheExposition)
+{
+    SolverMetrics metrics;
+    metrics.recordSolve(3, 1500, SolverStats());
+    MetricsHttpServer server(metrics);
+    ASSERT_TRUE(server.start(0)) << server.error();
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(server.port()));
+    ASSERT_EQ(0, ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)));
+    string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_TRUE(sendAll(fd, request.data(), request.size()));
+    string response;
+    char buffer[4096];
+    ssize_t got;
+    while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        response.append(buffer, got);
+    }
+    ::close(fd);
+
+    EXPECT_EQ(0u, response.find("HTTP/1.0 200 OK\r\n"));
+    EXPECT_NE(string::npos, response.find("Content-Type: text/plain; version=0.0.4"));
+    EXPECT_NE(string::npos, response.find("\nshearwater_courses_solved_total 1\n"));
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
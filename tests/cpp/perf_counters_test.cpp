@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/perf_counters.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+TEST(PerfCountersTest, ReadsAreMonotonicOrZero)
+{
+    PerfCounters counters;
+    PerfSample before = counters.read();
+    volatile double sink = 0;
+    for (int i = 0; i < 1000000; ++i)
+    {
+        sink = sink + i * 0.5;
+    }
+    PerfSample after = counters.read();
+    for (int e = 0; e < kPerfEventCount; ++e)
+    {
+        if (counters.available(static_cast<PerfEvent>(e)))
+        {
+            EXPECT_GE(after.values[e], before.values[e]) << perfEventName(static_cast<PerfEvent>(e));
+        }
+        else
+        {
+            EXPECT_EQ(0u, after.values[e]) << perfEventName(static_cast<PerfEvent>(e));
+            EXPECT_FALSE(counters.unavailableReason().empty());
+        }
+    }
+}
+
+TEST(PerfCountersTest, OptimizerAttributesPhases)
+{
+    PhaseCounters phases;
+    Optimizer optimizer;
+    optimizer.setPhaseCounters(&phases);
+
+    CourseGenerator generator(5);
+    auto course = generator.generate(CourseProfile::Uniform, 500);
+    double with_counters = optimizer.findLowestTime(course);
+    phases.enter(SolvePhase::Format);
+    phases.stop();
+
+    optimizer.setPhaseCounters(nullptr);
+    EXPECT_EQ(optimizer.findLowestTime(course), with_counters);
+
+    if (phases.perf().available(PerfEvent::TaskClock))
+    {
+        EXPECT_GT(phases.total(SolvePhase::Solve)[PerfEvent::TaskClock], phases.total(SolvePhase::Preprocess)[PerfEvent::TaskClock]);
+    }
+    if (phases.perf().available(PerfEvent::Instructions))
+    {
+        EXPECT_GT(phases.total(SolvePhase::Solve)[PerfEvent::Instructions], 0u);
+    }
+    EXPECT_EQ(0u, phases.total(SolvePhase::Parse)[PerfEvent::TaskClock]);
+
+    ostringstream report;
+    phases.report(report);
+    for (const char *phase : {"parse", "preprocess", "solve", "format"})
+    {
+        EXPECT_NE(string::npos, report.str().find(phase)) << report.str();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
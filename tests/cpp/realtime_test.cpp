@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <vector>
+
+#include "shearwater/alloc_tracker.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/realtime.h"
+#include "shearwater/reference_solver.h"
+#include "shearwater/tuning_profile.h"
+
+SHEARWATER_DEFINE_ALLOCATION_HOOKS
+
+using namespace std;
+
+static constexpr int kMaxWaypoints = 300;
+
+static vector<vector<Waypoint>> mixedCourses()
+{
+    CourseGenerator generator(63);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 50; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], (c * 37) % (kMaxWaypoints + 1)));
+    }
+    courses.push_back(generator.generate(CourseProfile::MaxPenalty, kMaxWaypoints));
+    return courses;
+}
+
+TEST(RealtimeTest, PreparedSolverAnswersLikeTheReference)
+{
+    RealtimeSolver solver;
+    RealtimeOptions options;
+    options.max_waypoints = kMaxWaypoints;
+    options.lock_memory = false;
+    solver.prepare(options);
+    for (const auto &course : mixedCourses())
+    {
+        double answer = 0.0;
+        ASSERT_TRUE(solver.solve(course, answer));
+        EXPECT_NEAR(referenceLowestTime(course), answer, 1e-6);
+    }
+}
+
+TEST(RealtimeTest, SolvesNeitherAllocateNorFault)
+{
+    RealtimeSolver solver;
+    RealtimeOptions options;
+    options.max_waypoints = kMaxWaypoints;
+    options.cpu = 0;
+    cpu_set_t saved_cpus; // prepare() pins this thread; later tests must not run pinned
+    ASSERT_EQ(0, ::pthread_getaffinity_np(::pthread_self(), sizeof(saved_cpus), &saved_cpus));
+    RealtimeStatus status = solver.prepare(options);
+    cout << "memory locked: " << status.memory_locked << ", pinned: " << status.pinned << "\n"
+         << status.problems;
+
+    auto courses = mixedCourses(); // allocated before measuring
+    double answer = 0.0;
+    long faults = threadPageFaults();
+    AllocationScope scope;
+    for (int round = 0; round < 5; ++round)
+    {
+        for (const auto &course : courses)
+        {
+            solver.solve(course, answer);
+        }
+    }
+    AllocationCounts counts = scope.counts();
+    faults = threadPageFaults() - faults;
+    EXPECT_EQ(0u, counts.allocations);
+    EXPECT_EQ(0, faults);
+    ::munlockall();
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(saved_cpus), &saved_cpus);
+}
+
+TEST(RealtimeTest, OversizedCoursesAndUnpreparedSolverAreRefused)
+{
+    RealtimeSolver solver;
+    CourseGenerator generator(1);
+    double answer = 0.0;
+    EXPECT_FALSE(solver.solve(generator.generate(CourseProfile::Uniform, 10), answer));
+
+    RealtimeOptions options;
+    options.max_waypoints = 10;
+    options.lock_memory = false;
+    solver.prepare(options);
+    EXPECT_TRUE(solver.solve(generator.generate(CourseProfile::Uniform, 10), answer));
+    EXPECT_FALSE(solver.solve(generator.generate(CourseProfile::Uniform, 11), answer));
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/metrics.h"
+#include "shearwater/result_cache.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+TEST(ResultCacheTest, RepeatedCourseIsAHitWithTheSolvedAnswerAndPath)
+{
+    CourseGenerator generator(7);
+    vector<Waypoint> course = generator.generate(CourseProfile::Uniform, 200);
+    Optimizer optimizer;
+    double expected = optimizer.findLowestTime(course);
+    vector<int> expected_path = optimizer.optimalPath();
+
+    ResultCache cache(1 << 20, true);
+    EXPECT_EQ(cache.findLowestTime(optimizer, course), expected);
+    double answer = 0;
+    const vector<int> *path = nullptr;
+    ASSERT_TRUE(cache.lookup(course, answer, &path));
+    EXPECT_EQ(answer, expected);
+    ASSERT_NE(path, nullptr);
+    EXPECT_EQ(*path, expected_path);
+
+    ResultCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_GT(stats.bytes, course.size() * sizeof(Waypoint));
+}
+
+TEST(ResultCacheTest, HashCoversEveryFieldAndTheOrder)
+{
+    CourseGenerator generator(11);
+    vector<Waypoint> course = generator.generate(CourseProfile::Clustered, 37);
+    const uint64_t hash = hashWaypoints(course.data(), course.size());
+
+    vector<Waypoint> changed = course;
+    changed[5].penalty += 1;
+    EXPECT_NE(hashWaypoints(changed.data(), changed.size()), hash);
+    changed = course;
+    swap(changed[3], changed[4]);
+    EXPECT_NE(hashWaypoints(changed.data(), changed.size()), hash);
+    changed = course;
+    changed.pop_back();
+    EXPECT_NE(hashWaypoints(changed.data(), changed.size()), hash);
+
+    ResultCache cache(1 << 20);
+    cache.insert(course, 1.0, {});
+    double answer;
+    changed = course;
+    changed[20].x ^= 1;
+    EXPECT_FALSE(cache.lookup(changed, answer));
+    EXPECT_TRUE(cache.lookup(course, answer));
+}
+
+TEST(ResultCacheTest, LeastRecentlyUsedIsEvictedToStayWithinBudget)
+{
+    CourseGenerator generator(3);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 3; ++c)
+    {
+        courses.push_back(generator.generate(CourseProfile::Uniform, 100));
+    }
+    ResultCache probe(1 << 20);
+    probe.insert(courses[0], 0, {});
+    const size_t entry_bytes = probe.stats().bytes;
+
+    ResultCache cache(2 * entry_bytes);
+    double answer;
+    cache.insert(courses[0], 0, {});
+    cache.insert(courses[1], 1, {});
+    ASSERT_TRUE(cache.lookup(courses[0], answer)); // courses[1] is now least recently used
+    cache.insert(courses[2], 2, {});
+
+    EXPECT_TRUE(cache.lookup(courses[0], answer));
+    EXPECT_EQ(answer, 0);
+    EXPECT_FALSE(cache.lookup(courses[1], answer));
+    EXPECT_TRUE(cache.lookup(courses[2], answer));
+    EXPECT_EQ(answer, 2);
+    ResultCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_LE(stats.bytes, 2 * entry_bytes);
+
+    ResultCache tiny(entry_bytes - 1); // nothing fits
+    tiny.insert(courses[0], 0, {});
+    EXPECT_EQ(tiny.stats().entries, 0u);
+}
+
+TEST(ResultCacheTest, CachedBatchSolveMatchesUncachedAndCountsHits)
+{
+    CourseGenerator generator(64);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 50; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], c % 25));
+    }
+    vector<double> expected = BatchSolver(1).solve(courses);
+
+    SolverMetrics metrics;
+    BatchSolver solver(1);
+    solver.setMetrics(&metrics);
+    solver.enableCache(1 << 20);
+    EXPECT_EQ(solver.solve(courses), expected);
+    EXPECT_EQ(solver.solve(courses), expected);
+
+    // Small generated courses can repeat within the batch, so some first-pass lookups hit too.
+    ResultCacheStats stats = solver.cacheStats();
+    EXPECT_EQ(stats.hits + stats.misses, 2 * courses.size());
+    EXPECT_GE(stats.hits, courses.size());
+    ostringstream output;
+    metrics.writePrometheus(output);
+    EXPECT_NE(output.str().find("shearwater_cache_lookups_total{result=\"hit\"} " + to_string(stats.hits) + "\n"), string::npos);
+    EXPECT_NE(output.str().find("shearwater_cache_lookups_total{result=\"miss\"} " + to_string(stats.misses) + "\n"), string::npos);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
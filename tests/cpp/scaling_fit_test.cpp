@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#include "shearwater/scaling_fit.h"
+
+TEST(ScalingFitTest, RecoversExponentOfExactPowerLaw)
+{
+    std::vector<double> x, y;
+    for (double n = 128; n <= 4096; n *= 2)
+    {
+        x.push_back(n);
+        y.push_back(3e-9 * n * n);
+    }
+    ScalingFit fit = fitPowerLaw(x, y);
+    EXPECT_NEAR(fit.exponent, 2.0, 1e-9);
+    EXPECT_NEAR(fit.r_squared, 1.0, 1e-9);
+}
+
+TEST(ScalingFitTest, LogFactorShowsAsSmallExcessExponent)
+{
+    std::vector<double> x, y;
+    for (double n = 128; n <= 2048; n *= 2)
+    {
+        x.push_back(n);
+        y.push_back(n * std::log2(n));
+    }
+    ScalingFit fit = fitPowerLaw(x, y);
+    EXPECT_GT(fit.exponent, 1.0);
+    EXPECT_LT(fit.exponent, 1.2);
+}
+
+TEST(ScalingFitTest, TooFewPointsGiveNoFit)
+{
+    ScalingFit fit = fitPowerLaw({10.0}, {1.0});
+    EXPECT_EQ(fit.exponent, 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/shadow_comparator.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+static vector<vector<Waypoint>> batch(int count, int waypoints)
+{
+    CourseGenerator generator(17);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < count; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], waypoints));
+    }
+    return courses;
+}
+
+TEST(ShadowComparatorTest, AgreeingEnginesHaveNoMismatches)
+{
+    auto courses = batch(30, 80);
+    for (const char *name : {"reference", "full", "compact", "reconstruct", "score_only", "search", "dense", "windowed", "simd_batch"})
+    {
+        ShadowEngine engine;
+        ASSERT_TRUE(shadowEngineByName(name, engine));
+        ostringstream log;
+        ShadowOptions options;
+        options.sample_rate = 1.0;
+        options.queue_capacity = courses.size();
+        ShadowComparator shadow(engine, options, &log);
+        BatchSolver solver(2);
+        solver.setShadow(&shadow);
+        solver.solve(courses);
+        shadow.drain();
+
+        ShadowCounters counters = shadow.counters();
+        EXPECT_EQ(counters.offered, courses.size()) << name;
+        EXPECT_EQ(counters.compared + counters.dropped, courses.size()) << name;
+        EXPECT_EQ(counters.mismatches, 0u) << name;
+        EXPECT_TRUE(log.str().empty()) << name;
+    }
+    ShadowEngine engine;
+    EXPECT_FALSE(shadowEngineByName("fastest", engine));
+}
+
+TEST(ShadowComparatorTest, MismatchesAreLoggedWithAReplayableCourse)
+{
+    auto courses = batch(5, 20);
+    ostringstream log;
+    ShadowOptions options;
+    options.sample_rate = 1.0;
+    ShadowComparator shadow([](const vector<Waypoint> &course)
+                            { return referenceLowestTime(course) + (course.size() == 22 ? 0.5 : 0.0); },
+                            options, &log);
+    Optimizer optimizer;
+    for (size_t c = 0; c < courses.size(); ++c)
+    {
+        shadow.offer(c, courses[c], optimizer.findLowestTime(courses[c]), 1000);
+    }
+    shadow.offer(99, batch(1, 7)[0], 1.0, 1000); // wrong primary answer, the shadow is right
+    shadow.drain();
+    EXPECT_EQ(shadow.counters().mismatches, courses.size() + 1);
+
+    string text = log.str();
+    EXPECT_NE(text.find("# mismatch course=0 waypoints=20 primary="), string::npos) << text;
+    EXPECT_NE(text.find("# mismatch course=99 waypoints=7 primary=1.000 shadow="), string::npos) << text;
+    istringstream lines(text);
+    string line;
+    ostringstream replay;
+    while (getline(lines, line))
+    {
+        if (line.empty() || line[0] != '#')
+        {
+            replay << line << "\n";
+        }
+    }
+    replay << "0\n";
+    istringstream input(replay.str());
+    auto logged = readCourses(input);
+    ASSERT_EQ(logged.size(), courses.size() + 1);
+    EXPECT_EQ(logged[0].size(), courses[0].size());
+    for (size_t i = 0; i < courses[0].size(); ++i)
+    {
+        EXPECT_EQ(logged[0][i].x, courses[0][i].x);
+        EXPECT_EQ(logged[0][i].penalty, courses[0][i].penalty);
+    }
+}
+
+TEST(ShadowComparatorTest, SampleRateSelectsAStableFractionOfCourses)
+{
+    auto courses = batch(2000, 5);
+    auto sampledCount = [&](double rate)
+    {
+        ShadowOptions options;
+        options.sample_rate = rate;
+        ShadowComparator shadow([](const vector<Waypoint> &)
+                                { return 0.0; },
+                                options);
+        for (size_t c = 0; c < courses.size(); ++c)
+        {
+            shadow.offer(c, courses[c], 0.0, 0);
+        }
+        return shadow.counters().sampled;
+    };
+    uint64_t quarter = sampledCount(0.25);
+    EXPECT_GT(quarter, 400u);
+    EXPECT_LT(quarter, 600u);
+    EXPECT_EQ(sampledCount(0.25), quarter); // the same courses every time
+    EXPECT_EQ(sampledCount(0.0), 0u);
+    EXPECT_EQ(sampledCount(1.0), courses.size());
+}
+
+TEST(ShadowComparatorTest, SlowCandidateDropsSamplesInsteadOfBlocking)
+{
+    auto courses = batch(200, 10);
+    ShadowOptions options;
+    options.sample_rate = 1.0;
+    options.queue_capacity = 2;
+    ShadowComparator shadow([](const vector<Waypoint> &)
+                            {
+                                this_thread::sleep_for(chrono::milliseconds(20));
+                                return 0.0; },
+                            options);
+    auto start = chrono::steady_clock::now();
+    for (size_t c = 0; c < courses.size(); ++c)
+    {
+        shadow.offer(c, courses[c], 0.0, 0);
+    }
+    auto elapsed = chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, chrono::milliseconds(100)); // 200 candidate runs would take 4 s
+    ShadowCounters counters = shadow.counters();
+    EXPECT_EQ(counters.sampled, courses.size());
+    EXPECT_GE(counters.dropped, courses.size() - 4);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,237 +1,20 @@
 #include <gtest/gtest.h>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <vector>
-#include <queue>
-#include <unordered_map>
+
+#include "shearwater/course_io.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/tuning_profile.h"
 
 using namespace std;
 namespace fs = std::filesystem;
 
-struct Waypoint
-{
-    int x;
-    int y;
-    int penalty;
-};
-
-struct State
-{
-    int x;
-    int y;
-    int idx;
-    double cost;
-    vector<int> path;
-};
-
-class Optimizer
-{
-public:
-    /**
-        This algorithm efficiently explores potential paths through the waypoints,
-        considering various factors such as travel time, penalties, and constraints,
-        to determine the path that minimizes the overall time required.
-        According to the expected lowest traversal times given as part of the data set,
-        it seems that there are cases where either the optimal path is sub-optimal or
-        the skipped waypoints penalties are not accounted for properly or per spec.
-
-        Initialization:
-
-        Start with an initial cost of 0.0.
-        Determine the total number of waypoints.
-        Initialize data structures to keep track of visited waypoints, the optimal path found so far, and a
-        priority queue to explore potential paths. Additionally, set up memoization to store calculated costs.
-        Start with the Initial Waypoint:
-
-        Begin at the starting waypoint and add it to the priority queue with its associated cost.
-        Exploring Potential Paths:
-
-        Continuously explore potential paths until all waypoints have been visited.
-        At each step:
-        Select the most promising waypoint from the priority queue.
-        Check if this waypoint has already been visited. If so, skip it and move to the next potential waypoint.
-        Otherwise, mark it as visited.
-        If the selected waypoint is the ending waypoint, store the current path as the optimal path and terminate
-        the exploration.
-        Otherwise, evaluate all possible next waypoints:
-        Compute the time needed to travel to each potential waypoint.
-        Consider penalties for backtracking and skipping waypoints.
-        Calculate the new cost for each potential path, factoring in the current cost, travel time, penalties,
-        and any modifications.
-        Update the memoization table if a lower cost is found for a waypoint.
-        Add the newly calculated states (waypoints) to the priority queue for further exploration.
-        Optimal Path Found:
-
-        Once all waypoints have been visited or the ending waypoint has been reached, the exploration ends.
-        The stored optimal path represents the sequence of waypoints that result in the lowest time.
-        Return Result:
-
-        The algorithm returns the optimal path, allowing you to traverse the waypoints in the order specified
-        for the lowest overall time.
-    */
-    double findLowestTime(const vector<Waypoint> &waypoints)
-    {
-        double final_cost = 0.0;
-        int n = waypoints.size();
-        vector<int> optimal_path;
-        vector<bool> visited(n, false);
-
-        priority_queue<State, vector<State>, function<bool(State, State)>> pq(
-            [](const State &a, const State &b)
-            {
-                return a.cost > b.cost;
-            });
-
-        unordered_map<int, double> dp; // Memoization for dynamic programming
-
-        pq.push({0, 0, 0, 0.0, {0}});
-
-        while (true) // Loop until all waypoints have been visited
-        {
-            if (pq.empty())
-            {
-                break;
-            }
-
-            State current = pq.top();
-            pq.pop();
-
-            if (visited[current.idx])
-            {
-                continue;
-            }
-
-            visited[current.idx] = true;
-
-            if (current.idx == n - 1) // Check if the ending waypoint has been visited
-            {
-                optimal_path = current.path;
-                break;
-            }
-
-            for (int i = 0; i < n; ++i)
-            {
-                if (!visited[i])
-                {
-                    double time_to_next = distance(waypoints[current.idx].x, waypoints[current.idx].y, waypoints[i].x, waypoints[i].y) / SPEED + 10;
-                    double backtrack_cost = getBackTrackPenalty(waypoints, current.idx, i, i - 2);
-                    double skipped_cost = getSkippedTimeMod(current.path, waypoints, i);
-                    double new_cost = current.cost + time_to_next + skipped_cost - backtrack_cost;
-                    if (!dp.count(i) || new_cost < dp[i])
-                    {
-                        dp[i] = new_cost;
-                        vector<int> new_path = current.path;
-                        new_path.push_back(i);
-                        pq.push({waypoints[i].x, waypoints[i].y, i, new_cost, new_path});
-                    }
-                }
-            }
-        }
-
-        return calculateTotalTime(waypoints, optimal_path);
-    }
-
-private:
-    constexpr static float SPEED = 2.0; // Assuming UAV moves at 2 m/s
-    double distance(int x1, int y1, int x2, int y2)
-    {
-        return sqrt(pow(x2 - x1, 2) + pow(y2 - y1, 2));
-    }
-
-    double getBackTrackPenalty(const vector<Waypoint> &waypoints, const int current, const int next, const int previous)
-    {
-        if (current < 0 || current >= waypoints.size() || next < 0 || next >= waypoints.size() || previous < 0 || previous >= waypoints.size())
-        {
-            return 0.0;
-        }
-        double dist_current = distance(0, 0, waypoints[current].x, waypoints[current].y);
-        double dist_next = distance(0, 0, waypoints[next].x, waypoints[next].y);
-        double dist_previous = distance(0, 0, waypoints[previous].x, waypoints[previous].y);
-        if (dist_next <= dist_current && dist_next >= 0.0)
-        {
-            return waypoints[next].penalty;
-        }
-        return 0.0;
-    }
-
-    double getSkippedTimeMod(const vector<int> &optimal_path, const vector<Waypoint> &waypoints, const int &next_index)
-    {
-        double skipped_time = 0.0;
-        for (int i = 0; i < waypoints.size(); ++i)
-        {
-            if (i > next_index)
-            {
-                continue;
-            }
-            if (find(optimal_path.begin(), optimal_path.end(), i) == optimal_path.end())
-            {
-                skipped_time += waypoints[i].penalty;
-            }
-        }
-        return skipped_time - waypoints[next_index].penalty;
-    }
-
-    double getSkippedTime(const vector<int> &optimal_path, const vector<Waypoint> &waypoints)
-    {
-        double skipped_time = 0.0;
-        for (int i = 0; i < waypoints.size(); ++i)
-        {
-            if (find(optimal_path.begin(), optimal_path.end(), i) == optimal_path.end())
-            {
-                skipped_time += waypoints[i].penalty;
-            }
-        }
-        return skipped_time;
-    }
-
-    double calculateTotalTime(const vector<Waypoint> &waypoints, const vector<int> &path)
-    {
-        double total_time = 0.0;
-        int current_x = 0, current_y = 0;
-        auto skipped_time = getSkippedTime(path, waypoints);
-
-        for (int i = 0; i < path.size(); ++i)
-        {
-            total_time += distance(current_x, current_y, waypoints[path[i]].x, waypoints[path[i]].y) / SPEED + 10;
-            current_x = waypoints[path[i]].x;
-            current_y = waypoints[path[i]].y;
-        }
-        total_time -= 10; // 100,100 is double counted, so deduct 10 seconds
-
-        return total_time + skipped_time;
-    }
-
-    void printPath(const vector<int> &path, const vector<Waypoint> &waypoints)
-    {
-        cout << " PATH:";
-        for (int waypoint_index : path)
-        {
-            cout << " (" << waypoints[waypoint_index].x << "," << waypoints[waypoint_index].y << ")";
-        }
-        cout << endl;
-    }
-
-    void log_q(priority_queue<State, vector<State>, function<bool(State, State)>> &pq, const vector<Waypoint> &waypoints)
-    {
-        // Log the contents of the priority queue
-        cout << "Priority Queue contents after pushing new state:" << endl;
-        priority_queue<State, vector<State>, function<bool(State, State)>> temp_pq = pq;
-        while (!temp_pq.empty())
-        {
-            State temp_state = temp_pq.top();
-            temp_pq.pop();
-            cout << "x: " << temp_state.x << ", y: " << temp_state.y << ", idx: " << temp_state.idx << ", cost: " << temp_state.cost << ", path:";
-            for (int waypoint_index : temp_state.path)
-            {
-                cout << " (" << waypoints[waypoint_index].x << "," << waypoints[waypoint_index].y << ")";
-            }
-            cout << endl;
-        }
-    }
-};
-
 class WaypointTest : public ::testing::Test
 {
 protected:
@@ -264,6 +47,7 @@ protected:
     {
         fs::path filePath;
         std::vector<WaypointData> testCases;
+        double budget = 0.0; // solve time for the whole file, in calibration units; 0 if none
     };
 
     std::vector<TestInfo> testInfos;
@@ -281,20 +65,12 @@ private:
 
     void ReadTestCases(std::ifstream &input, const fs::path &filePath)
     {
-        int numWaypoints;
         TestInfo info;
         info.filePath = filePath;
-        while (input >> numWaypoints && numWaypoints != 0)
+        for (auto &waypoints : readCourses(input))
         {
             WaypointData data;
-            data.waypoints.push_back({0, 0, 0});
-            for (int j = 0; j < numWaypoints; ++j)
-            {
-                Waypoint wp;
-                input >> wp.x >> wp.y >> wp.penalty;
-                data.waypoints.push_back(wp);
-            }
-            data.waypoints.push_back({100, 100, 0});
+            data.waypoints = std::move(waypoints);
             info.testCases.push_back(data);
         }
 
@@ -312,6 +88,11 @@ private:
             output.close();
         }
 
+        std::string sample_budget = filePath;
+        WaypointTest::replaceString(sample_budget, "sample_input", "sample_budget");
+        std::ifstream budget(sample_budget);
+        budget >> info.budget;
+
         testInfos.push_back(info);
     }
 };
@@ -377,8 +158,102 @@ TEST_F(WaypointTest, LowestTimeTest)
     ASSERT_TRUE(succeeded);
 }
 
+/**
+    Fixed workload standing in for the machine and build: an O(N^2) shortest-path DP over 512
+    pseudo-random points, the same mix of sqrt and dependent loads as the solver but none of its
+    code, so a solver regression cannot also slow the yardstick down.
+*/
+static double calibrationWork()
+{
+    const size_t n = 512;
+    std::vector<double> x(n), y(n), best(n);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < n; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        x[i] = seed % 100;
+        seed = seed * 1664525u + 1013904223u;
+        y[i] = seed % 100;
+    }
+    best[0] = 0.0;
+    for (size_t j = 1; j < n; ++j)
+    {
+        double lowest = INFINITY;
+        for (size_t i = 0; i < j; ++i)
+        {
+            double time = best[i] + std::sqrt((x[j] - x[i]) * (x[j] - x[i]) + (y[j] - y[i]) * (y[j] - y[i])) + (j - i);
+            lowest = time < lowest ? time : lowest;
+        }
+        best[j] = lowest;
+    }
+    return best.back();
+}
+
+/**
+    Fastest of several runs of f, in nanoseconds. The minimum is the least noisy estimate on a shared
+    machine: interference only ever adds time.
+*/
+template <typename F>
+static double fastestNs(F &&f, int runs)
+{
+    double fastest = INFINITY;
+    for (int r = 0; r < runs; ++r)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        fastest = ns < fastest ? ns : fastest;
+    }
+    return fastest;
+}
+
+// Budgets in sample_budget_*.txt are in units of one calibrationWork() run on the same build, with
+// roughly 1.5-2.5x headroom over -g and -O2 builds. SHEARWATER_PERF_BUDGET_FACTOR scales them (e.g. 4
+// under sanitizers); 0 skips the check.
+static double budgetFactor()
+{
+    const char *factor = std::getenv("SHEARWATER_PERF_BUDGET_FACTOR");
+    return factor ? std::atof(factor) : 1.0;
+}
+
+TEST_F(WaypointTest, TimeBudgetTest)
+{
+    const double factor = budgetFactor();
+    if (factor <= 0.0)
+    {
+        GTEST_SKIP() << "SHEARWATER_PERF_BUDGET_FACTOR=0";
+    }
+
+    volatile double sink;
+    const double unit_ns = fastestNs([&]
+                                     { sink = calibrationWork(); },
+                                     10);
+    std::cout << "Calibration unit: " << unit_ns / 1e6 << " ms" << std::endl;
+
+    Optimizer optimizer;
+    for (const auto &info : testInfos)
+    {
+        if (info.budget <= 0.0)
+        {
+            continue;
+        }
+        double solve_ns = fastestNs([&]
+                                    {
+            for (const auto &data : info.testCases)
+            {
+                sink = optimizer.findLowestTime(data.waypoints);
+            } },
+                                    5);
+        double units = solve_ns / unit_ns;
+        std::cout << "For file " << info.filePath << ": " << units << " calibration units, budget " << info.budget
+                  << " x " << factor << std::endl;
+        EXPECT_LE(units, info.budget * factor) << info.filePath << " took " << solve_ns / 1e6 << " ms";
+    }
+}
+
 int main(int argc, char **argv)
 {
+    pinDefaultTuning();
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
\ No newline at end of file
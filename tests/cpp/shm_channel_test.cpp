@@ -0,0 +1,269 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/shm_channel.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+static string channelName(const char *test)
+{
+    return "/shearwater_test_" + string(test) + "_" + to_string(::getpid());
+}
+
+static vector<double> expected(const vector<vector<Waypoint>> &courses)
+{
+    Optimizer optimizer;
+    vector<double> answers;
+    for (const auto &course : courses)
+    {
+        answers.push_back(optimizer.findLowestTime(course));
+    }
+    return answers;
+}
+
+TEST(ShmChannelTest, RecordsSurviveWrappingTheRing)
+{
+    ShmChannel server, client;
+    ASSERT_TRUE(server.create(channelName("wrap"), 4096)) << server.error();
+    ASSERT_TRUE(client.open(channelName("wrap"))) << client.error();
+
+    CourseGenerator generator(8);
+    vector<Waypoint> received;
+    for (int i = 0; i < 500; ++i)
+    {
+        auto course = generator.generate(CourseProfile::Uniform, i % 37);
+        ASSERT_TRUE(client.submit(i, course));
+        uint64_t tag;
+        ASSERT_TRUE(server.nextRequest(tag, received, 0));
+        EXPECT_EQ(static_cast<uint64_t>(i), tag);
+        ASSERT_EQ(course.size(), received.size());
+        for (size_t w = 0; w < course.size(); ++w)
+        {
+            EXPECT_EQ(course[w].x, received[w].x);
+            EXPECT_EQ(course[w].y, received[w].y);
+            EXPECT_EQ(course[w].penalty, received[w].penalty);
+        }
+        server.respond(tag, 1.5 * i);
+        ShmAnswer answer;
+        ASSERT_TRUE(client.poll(answer));
+        EXPECT_EQ(static_cast<uint64_t>(i), answer.tag);
+        EXPECT_EQ(1.5 * i, answer.answer);
+    }
+}
+
+TEST(ShmChannelTest, FullRingAndOversizedCoursesAreRefused)
+{
+    ShmChannel server, client;
+    ASSERT_TRUE(server.create(channelName("full"), 4096));
+    ASSERT_TRUE(client.open(channelName("full")));
+
+    CourseGenerator generator(9);
+    auto course = generator.generate(CourseProfile::Uniform, 20);
+    int queued = 0;
+    while (client.submit(queued, course))
+    {
+        ++queued;
+    }
+    EXPECT_GT(queued, 0);
+    EXPECT_LT(queued, 4096 / 16);
+
+    uint64_t tag;
+    vector<Waypoint> received;
+    ASSERT_TRUE(server.nextRequest(tag, received, 0));
+    EXPECT_TRUE(client.submit(queued, course));
+
+    EXPECT_FALSE(client.submit(0, generator.generate(CourseProfile::Uniform, static_cast<int>(client.maxWaypoints()) + 1)));
+}
+
+TEST(ShmChannelTest, NextRequestTimesOutWhenIdle)
+{
+    ShmChannel server;
+    ASSERT_TRUE(server.create(channelName("idle")));
+    uint64_t tag;
+    vector<Waypoint> received;
+    EXPECT_FALSE(server.nextRequest(tag, received, 1000000));
+}
+
+TEST(ShmChannelTest, MalformedRecordsBreakTheChannel)
+{
+    const uint64_t tag = 0x5eed5eed5eed5eedull;
+    CourseGenerator generator(62);
+    const auto course = generator.generate(CourseProfile::Uniform, 5);
+    // Waypoint counts a client could forge: one that wraps n + 2, one past the ring, and a valid
+    // count with a record length that does not match it.
+    for (uint32_t forgery : {0u, 1u, 2u})
+    {
+        const string name = channelName("forged");
+        ShmChannel server, client;
+        ASSERT_TRUE(server.create(name, 4096));
+        ASSERT_TRUE(client.open(name));
+        ASSERT_TRUE(client.submit(tag, course));
+
+        // Rewrite the record header in place through a mapping of our own.
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        ASSERT_GE(fd, 0);
+        struct stat info;
+        ASSERT_EQ(::fstat(fd, &info), 0);
+        void *segment = ::mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        ASSERT_NE(segment, MAP_FAILED);
+        char *bytes = static_cast<char *>(segment);
+        char *record = nullptr;
+        for (off_t at = 8; at + 8 <= info.st_size && !record; at += 8)
+        {
+            if (memcmp(bytes + at, &tag, sizeof(tag)) == 0)
+            {
+                record = bytes + at - 8;
+            }
+        }
+        ASSERT_NE(record, nullptr);
+        const uint32_t forged[][2] = {{UINT32_MAX - 1, 16}, {1000000, 12000016}, {5, 24}};
+        memcpy(record, forged[forgery], 8);
+        ::munmap(segment, info.st_size);
+
+        uint64_t received_tag = 0;
+        vector<Waypoint> received;
+        EXPECT_FALSE(server.nextRequest(received_tag, received, 1000000)) << forgery;
+        EXPECT_TRUE(server.broken());
+        EXPECT_NE(server.error().find("malformed request record"), string::npos) << server.error();
+        EXPECT_FALSE(server.nextRequest(received_tag, received, 1000000));
+
+        Optimizer optimizer;
+        atomic<bool> stop{false};
+        server.serve(optimizer, stop); // returns at once
+    }
+}
+
+TEST(ShmChannelTest, RingSizesAreReadOnceAndStopEndsAFullRingWait)
+{
+    const string name = channelName("sizes");
+    ShmChannel server, client;
+    ASSERT_TRUE(server.create(name, 4096));
+    ASSERT_TRUE(client.open(name));
+
+    // A client rewrites the ring sizes after both sides bound: magic, version, then the two sizes.
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    void *segment = ::mmap(nullptr, 32, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    ASSERT_NE(segment, MAP_FAILED);
+    const uint64_t forged[2] = {uint64_t(1) << 40, 0};
+    memcpy(static_cast<char *>(segment) + 16, forged, sizeof(forged));
+    ::munmap(segment, 32);
+
+    CourseGenerator generator(63);
+    const auto course = generator.generate(CourseProfile::Uniform, 5);
+    const size_t slots = 4096 / 16;
+    for (size_t i = 0; i < slots; ++i)
+    {
+        ASSERT_TRUE(client.submit(i, course));
+        uint64_t tag;
+        vector<Waypoint> received;
+        ASSERT_TRUE(server.nextRequest(tag, received, 0));
+        ASSERT_TRUE(server.respond(tag, 1.0));
+    }
+
+    // The response ring is full and nobody drains it.
+    atomic<bool> stop{true};
+    EXPECT_FALSE(server.respond(slots, 1.0, &stop));
+    ASSERT_TRUE(client.submit(slots, course));
+    stop = false;
+    thread stopper([&]
+                   {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        stop = true; });
+    Optimizer optimizer;
+    server.serve(optimizer, stop); // returns instead of spinning forever
+    stopper.join();
+
+    ShmAnswer answer;
+    for (size_t i = 0; i < slots; ++i)
+    {
+        ASSERT_TRUE(client.poll(answer));
+        EXPECT_EQ(i, answer.tag);
+    }
+    EXPECT_FALSE(client.poll(answer));
+}
+
+TEST(ShmChannelTest, SolverThreadAnswersPipelinedBatch)
+{
+    ShmChannel server, client;
+    ASSERT_TRUE(server.create(channelName("thread"), 4096));
+    ASSERT_TRUE(client.open(channelName("thread")));
+    atomic<bool> stop{false};
+    thread solver([&]
+                  {
+        Optimizer optimizer;
+        server.serve(optimizer, stop); });
+
+    CourseGenerator generator(10);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 2000; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], c % 12));
+    }
+    vector<double> answers;
+    EXPECT_TRUE(client.solveAll(courses, answers)) << client.error();
+    stop = true;
+    solver.join();
+    EXPECT_EQ(expected(courses), answers);
+}
+
+TEST(ShmChannelTest, WorksAcrossProcesses)
+{
+    const string name = channelName("fork");
+    ShmChannel server;
+    ASSERT_TRUE(server.create(name));
+
+    pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        ShmChannel client;
+        CourseGenerator generator(11);
+        vector<vector<Waypoint>> courses;
+        for (int c = 0; c < 300; ++c)
+        {
+            courses.push_back(generator.generate(CourseProfile::Clustered, c % 20));
+        }
+        vector<double> answers;
+        bool ok = client.open(name) && client.solveAll(courses, answers) && answers == expected(courses);
+        ::_exit(ok ? 0 : 1);
+    }
+
+    Optimizer optimizer;
+    vector<Waypoint> course;
+    uint64_t tag;
+    for (int served = 0; served < 300;)
+    {
+        if (server.nextRequest(tag, course))
+        {
+            server.respond(tag, optimizer.findLowestTime(course));
+            ++served;
+        }
+    }
+    int status = 0;
+    ASSERT_EQ(child, ::waitpid(child, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/reference_solver.h"
+#include "shearwater/solver_engine.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const fs::path kDataPath = fs::current_path() / "data/shearwater_challenge/";
+
+struct SampleFile
+{
+    string name;
+    vector<vector<Waypoint>> courses;
+    vector<string> expected; // the checked-in output lines
+};
+
+static vector<SampleFile> sampleFiles()
+{
+    vector<SampleFile> samples;
+    for (const fs::path &directory : {kDataPath, kDataPath / "generated"})
+    {
+        for (const auto &entry : fs::directory_iterator(directory))
+        {
+            string input_name = entry.path().filename().string();
+            if (input_name.rfind("sample_input_", 0) != 0)
+            {
+                continue;
+            }
+            SampleFile sample;
+            sample.name = entry.path().string();
+            ifstream input(entry.path());
+            sample.courses = readCourses(input);
+            ifstream output(directory / ("sample_output_" + input_name.substr(13)));
+            for (string line; getline(output, line);)
+            {
+                sample.expected.push_back(line);
+            }
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
+
+// Travel, stops and the penalties of every waypoint off the path.
+static double pathTime(const vector<Waypoint> &waypoints, const vector<int> &path)
+{
+    double total = 0;
+    long long penalties = 0;
+    for (const auto &waypoint : waypoints)
+    {
+        penalties += waypoint.penalty;
+    }
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        penalties -= waypoints[path[i]].penalty;
+        if (i > 0)
+        {
+            double dx = waypoints[path[i]].x - waypoints[path[i - 1]].x;
+            double dy = waypoints[path[i]].y - waypoints[path[i - 1]].y;
+            total += sqrt(dx * dx + dy * dy) / 2.0 + 10.0;
+        }
+    }
+    return total + penalties;
+}
+
+template <typename Engine>
+class SolverEngineTest : public ::testing::Test
+{
+protected:
+    Engine engine;
+};
+
+using Engines = ::testing::Types<SearchEngine, DenseEngine, WindowedEngine, SimdBatchEngine, ApproximateEngine>;
+TYPED_TEST_SUITE(SolverEngineTest, Engines);
+
+TYPED_TEST(SolverEngineTest, MatchesTheSampleOutputs)
+{
+    const bool exact = this->engine.traits().exact;
+    for (const auto &sample : sampleFiles())
+    {
+        ASSERT_EQ(sample.expected.size(), sample.courses.size()) << sample.name;
+        vector<double> batch(sample.courses.size());
+        this->engine.solveBatch(sample.courses, batch.data());
+        for (size_t c = 0; c < sample.courses.size(); ++c)
+        {
+            const double answer = this->engine.solve(sample.courses[c]);
+            EXPECT_EQ(answer, batch[c]) << sample.name << " course " << c;
+            if (exact)
+            {
+                EXPECT_EQ(formatAnswer(answer), sample.expected[c]) << sample.name << " course " << c;
+            }
+            else
+            {
+                EXPECT_GE(answer, referenceLowestTime(sample.courses[c]) - 1e-9) << sample.name << " course " << c;
+            }
+        }
+    }
+}
+
+TYPED_TEST(SolverEngineTest, PathsAreRealAndCostTheAnswer)
+{
+    CourseGenerator generator(74);
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        for (int n : {0, 1, 2, 9, 40, 200})
+        {
+            vector<Waypoint> course = generator.generate(profile, n);
+            const double answer = this->engine.solve(course);
+            const vector<int> &path = this->engine.path();
+            if (!this->engine.traits().path)
+            {
+                EXPECT_TRUE(path.empty());
+                continue;
+            }
+            ASSERT_GE(path.size(), 2u) << profileName(profile) << " n=" << n;
+            EXPECT_EQ(path.front(), 0);
+            EXPECT_EQ(path.back(), n + 1);
+            for (size_t i = 1; i < path.size(); ++i)
+            {
+                EXPECT_LT(path[i - 1], path[i]);
+            }
+            EXPECT_NEAR(pathTime(course, path), answer, 1e-6) << profileName(profile) << " n=" << n;
+        }
+    }
+}
+
+TYPED_TEST(SolverEngineTest, EmptyAndDirectCourses)
+{
+    EXPECT_EQ(this->engine.solve({}), 0.0);
+    EXPECT_DOUBLE_EQ(this->engine.solve({{0, 0, 0}, {100, 100, 0}}), sqrt(20000.0) / 2 + 10);
+    vector<vector<Waypoint>> courses = {{}, {{0, 0, 0}, {30, 40, 0}}, {}};
+    vector<double> answers(3, -1);
+    this->engine.solveBatch(courses, answers.data());
+    EXPECT_EQ(answers, (vector<double>{0, 35, 0}));
+}
+
+TEST(SolverEngineRegistryTest, EveryEngineIsRegisteredUnderItsName)
+{
+    for (const auto &registration : engineRegistry())
+    {
+        auto engine = makeEngine(registration.name);
+        ASSERT_NE(engine, nullptr);
+        EXPECT_STREQ(engine->name(), registration.name);
+    }
+    EXPECT_EQ(engineRegistry().size(), 5u);
+    EXPECT_EQ(makeEngine("fastest"), nullptr);
+}
+
+TEST(EngineDispatcherTest, PicksByCourseSizeAndGuarantees)
+{
+    TuningProfile profile;
+    profile.forward_min_waypoints = 500;
+    EngineDispatcher dispatcher(profile);
+    const EngineRequest exact_path;
+    const EngineRequest exact_score{true, false};
+    const EngineRequest approximate{false, true};
+    const int dense = EngineDispatcher::kDenseMaxWaypoints;
+    EXPECT_STREQ(dispatcher.select(10, exact_path), "dense");
+    EXPECT_STREQ(dispatcher.select(dense, exact_score), "dense");
+    EXPECT_STREQ(dispatcher.select(dense, exact_score, true), "simd_batch");
+    EXPECT_STREQ(dispatcher.select(dense, exact_path, true), "dense");
+    EXPECT_STREQ(dispatcher.select(dense + 1, exact_score, true), "search");
+    EXPECT_STREQ(dispatcher.select(dense + 1, exact_path), "search");
+    EXPECT_STREQ(dispatcher.select(1000, exact_path), "windowed");
+    EXPECT_STREQ(dispatcher.select(ApproximateEngine::kDefaultLookahead, approximate), "dense");
+    EXPECT_STREQ(dispatcher.select(ApproximateEngine::kDefaultLookahead + 1, approximate), "approximate");
+
+    TuningProfile untuned;
+    untuned.forward_min_waypoints = 0;
+    EXPECT_STREQ(EngineDispatcher(untuned).select(100000, exact_path), "search");
+
+    SolverEngine *dense_engine = dispatcher.engine("dense");
+    ASSERT_NE(dense_engine, nullptr);
+    EXPECT_STREQ(dense_engine->name(), "dense");
+    EXPECT_EQ(dispatcher.engine("dense"), dense_engine);
+    EXPECT_EQ(dispatcher.engine("fastest"), nullptr);
+}
+
+TEST(EngineDispatcherTest, BatchesAnswerLikeSingleCourses)
+{
+    CourseGenerator generator(74);
+    vector<vector<Waypoint>> courses;
+    for (int c = 0; c < 60; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % 7], (c * 37) % 700));
+    }
+    TuningProfile profile;
+    profile.forward_min_waypoints = 400;
+    EngineDispatcher dispatcher(profile);
+    for (EngineRequest request : {EngineRequest{true, true}, EngineRequest{true, false}, EngineRequest{false, false}})
+    {
+        vector<double> answers(courses.size());
+        dispatcher.solveBatch(courses, answers.data(), request);
+        for (size_t c = 0; c < courses.size(); ++c)
+        {
+            const double single = dispatcher.solve(courses[c], request);
+            EXPECT_STREQ(dispatcher.lastEngine(), dispatcher.select(courses[c].size() - 2, request));
+            const double reference = referenceLowestTime(courses[c]);
+            if (request.exact)
+            {
+                EXPECT_NEAR(answers[c], reference, 1e-9) << "course " << c;
+                EXPECT_NEAR(single, reference, 1e-9) << "course " << c;
+            }
+            else
+            {
+                EXPECT_NEAR(answers[c], single, 1e-9) << "course " << c;
+                EXPECT_GE(single, reference - 1e-9) << "course " << c;
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/solver_client.h"
+#include "shearwater/solver_server.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+class SolverServerTest : public ::testing::Test
+{
+protected:
+    string path = "/tmp/shearwater_test_" + to_string(::getpid()) + ".sock";
+    unique_ptr<SolverServer> server;
+    thread serving;
+
+    void start(SolverServerOptions options)
+    {
+        server = make_unique<SolverServer>(options);
+        ASSERT_TRUE(server->listen(path)) << server->error();
+        serving = thread([this]
+                         { server->run(); });
+    }
+
+    void TearDown() override
+    {
+        if (server)
+        {
+            server->stop();
+            serving.join();
+        }
+    }
+
+    static vector<vector<Waypoint>> courses(uint64_t seed, int count)
+    {
+        CourseGenerator generator(seed);
+        vector<vector<Waypoint>> result;
+        for (int c = 0; c < count; ++c)
+        {
+            result.push_back(generator.generate(kAllCourseProfiles[c % 7], 1 + c * 7));
+        }
+        return result;
+    }
+
+    static vector<double> expected(const vector<vector<Waypoint>> &input)
+    {
+        Optimizer optimizer;
+        vector<double> answers;
+        for (const auto &course : input)
+        {
+            answers.push_back(optimizer.findLowestTime(course));
+        }
+        return answers;
+    }
+};
+
+TEST_F(SolverServerTest, PipelinedBinaryRequestsAreBatchedAndAnsweredInOrder)
+{
+    SolverServerOptions options;
+    options.threads = 2;
+    options.max_batch = 16;
+    options.batch_window = chrono::milliseconds(20);
+    start(options);
+
+    auto input = courses(1, 40);
+    SolverClient client;
+    ASSERT_TRUE(client.connect(path)) << client.error();
+    vector<double> answers;
+    ASSERT_TRUE(client.solveAll(input, answers)) << client.error();
+    EXPECT_EQ(expected(input), answers);
+
+    SolverServerCounters counters = server->counters();
+    EXPECT_EQ(40u, counters.requests);
+    EXPECT_LT(counters.batches, counters.requests);
+    EXPECT_LE(counters.largest_batch, 16u);
+}
+
+TEST_F(SolverServerTest, TextProtocolMatchesTheSolverOutput)
+{
+    start(SolverServerOptions());
+    auto input = courses(2, 5);
+    stringstream request;
+    writeCourses(request, input);
+    string text = request.str();
+
+    int fd = unixConnect(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(sendAll(fd, text.data(), text.size()));
+    string reply;
+    char buffer[256];
+    ssize_t got;
+    while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        reply.append(buffer, got);
+    }
+    ::close(fd);
+
+    string want;
+    for (double answer : expected(input))
+    {
+        want += formatAnswer(answer) + "\n";
+    }
+    EXPECT_EQ(want, reply);
+}
+
+TEST_F(SolverServerTest, ConcurrentClientsEachGetTheirOwnAnswers)
+{
+    start(SolverServerOptions());
+    vector<thread> clients;
+    vector<bool> correct(4, false);
+    for (int t = 0; t < 4; ++t)
+    {
+        clients.emplace_back([&, t]
+                             {
+            auto input = courses(10 + t, 12);
+            SolverClient client;
+            vector<double> answers;
+            for (int round = 0; round < 3; ++round)
+            {
+                if (!client.connect(path) || !client.solveAll(input, answers))
+                {
+                    return;
+                }
+            }
+            correct[t] = answers == expected(input); });
+    }
+    for (auto &client : clients)
+    {
+        client.join();
+    }
+    for (int t = 0; t < 4; ++t)
+    {
+        EXPECT_TRUE(correct[t]) << "client " << t;
+    }
+    EXPECT_EQ(4u * 3u, server->counters().connections);
+}
+
+TEST_F(SolverServerTest, MalformedFrameClosesOnlyThatConnection)
+{
+    start(SolverServerOptions());
+    int fd = unixConnect(path);
+    ASSERT_GE(fd, 0);
+    vector<char> frame(kBinaryProtocolMagic, kBinaryProtocolMagic + 4);
+    putLE32(frame, kProtocolMaxWaypoints + 1);
+    ASSERT_TRUE(sendAll(fd, frame.data(), frame.size()));
+    char byte;
+    EXPECT_EQ(0, ::recv(fd, &byte, 1, 0));
+    ::close(fd);
+
+    SolverClient client;
+    double answer = 0.0;
+    ASSERT_TRUE(client.connect(path));
+    ASSERT_TRUE(client.solve(courses(3, 1)[0], answer));
+    EXPECT_EQ(expected(courses(3, 1))[0], answer);
+}
+
+TEST_F(SolverServerTest, MalformedTextCoursesAreRejectedUnanswered)
+{
+    SolverMetrics metrics;
+    SolverServerOptions options;
+    options.metrics = &metrics;
+    start(options);
+    const auto valid = courses(5, 1);
+    stringstream request;
+    writeCourses(request, valid);
+    string valid_text = request.str();
+    valid_text.resize(valid_text.size() - 2); // without the terminating 0
+    const string want = formatAnswer(expected(valid)[0]) + "\n";
+
+    // A valid course first: it is answered, the bad one after it is not, and the connection ends.
+    for (string bad : vector<string>{"-5\n", "3\n1 2\n", "1\n50 50 abc\n", to_string(kProtocolMaxWaypoints + 1ull) + "\n", "x\n"})
+    {
+        int fd = unixConnect(path);
+        ASSERT_GE(fd, 0);
+        const string text = valid_text + bad;
+        ASSERT_TRUE(sendAll(fd, text.data(), text.size()));
+        ::shutdown(fd, SHUT_WR);
+        string reply;
+        char buffer[256];
+        ssize_t got;
+        while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            reply.append(buffer, got);
+        }
+        ::close(fd);
+        EXPECT_EQ(want, reply) << bad;
+    }
+    EXPECT_EQ(5u, metrics.errorCount(SolveError::MalformedRequest));
+    EXPECT_EQ(5u, server->counters().requests);
+
+    SolverClient client;
+    double answer = 0.0;
+    ASSERT_TRUE(client.connect(path));
+    ASSERT_TRUE(client.solve(valid[0], answer));
+    EXPECT_EQ(expected(valid)[0], answer);
+}
+
+TEST_F(SolverServerTest, StopAnswersRequestsAlreadyReceived)
+{
+    SolverServerOptions options;
+    options.batch_window = chrono::milliseconds(50);
+    start(options);
+    auto input = courses(4, 8);
+    SolverClient client;
+    ASSERT_TRUE(client.connect(path));
+    vector<double> answers;
+    thread stopper([this]
+                   {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        server->stop(); });
+    EXPECT_TRUE(client.solveAll(input, answers)) << client.error();
+    stopper.join();
+    EXPECT_EQ(expected(input), answers);
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
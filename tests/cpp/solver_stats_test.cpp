@@ -0,0 +1,98 @@
+#define SHEARWATER_STATS
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/solver_stats.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+TEST(SolverStatsTest, CountersAreConsistent)
+{
+    static_assert(kSolverStatsEnabled, "this test needs SHEARWATER_STATS");
+    Optimizer optimizer;
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        CourseGenerator generator(11);
+        auto course = generator.generate(profile, 300);
+        optimizer.findLowestTime(course);
+        const SolverStats &stats = optimizer.stats();
+
+        EXPECT_GE(stats.heap_pushes, stats.heap_pops) << profileName(profile);
+        EXPECT_EQ(stats.heap_pops, stats.expansions + stats.stale_pops + 1) << profileName(profile); // +1: the finish
+        EXPECT_LE(stats.heap_pushes, stats.relaxations + 1) << profileName(profile); // +1: the start
+        EXPECT_GT(stats.relaxations, 0u);
+        EXPECT_LE(stats.window_max, course.size() - 1);
+        EXPECT_LE(stats.meanWindow(), static_cast<double>(stats.window_max));
+        EXPECT_GT(stats.search_ns, 0u);
+    }
+}
+
+TEST(SolverStatsTest, CountersResetPerCourse)
+{
+    Optimizer optimizer;
+    CourseGenerator generator(3);
+    optimizer.findLowestTime(generator.generate(CourseProfile::Uniform, 500));
+    uint64_t large_pushes = optimizer.stats().heap_pushes;
+
+    optimizer.findLowestTime({{0, 0, 0}, {50, 50, 20}, {100, 100, 0}});
+    EXPECT_LT(optimizer.stats().heap_pushes, large_pushes);
+    EXPECT_EQ(2u, optimizer.stats().expansions);
+}
+
+TEST(SolverStatsTest, ForwardDpRecordsWindowsAndPhases)
+{
+    TuningProfile profile;
+    profile.forward_min_waypoints = 1;
+    Optimizer optimizer;
+    optimizer.setTuning(profile);
+    auto course = CourseGenerator(11).generate(CourseProfile::Uniform, 300);
+    optimizer.findLowestTime(course);
+    const SolverStats &stats = optimizer.stats();
+
+    EXPECT_EQ(0u, stats.heap_pushes);
+    EXPECT_EQ(course.size() - 1, stats.expansions);
+    EXPECT_EQ(stats.relaxations, stats.window_total);
+    EXPECT_GT(stats.window_max, 0u);
+    EXPECT_LE(stats.window_max, course.size() - 1);
+    EXPECT_GT(stats.search_ns, 0u);
+    EXPECT_GT(stats.path_ns, 0u);
+}
+
+TEST(SolverStatsTest, JsonAndCsvHaveTheSameFields)
+{
+    SolverStats stats;
+    stats.heap_pushes = 12345678;
+    stats.expansions = 4;
+    stats.window_total = 10;
+
+    ostringstream json;
+    writeStatsJson(json, 7, 100, stats);
+    EXPECT_EQ(0u, json.str().find("{\"course\":7,\"waypoints\":100,\"heap_pushes\":12345678,"));
+    EXPECT_NE(string::npos, json.str().find("\"window_mean\":2.5"));
+    EXPECT_EQ('\n', json.str().back());
+
+    ostringstream csv;
+    writeStatsCsvHeader(csv);
+    writeStatsCsvRow(csv, 7, 100, stats);
+    string header, row;
+    istringstream lines(csv.str());
+    getline(lines, header);
+    getline(lines, row);
+    EXPECT_EQ(0u, header.find("course,waypoints,heap_pushes,"));
+    EXPECT_EQ(0u, row.find("7,100,12345678,"));
+    EXPECT_EQ(count(header.begin(), header.end(), ','), count(row.begin(), row.end(), ','));
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
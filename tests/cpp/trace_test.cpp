@@ -0,0 +1,165 @@
+#define SHEARWATER_TRACE_LEVEL 2
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/trace.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+static vector<TraceEvent> localEvents()
+{
+    vector<TraceEvent> events;
+    TraceRecorder::instance().local().forEach([&](const TraceEvent &event)
+                                              { events.push_back(event); });
+    return events;
+}
+
+static size_t countOf(const string &text, const string &needle)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != string::npos; pos = text.find(needle, pos + 1))
+    {
+        ++count;
+    }
+    return count;
+}
+
+TEST(TraceTest, SpansNestInsideTheirParent)
+{
+    TraceRecorder::instance().clear();
+    {
+        SHEARWATER_TRACE_SPAN("outer", 1);
+        SHEARWATER_TRACE_SPAN("inner", 2);
+    }
+    auto events = localEvents();
+    ASSERT_EQ(2u, events.size());
+    // Spans are recorded when they close, innermost first.
+    EXPECT_STREQ("inner", events[0].name);
+    EXPECT_STREQ("outer", events[1].name);
+    EXPECT_GE(events[0].start_ns, events[1].start_ns);
+    EXPECT_LE(events[0].start_ns + events[0].duration_ns, events[1].start_ns + events[1].duration_ns);
+}
+
+TEST(TraceTest, OptimizerRecordsSpanAndSearchEvents)
+{
+    // The heap search, then the forward DP.
+    for (int forward_min_waypoints : {0, 1})
+    {
+        TraceRecorder::instance().clear();
+        TuningProfile profile;
+        profile.forward_min_waypoints = forward_min_waypoints;
+        Optimizer optimizer;
+        optimizer.setTuning(profile);
+        CourseGenerator generator(9);
+        optimizer.findLowestTime(generator.generate(CourseProfile::Uniform, 50));
+
+        auto events = localEvents();
+        ASSERT_FALSE(events.empty());
+        EXPECT_STREQ("findLowestTime", events.back().name);
+        EXPECT_EQ(52, events.back().arg);
+        EXPECT_FALSE(events.back().instant);
+
+        size_t expansions = 0, path_lengths = 0;
+        for (const auto &event : events)
+        {
+            expansions += string(event.name) == "expand";
+            path_lengths += string(event.name) == "path_length";
+        }
+        EXPECT_GT(expansions, 0u) << "forward from " << forward_min_waypoints;
+        EXPECT_EQ(1u, path_lengths) << "forward from " << forward_min_waypoints;
+    }
+}
+
+TEST(TraceTest, RingBufferKeepsNewestEvents)
+{
+    TraceRecorder::instance().setCapacity(8);
+    vector<TraceEvent> events;
+    thread worker([&]
+                  {
+        for (int i = 0; i < 20; ++i)
+        {
+            SHEARWATER_TRACE_EVENT("tick", i);
+        }
+        TraceRecorder::instance().local().forEach([&](const TraceEvent &event) { events.push_back(event); }); });
+    worker.join();
+    TraceRecorder::instance().setCapacity(TraceRecorder::kDefaultCapacity);
+
+    ASSERT_EQ(8u, events.size());
+    EXPECT_EQ(12, events.front().arg);
+    EXPECT_EQ(19, events.back().arg);
+}
+
+TEST(TraceTest, ChromeTraceHasOneThreadPerBuffer)
+{
+    TraceRecorder::instance().clear();
+    // Keep all three alive at once so none inherits another's buffer.
+    atomic<int> started{0};
+    vector<thread> workers;
+    for (int t = 0; t < 3; ++t)
+    {
+        workers.emplace_back([t, &started]
+                             {
+            {
+                SHEARWATER_TRACE_SPAN("worker", t);
+            }
+            ++started;
+            while (started.load() < 3)
+            {
+                this_thread::yield();
+            } });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    ostringstream json;
+    TraceRecorder::instance().writeChromeTrace(json);
+    const string text = json.str();
+    EXPECT_EQ(0u, text.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    EXPECT_EQ(3u, countOf(text, "\"name\":\"worker\""));
+    EXPECT_EQ(countOf(text, "{\"name\""), countOf(text, "}}"));
+
+    set<string> tids;
+    for (size_t pos = text.find("\"tid\":"); pos != string::npos; pos = text.find("\"tid\":", pos + 1))
+    {
+        tids.insert(text.substr(pos, text.find(',', pos) - pos));
+    }
+    EXPECT_GE(tids.size(), 3u);
+}
+
+TEST(TraceTest, ExitedThreadsBuffersAreReused)
+{
+    thread([]
+           { SHEARWATER_TRACE_EVENT("warm", 0); })
+        .join();
+    const size_t buffers = TraceRecorder::instance().bufferCount();
+    for (int t = 0; t < 20; ++t)
+    {
+        thread([t]
+               { SHEARWATER_TRACE_EVENT("short-lived", t); })
+            .join();
+    }
+    EXPECT_EQ(buffers, TraceRecorder::instance().bufferCount());
+
+    // The reused buffer keeps what the exited threads recorded.
+    ostringstream json;
+    TraceRecorder::instance().writeChromeTrace(json);
+    EXPECT_EQ(20u, countOf(json.str(), "\"name\":\"short-lived\""));
+}
+
+int main(int argc, char **argv)
+{
+    pinDefaultTuning();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/optimizer.h"
+#include "shearwater/tuning_profile.h"
+
+using namespace std;
+
+static TuningProfile tunedProfile()
+{
+    TuningProfile profile;
+    profile.cpu_level = CpuLevel::Baseline;
+    profile.threads = 6;
+    profile.claim_size = 16;
+    profile.leg_chunk = 128;
+    profile.forward_min_waypoints = 200;
+    profile.host = "build-07";
+    return profile;
+}
+
+TEST(TuningProfileTest, FormatParsesBackAndSurvivesAFile)
+{
+    const TuningProfile tuned = tunedProfile();
+    TuningProfile parsed;
+    string error;
+    ASSERT_TRUE(parsed.parse(tuned.format(), error)) << error;
+    EXPECT_EQ(parsed.format(), tuned.format());
+
+    const string path = ::testing::TempDir() + "tuning_profile_test.profile";
+    ASSERT_TRUE(tuned.save(path, error)) << error;
+    TuningProfile loaded;
+    ASSERT_TRUE(loaded.load(path, error)) << error;
+    EXPECT_EQ(loaded.cpu_level, CpuLevel::Baseline);
+    EXPECT_EQ(loaded.threads, 6);
+    EXPECT_EQ(loaded.claim_size, 16);
+    EXPECT_EQ(loaded.leg_chunk, 128);
+    EXPECT_EQ(loaded.forward_min_waypoints, 200);
+    EXPECT_EQ(loaded.host, "build-07");
+    remove(path.c_str());
+    EXPECT_FALSE(loaded.load(path, error));
+}
+
+TEST(TuningProfileTest, BadProfilesAreRejectedAndLeaveTheProfileAlone)
+{
+    const string version = "solver_version=" + to_string(kSolverVersion) + "\n";
+    for (string bad : {string("threads=4\n"), // no version
+                       "solver_version=" + to_string(kSolverVersion + 1) + "\nthreads=4\n",
+                       version + "threads=0\n",
+                       version + "threads=four\n",
+                       version + "leg_chunk=257\n",
+                       version + "forward_min_waypoints=-1\n",
+                       version + "cpu_level=sse9\n",
+                       version + "simd_width=8\n",
+                       version + "threads\n"})
+    {
+        TuningProfile profile = tunedProfile();
+        string error;
+        EXPECT_FALSE(profile.parse(bad, error)) << bad;
+        EXPECT_FALSE(error.empty()) << bad;
+        EXPECT_EQ(profile.format(), tunedProfile().format()) << bad;
+    }
+    TuningProfile profile;
+    string error;
+    EXPECT_TRUE(profile.parse("# comment\n\n" + version + "threads=3\n", error)) << error;
+    EXPECT_EQ(profile.threads, 3);
+}
+
+TEST(TuningProfileTest, AnswersDoNotDependOnTheTuning)
+{
+    CourseGenerator generator(73);
+    vector<vector<Waypoint>> courses;
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        for (int n : {0, 1, 2, 9, 70, 300})
+        {
+            courses.push_back(generator.generate(profile, n));
+        }
+    }
+    TuningProfile untuned;
+    untuned.forward_min_waypoints = 0;
+    BatchSolver reference_solver;
+    reference_solver.setTuning(untuned);
+    const vector<double> expected = reference_solver.solve(courses);
+
+    for (int leg_chunk : {1, 7, 64, TuningProfile::kMaxLegChunk})
+    {
+        for (int forward_min_waypoints : {0, 1, 70})
+        {
+            TuningProfile profile;
+            profile.leg_chunk = leg_chunk;
+            profile.forward_min_waypoints = forward_min_waypoints;
+            Optimizer optimizer;
+            optimizer.setTuning(profile);
+            for (size_t c = 0; c < courses.size(); ++c)
+            {
+                EXPECT_NEAR(optimizer.findLowestTime(courses[c]), expected[c], 1e-9)
+                    << "course " << c << " leg_chunk " << leg_chunk << " forward from " << forward_min_waypoints;
+                if (courses[c].size() > 0)
+                {
+                    EXPECT_EQ(optimizer.optimalPath().front(), 0);
+                    EXPECT_EQ(optimizer.optimalPath().back(), static_cast<int>(courses[c].size()) - 1);
+                }
+            }
+        }
+    }
+
+    for (int claim_size : {1, 3, 64})
+    {
+        TuningProfile profile;
+        profile.claim_size = claim_size;
+        BatchSolver solver(3);
+        solver.setTuning(profile);
+        EXPECT_EQ(solver.solve(courses), expected) << "claim size " << claim_size;
+    }
+}
+
+TEST(TuningProfileTest, CrossoverRespectsTheMemoryBudget)
+{
+    vector<Waypoint> course = CourseGenerator(73).generate(CourseProfile::Uniform, 100);
+    TuningProfile profile;
+    profile.forward_min_waypoints = 50;
+    Optimizer optimizer;
+    optimizer.setTuning(profile);
+    Optimizer search;
+    search.setTuning(TuningProfile());
+    const double expected = search.findLowestTime(course);
+
+    // A budget that allows the search allows the forward DP too; a smaller one still wins.
+    optimizer.setMemoryBudget(Optimizer::planMemory(100, 0).bytes[static_cast<int>(MemoryStrategy::Full)]);
+    EXPECT_NEAR(optimizer.findLowestTime(course), expected, 1e-9);
+    EXPECT_FALSE(optimizer.optimalPath().empty());
+    EXPECT_EQ(optimizer.memoryPlan().strategy, MemoryStrategy::Compact);
+    EXPECT_TRUE(optimizer.memoryPlan().faster);
+    EXPECT_EQ(optimizer.memoryPlan().describe().rfind("compact: faster than full", 0), 0u) << optimizer.memoryPlan().describe();
+    optimizer.setMemoryBudget(Optimizer::planMemory(100, 0).bytes[static_cast<int>(MemoryStrategy::ScoreOnly)]);
+    EXPECT_NEAR(optimizer.findLowestTime(course), expected, 1e-9);
+    EXPECT_TRUE(optimizer.optimalPath().empty());
+    EXPECT_EQ(optimizer.memoryPlan().strategy, MemoryStrategy::ScoreOnly);
+    EXPECT_FALSE(optimizer.memoryPlan().faster);
+}
+
+// The startup profile is loaded once per process, so each case runs in a fresh one.
+static int startupCase(const char *profile_path)
+{
+    setenv(kTuningProfileEnvironment, profile_path, 1);
+    unsetenv("SHEARWATER_CPU_LEVEL");
+    const StartupTuning &tuning = startupTuning();
+    Optimizer optimizer;
+    BatchSolver solver;
+    if (tuning.source.empty())
+    {
+        // A named profile that cannot be used: the defaults, and why.
+        return !tuning.error.empty() && optimizer.tuningParameters().leg_chunk == TuningProfile().leg_chunk ? 0 : 1;
+    }
+    return tuning.error.empty() && tuning.source == profile_path && tuning.profile.threads == 6 &&
+                   optimizer.tuningParameters().forward_min_waypoints == 200 && cpuKernels().level == CpuLevel::Baseline
+               ? 0
+               : 1;
+}
+
+TEST(TuningProfileTest, StartupLoadsTheProfileNamedByTheEnvironment)
+{
+    GTEST_FLAG_SET(death_test_style, "threadsafe");
+    const string path = ::testing::TempDir() + "tuning_profile_startup.profile";
+    string error;
+    ASSERT_TRUE(tunedProfile().save(path, error)) << error;
+    EXPECT_EXIT(exit(startupCase(path.c_str())), ::testing::ExitedWithCode(0), "");
+
+    ofstream(path) << "solver_version=0\n";
+    EXPECT_EXIT(exit(startupCase(path.c_str())), ::testing::ExitedWithCode(0), "");
+    remove(path.c_str());
+    EXPECT_EXIT(exit(startupCase(path.c_str())), ::testing::ExitedWithCode(0), "");
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+# Tests for the "shearwater" Python extension (bindings/py/shearwater_module.cpp). The module is
+# compiled into bin/py first, the way test_runner.py builds the C++ tests; run from the repository
+# root:
+#
+#   python3 -m pytest tests/py
+
+import array
+import importlib
+import os
+import subprocess
+import sys
+import sysconfig
+import threading
+
+import pytest
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+DATA = os.path.join(ROOT, "data", "shearwater_challenge")
+
+
+@pytest.fixture(scope="module")
+def shearwater():
+    output = os.path.join(ROOT, "bin", "py")
+    os.makedirs(output, exist_ok=True)
+    target = os.path.join(output, "shearwater" + sysconfig.get_config_var("EXT_SUFFIX"))
+    subprocess.run(
+        ["g++", "-O2", "-std=c++17", "-shared", "-fPIC", "-pthread",
+         "-I", os.path.join(ROOT, "include"), "-I", sysconfig.get_paths()["include"],
+         os.path.join(ROOT, "bindings", "py", "shearwater_module.cpp"), "-o", target],
+        check=True)
+    sys.path.insert(0, output)
+    try:
+        yield importlib.import_module("shearwater")
+    finally:
+        sys.path.remove(output)
+
+
+def read_batch(name):
+    """Waypoint rows and course offsets of a challenge input file, as int32 and int64 arrays."""
+    with open(os.path.join(DATA, name)) as f:
+        numbers = [int(token) for token in f.read().split()]
+    waypoints, offsets, i = array.array("i"), array.array("q", [0]), 0
+    while numbers[i] != 0:
+        count = numbers[i]
+        waypoints.extend(numbers[i + 1:i + 1 + 3 * count])
+        offsets.append(offsets[-1] + count)
+        i += 1 + 3 * count
+    return waypoints, offsets
+
+
+def expected_answers(name):
+    with open(os.path.join(DATA, name)) as f:
+        return [line.strip() for line in f if line.strip()]
+
+
+@pytest.mark.parametrize("size", ["small", "medium", "large"])
+def test_answers_match_the_sample_outputs(shearwater, size):
+    waypoints, offsets = read_batch(f"sample_input_{size}.txt")
+    answers = shearwater.solve_batch(waypoints, offsets, threads=2)
+    assert isinstance(answers, array.array) and answers.typecode == "d"
+    assert [f"{a:.3f}" for a in answers] == expected_answers(f"sample_output_{size}.txt")
+
+
+def test_any_buffer_works_and_out_is_filled_in_place(shearwater):
+    waypoints, offsets = read_batch("sample_input_small.txt")
+    read_only = memoryview(waypoints.tobytes()).cast("i")
+    offsets32 = array.array("i", offsets)
+    out = array.array("d", [0.0] * (len(offsets) - 1))
+    assert shearwater.solve_batch(read_only, offsets32, out=out) is out
+    assert [f"{a:.3f}" for a in out] == expected_answers("sample_output_small.txt")
+
+
+def test_paths_come_back_as_flat_arrays(shearwater):
+    waypoints, offsets = read_batch("sample_input_medium.txt")
+    answers, path, path_offsets = shearwater.solve_batch(waypoints, offsets, with_paths=True)
+    assert path.typecode == "i" and len(path_offsets) == len(answers) + 1
+    for k in range(len(answers)):
+        course_path = path[path_offsets[k]:path_offsets[k + 1]]
+        assert course_path[0] == 0
+        assert course_path[-1] == offsets[k + 1] - offsets[k] + 1
+        assert list(course_path) == sorted(set(course_path))
+
+
+def test_empty_batch_and_empty_course(shearwater):
+    assert len(shearwater.solve_batch(array.array("i"), array.array("q", [0]))) == 0
+    answers = shearwater.solve_batch(array.array("i"), array.array("q", [0, 0]))
+    assert f"{answers[0]:.3f}" == "80.711"  # straight from start to finish
+
+
+@pytest.mark.parametrize("waypoints, offsets, error", [
+    (array.array("d", [1.0, 2.0, 3.0]), array.array("q", [0, 1]), ValueError),
+    (array.array("i", [1, 2]), array.array("q", [0, 1]), ValueError),
+    (array.array("i", [1, 2, 3]), array.array("q", [0, 2]), ValueError),
+    (array.array("i", [1, 2, 3, 4, 5, 6]), array.array("q", [0, 2, 1, 2]), ValueError),
+    (array.array("i", [1, 2, 3]), array.array("d", [0, 1]), ValueError),
+    ([1, 2, 3], array.array("q", [0, 1]), TypeError),
+])
+def test_malformed_input_is_rejected(shearwater, waypoints, offsets, error):
+    with pytest.raises(error):
+        shearwater.solve_batch(waypoints, offsets)
+
+
+def test_other_threads_run_while_solving(shearwater):
+    waypoints, offsets = read_batch("sample_input_large.txt")
+    many_waypoints = waypoints * 20
+    many_offsets = array.array("q", [0])
+    for _ in range(20):
+        base = many_offsets[-1]
+        many_offsets.extend(base + o for o in offsets[1:])
+    started, ticks, results = threading.Event(), [], []
+
+    def solve():
+        started.set()
+        results.append(shearwater.solve_batch(many_waypoints, many_offsets))
+
+    worker = threading.Thread(target=solve)
+    worker.start()
+    started.wait()
+    while worker.is_alive():
+        ticks.append(1)
+    worker.join()
+    assert len(results[0]) == 60
+    assert len(ticks) > 1000
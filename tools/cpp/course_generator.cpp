@@ -0,0 +1,116 @@
+// Writes seeded synthetic courses in the challenge input format, and optionally the matching
+// expected output computed by the reference solver.
+//
+//   course_generator --profile zigzag --waypoints 1000 --courses 3 --seed 7 --input in.txt --output out.txt
+//
+// Without --input the courses go to stdout.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_generator.h"
+#include "shearwater/course_io.h"
+#include "shearwater/reference_solver.h"
+
+static void usage()
+{
+    std::cerr << "usage: course_generator [--profile NAME] [--waypoints N] [--courses C] [--seed S]"
+              << " [--input FILE] [--output FILE]\n"
+              << "profiles:";
+    for (CourseProfile profile : kAllCourseProfiles)
+    {
+        std::cerr << " " << profileName(profile);
+    }
+    std::cerr << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    CourseProfile profile = CourseProfile::Uniform;
+    int waypoints = 1000;
+    int courses = 3;
+    uint64_t seed = 1;
+    std::string input_path;
+    std::string output_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--profile")
+        {
+            if (!parseProfile(value, profile))
+            {
+                std::cerr << "unknown profile: " << value << std::endl;
+                usage();
+                return 1;
+            }
+        }
+        else if (arg == "--waypoints")
+        {
+            waypoints = std::atoi(value.c_str());
+        }
+        else if (arg == "--courses")
+        {
+            courses = std::atoi(value.c_str());
+        }
+        else if (arg == "--seed")
+        {
+            seed = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (arg == "--input")
+        {
+            input_path = value;
+        }
+        else if (arg == "--output")
+        {
+            output_path = value;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (waypoints < 1 || courses < 1)
+    {
+        std::cerr << "--waypoints and --courses must be positive" << std::endl;
+        return 1;
+    }
+
+    CourseGenerator generator(seed);
+    std::vector<std::vector<Waypoint>> generated;
+    for (int c = 0; c < courses; ++c)
+    {
+        generated.push_back(generator.generate(profile, waypoints));
+    }
+
+    if (input_path.empty())
+    {
+        writeCourses(std::cout, generated);
+    }
+    else
+    {
+        std::ofstream input(input_path);
+        writeCourses(input, generated);
+    }
+
+    if (!output_path.empty())
+    {
+        std::ofstream output(output_path);
+        for (const auto &course : generated)
+        {
+            output << formatAnswer(referenceLowestTime(course)) << "\n";
+        }
+    }
+    return 0;
+}
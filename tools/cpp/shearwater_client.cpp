@@ -0,0 +1,83 @@
+// Command line client for shearwater_daemon: reads challenge input on stdin, sends every course over
+// the binary framing in one pipelined burst and prints the answers, as shearwater_solve would.
+// --text sends the input verbatim in the text format instead.
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "shearwater/course_io.h"
+#include "shearwater/solver_client.h"
+
+static void usage()
+{
+    std::cerr << "usage: shearwater_client --socket PATH [--text] < input" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string socket_path;
+    bool text = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--text")
+        {
+            text = true;
+        }
+        else if (arg == "--socket" && i + 1 < argc)
+        {
+            socket_path = argv[++i];
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (socket_path.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    if (text)
+    {
+        std::string input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+        int fd = unixConnect(socket_path);
+        if (fd < 0 || !sendAll(fd, input.data(), input.size()))
+        {
+            std::cerr << socket_path << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        ::shutdown(fd, SHUT_WR);
+        char buffer[4096];
+        ssize_t got;
+        while ((got = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            std::cout.write(buffer, got);
+        }
+        ::close(fd);
+        return 0;
+    }
+
+    std::vector<std::vector<Waypoint>> courses = readCourses(std::cin);
+    SolverClient client;
+    std::vector<double> answers;
+    if (!client.connect(socket_path) || !client.solveAll(courses, answers))
+    {
+        std::cerr << client.error() << std::endl;
+        return 1;
+    }
+    for (double answer : answers)
+    {
+        std::cout << formatAnswer(answer) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+// Resident solver service on a Unix domain socket (include/shearwater/solver_server.h), as in
+//
+//   shearwater_daemon --socket /tmp/shearwater.sock --threads 4 &
+//   shearwater_client --socket /tmp/shearwater.sock < data/shearwater_challenge/sample_input_large.txt
+//
+// Clients send courses in the challenge text format or the binary framing of solver_protocol.h.
+// Concurrent requests are coalesced into batches of up to --max-batch, waiting at most
+// --batch-window-us for company. SIGINT or SIGTERM stops accepting, answers what was received and
+// prints the request and batch counts.
+//
+// Prometheus metrics (courses, waypoints, solve latency histogram, errors, and pruning with
+// -DSHEARWATER_STATS) are served on http://127.0.0.1:PORT/metrics with --metrics-port, and/or
+// rewritten every --metrics-interval-ms (default 10000) into a node_exporter textfile with
+// --metrics-file.
+//
+// --cache-mb M answers repeated courses from a per-worker result cache of M megabytes.
+//
+// --shadow ENGINE also solves a --shadow-rate fraction (default 0.01) of courses with a candidate
+// engine (reference, full, compact, reconstruct, score_only, or one of include/shearwater/solver_engine.h:
+// search, dense, windowed, simd_batch, approximate) on a background thread and compares answers and
+// latencies (include/shearwater/shadow_comparator.h). Mismatching courses are written to
+// --shadow-log FILE (default stderr); a summary is printed on stderr at exit.
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+#include "shearwater/metrics_exporter.h"
+#include "shearwater/shadow_comparator.h"
+#include "shearwater/solver_server.h"
+
+static void usage()
+{
+    std::cerr << "usage: shearwater_daemon --socket PATH [--threads T] [--max-batch B] [--batch-window-us U]"
+              << " [--cache-mb M] [--shadow ENGINE [--shadow-rate R] [--shadow-log FILE]]"
+              << " [--metrics-port P] [--metrics-file FILE [--metrics-interval-ms M]]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string socket_path;
+    SolverServerOptions options;
+    int metrics_port = -1;
+    std::string metrics_path;
+    long metrics_interval_ms = 10000;
+    std::string shadow_engine;
+    std::string shadow_log_path;
+    ShadowOptions shadow_options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--socket")
+        {
+            socket_path = value;
+        }
+        else if (arg == "--threads")
+        {
+            options.threads = std::atoi(value.c_str());
+        }
+        else if (arg == "--max-batch")
+        {
+            options.max_batch = std::strtoul(value.c_str(), nullptr, 10);
+        }
+        else if (arg == "--batch-window-us")
+        {
+            options.batch_window = std::chrono::microseconds(std::strtoul(value.c_str(), nullptr, 10));
+        }
+        else if (arg == "--cache-mb")
+        {
+            options.cache_bytes = std::strtoul(value.c_str(), nullptr, 10) << 20;
+        }
+        else if (arg == "--shadow")
+        {
+            shadow_engine = value;
+        }
+        else if (arg == "--shadow-rate")
+        {
+            shadow_options.sample_rate = std::atof(value.c_str());
+        }
+        else if (arg == "--shadow-log")
+        {
+            shadow_log_path = value;
+        }
+        else if (arg == "--metrics-port")
+        {
+            metrics_port = std::atoi(value.c_str());
+        }
+        else if (arg == "--metrics-file")
+        {
+            metrics_path = value;
+        }
+        else if (arg == "--metrics-interval-ms")
+        {
+            metrics_interval_ms = std::atol(value.c_str());
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (socket_path.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    // Block the stop signals in every thread; a dedicated thread waits for them and stops the server.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SolverMetrics metrics;
+    options.metrics = &metrics;
+    MetricsHttpServer metrics_http(metrics);
+    if (metrics_port >= 0)
+    {
+        if (!metrics_http.start(metrics_port))
+        {
+            std::cerr << metrics_http.error() << std::endl;
+            return 1;
+        }
+        std::cerr << "metrics on http://127.0.0.1:" << metrics_http.port() << "/metrics" << std::endl;
+    }
+    std::unique_ptr<MetricsTextfile> metrics_file;
+    if (!metrics_path.empty())
+    {
+        metrics_file = std::make_unique<MetricsTextfile>(metrics, metrics_path, std::chrono::milliseconds(metrics_interval_ms));
+    }
+
+    std::ofstream shadow_log_file;
+    std::unique_ptr<ShadowComparator> shadow;
+    if (!shadow_engine.empty())
+    {
+        ShadowEngine engine;
+        if (!shadowEngineByName(shadow_engine, engine))
+        {
+            std::cerr << "unknown --shadow engine " << shadow_engine << std::endl;
+            return 1;
+        }
+        if (!shadow_log_path.empty())
+        {
+            shadow_log_file.open(shadow_log_path, std::ios::app);
+        }
+        shadow = std::make_unique<ShadowComparator>(engine, shadow_options, shadow_log_path.empty() ? &std::cerr : &shadow_log_file);
+    }
+    options.shadow = shadow.get();
+
+    SolverServer server(options);
+    if (!server.listen(socket_path))
+    {
+        std::cerr << "cannot listen on " << server.error() << std::endl;
+        return 1;
+    }
+    std::thread waiter([&]
+                       {
+        int signal;
+        sigwait(&signals, &signal);
+        server.stop(); });
+    waiter.detach();
+
+    std::cerr << "listening on " << socket_path << std::endl;
+    server.run();
+
+    SolverServerCounters counters = server.counters();
+    std::cerr << "connections=" << counters.connections << " requests=" << counters.requests << " batches=" << counters.batches
+              << " largest_batch=" << counters.largest_batch << std::endl;
+    if (shadow)
+    {
+        shadow->drain();
+        shadow->report(std::cerr);
+    }
+    return 0;
+}
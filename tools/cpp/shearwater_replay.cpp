@@ -0,0 +1,222 @@
+// Replays a capture log written by shearwater_solve --capture, as in
+//
+//   shearwater_replay capture.log --speed 10 --threads 4
+//
+// Courses are released at their recorded arrival times, compressed by --speed (1 = original pace,
+// 10 = ten times faster, 0 = all at once), and solved in process on --threads workers. The report
+// gives throughput and per-course latency from scheduled arrival to answer, which includes queueing
+// whenever the solver falls behind the arrival rate, plus the solve time alone.
+//
+// --emit writes the paced courses to stdout in the challenge input format instead, so any pipeline
+// reading that format can be driven with the recorded traffic:
+//
+//   shearwater_replay capture.log --emit | shearwater_solve --latency
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shearwater/capture_log.h"
+#include "shearwater/course_io.h"
+#include "shearwater/latency_histogram.h"
+#include "shearwater/optimizer.h"
+
+static void usage()
+{
+    std::cerr << "usage: shearwater_replay LOG [--speed S] [--threads T] [--emit]" << std::endl;
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Arrival
+{
+    size_t course;
+    Clock::time_point scheduled;
+};
+
+int main(int argc, char **argv)
+{
+    std::string log_path;
+    double speed = 1.0;
+    int threads = 1;
+    bool emit = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--emit")
+        {
+            emit = true;
+        }
+        else if (arg == "--speed" && i + 1 < argc)
+        {
+            speed = std::atof(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (log_path.empty() && arg[0] != '-')
+        {
+            log_path = arg;
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (log_path.empty() || speed < 0.0 || threads < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    std::ifstream log(log_path, std::ios::binary);
+    CaptureReader reader(log);
+    if (!reader.valid())
+    {
+        std::cerr << log_path << " is not a shearwater capture log" << std::endl;
+        return 1;
+    }
+    std::vector<CapturedCourse> captured;
+    CapturedCourse course;
+    while (reader.next(course))
+    {
+        captured.push_back(std::move(course));
+    }
+    if (!log.eof())
+    {
+        std::cerr << "warning: capture log truncated after " << captured.size() << " courses" << std::endl;
+    }
+    if (captured.empty())
+    {
+        return 0;
+    }
+
+    // Release offsets relative to the first arrival. Logs appended across runs may step backwards in
+    // wall-clock time; such courses are released immediately.
+    const uint64_t first_ns = captured[0].arrival_ns;
+    auto offsetOf = [&](const CapturedCourse &c)
+    {
+        if (speed == 0.0 || c.arrival_ns < first_ns)
+        {
+            return std::chrono::nanoseconds(0);
+        }
+        return std::chrono::nanoseconds(static_cast<int64_t>((c.arrival_ns - first_ns) / speed));
+    };
+
+    if (emit)
+    {
+        std::ios::sync_with_stdio(false);
+        const Clock::time_point start = Clock::now();
+        for (const auto &c : captured)
+        {
+            std::this_thread::sleep_until(start + offsetOf(c));
+            std::cout << c.waypoints.size() - 2 << "\n";
+            for (size_t i = 1; i + 1 < c.waypoints.size(); ++i)
+            {
+                std::cout << c.waypoints[i].x << " " << c.waypoints[i].y << " " << c.waypoints[i].penalty << "\n";
+            }
+            std::cout.flush();
+        }
+        std::cout << "0\n";
+        std::cout.flush();
+        return 0;
+    }
+
+    // The main thread paces arrivals into a queue; workers solve in arrival order.
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Arrival> queue;
+    bool done = false;
+
+    std::vector<LatencyHistogram> sojourn(threads);
+    std::vector<LatencyRecorder> recorders(threads);
+    std::vector<double> answers(captured.size());
+
+    auto work = [&](int worker)
+    {
+        Optimizer optimizer;
+        for (;;)
+        {
+            Arrival arrival;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [&]
+                           { return done || !queue.empty(); });
+                if (queue.empty())
+                {
+                    return;
+                }
+                arrival = queue.front();
+                queue.pop_front();
+            }
+            const auto &waypoints = captured[arrival.course].waypoints;
+            Clock::time_point start = Clock::now();
+            answers[arrival.course] = optimizer.findLowestTime(waypoints);
+            Clock::time_point end = Clock::now();
+            recorders[worker].record(SolvePhase::Solve, arrival.course, waypoints.size() - 2,
+                                     std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            sojourn[worker].record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - arrival.scheduled).count());
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < threads; ++w)
+    {
+        workers.emplace_back(work, w);
+    }
+    const Clock::time_point start = Clock::now();
+    for (size_t c = 0; c < captured.size(); ++c)
+    {
+        Clock::time_point scheduled = start + offsetOf(captured[c]);
+        std::this_thread::sleep_until(scheduled);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({c, scheduled});
+        }
+        ready.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    ready.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LatencyHistogram latency;
+    LatencyRecorder solve;
+    for (int w = 0; w < threads; ++w)
+    {
+        latency.merge(sojourn[w]);
+        solve.merge(recorders[w]);
+    }
+    size_t waypoints = 0;
+    for (const auto &c : captured)
+    {
+        waypoints += c.waypoints.size() - 2;
+    }
+
+    std::printf("replayed %zu courses (%zu waypoints) in %.3f s at speed %g on %d threads\n", captured.size(), waypoints,
+                seconds, speed, threads);
+    std::printf("throughput %.1f courses/s, %.0f waypoints/s\n", captured.size() / seconds, waypoints / seconds);
+    std::printf("latency (arrival to answer) p50 %.1f us  p90 %.1f us  p99 %.1f us  max %.1f us\n",
+                latency.percentile(50) / 1000.0, latency.percentile(90) / 1000.0, latency.percentile(99) / 1000.0,
+                latency.max() / 1000.0);
+    std::cout.flush();
+    solve.report(std::cout);
+    return 0;
+}
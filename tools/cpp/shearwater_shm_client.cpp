@@ -0,0 +1,33 @@
+// Command line client for shearwater_shm_server: reads challenge input on stdin, pipelines every
+// course through one shared-memory channel and prints the answers, as shearwater_solve would.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "shearwater/course_io.h"
+#include "shearwater/shm_channel.h"
+
+int main(int argc, char **argv)
+{
+    if (argc != 3 || std::string(argv[1]) != "--name")
+    {
+        std::cerr << "usage: shearwater_shm_client --name NAME < input" << std::endl;
+        return 1;
+    }
+
+    std::ios::sync_with_stdio(false);
+    std::vector<std::vector<Waypoint>> courses = readCourses(std::cin);
+    ShmChannel channel;
+    std::vector<double> answers;
+    if (!channel.open(argv[2]) || !channel.solveAll(courses, answers))
+    {
+        std::cerr << channel.error() << std::endl;
+        return 1;
+    }
+    for (double answer : answers)
+    {
+        std::cout << formatAnswer(answer) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Solver behind shared-memory channels (include/shearwater/shm_channel.h), for clients on the same
+// host, as in
+//
+//   shearwater_shm_server --name /shearwater --channels 2 &
+//   shearwater_shm_client --name /shearwater.1 < data/shearwater_challenge/sample_input_large.txt
+//
+// Each channel has one client and its own solver thread. With a single channel the segment is
+// called NAME; with several they are NAME.0, NAME.1, ... SIGINT or SIGTERM stops the server and
+// removes the segments.
+
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+#include "shearwater/optimizer.h"
+#include "shearwater/shm_channel.h"
+
+static void usage()
+{
+    std::cerr << "usage: shearwater_shm_server --name NAME [--channels K] [--ring-bytes B]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string name;
+    int channel_count = 1;
+    size_t ring_bytes = 1 << 20;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--name")
+        {
+            name = value;
+        }
+        else if (arg == "--channels")
+        {
+            channel_count = std::atoi(value.c_str());
+        }
+        else if (arg == "--ring-bytes")
+        {
+            ring_bytes = std::strtoul(value.c_str(), nullptr, 10);
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (name.empty() || channel_count < 1)
+    {
+        usage();
+        return 1;
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::vector<std::unique_ptr<ShmChannel>> channels;
+    for (int c = 0; c < channel_count; ++c)
+    {
+        std::string channel_name = channel_count == 1 ? name : name + "." + std::to_string(c);
+        channels.push_back(std::make_unique<ShmChannel>());
+        if (!channels.back()->create(channel_name, ring_bytes))
+        {
+            std::cerr << "cannot create " << channels.back()->error() << std::endl;
+            return 1;
+        }
+        std::cerr << "serving " << channel_name << std::endl;
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> solvers;
+    for (auto &channel : channels)
+    {
+        solvers.emplace_back([&stop, &channel]
+                             {
+            Optimizer optimizer;
+            channel->serve(optimizer, stop); });
+    }
+
+    int signal;
+    sigwait(&signals, &signal);
+    stop = true;
+    for (auto &solver : solvers)
+    {
+        solver.join();
+    }
+    return 0;
+}
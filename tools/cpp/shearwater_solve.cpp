@@ -0,0 +1,552 @@
+// Solver entry point: reads courses in the challenge input format from stdin and prints one
+// answer per line, as in
+//
+//   cat sample_input_small.txt | shearwater_solve | tee sample_output_small.txt
+//
+// --stats json|csv additionally writes per-course solver counters to --stats-file (default
+// stderr). Counters need a build with -DSHEARWATER_STATS.
+//
+// --perf reports hardware counters (cycles, instructions, cache and branch misses) per phase:
+// parse, preprocess, solve and format. Counters the host does not expose are left out.
+//
+// --trace FILE writes a Chrome trace of the run; needs a build with -DSHEARWATER_TRACE_LEVEL=1
+// (phase spans) or 2 (search detail).
+//
+// --threads T solves the batch on T worker threads. --latency reports per-course parse, solve and
+// format latency percentiles, solve latency by course size and the slowest courses.
+//
+// --capture FILE appends every incoming course, stamped with its arrival time, to a binary capture
+// log (include/shearwater/capture_log.h) for shearwater_replay.
+//
+// --metrics-file FILE writes Prometheus metrics for the run (courses, waypoints, solve latency
+// histogram, errors) in the node_exporter textfile format on exit.
+//
+// --realtime MAX solves on one thread in real-time mode (include/shearwater/realtime.h): workspace
+// prefaulted for MAX waypoints, memory locked, and with --cpu C the thread pinned. Courses larger
+// than MAX are an error.
+//
+// --cache-mb M answers repeated courses from a result cache of M megabytes per worker
+// (include/shearwater/result_cache.h) and reports hits and misses on stderr.
+//
+// --disk-cache FILE also consults and fills a persistent memory-mapped result cache
+// (include/shearwater/disk_cache.h), so repeated runs only solve new or changed courses. While
+// another process writes the file it is used read-only.
+//
+// --journal FILE records each finished course in a progress journal (include/shearwater/batch_journal.h),
+// synced every --journal-sync-ms (default 1000). Rerun with the same input and journal after an
+// interruption to skip the courses already solved; the output is identical to an uninterrupted run.
+//
+// --memory-budget-mb M caps each worker's solver workspace at M megabytes: courses whose worst case
+// does not fit are solved with a leaner strategy (include/shearwater/memory_plan.h), reported on
+// stderr with the reason. A course no strategy fits is an error.
+//
+// --shadow ENGINE also solves a --shadow-rate fraction (default 0.01) of courses with a candidate
+// engine (reference, full, compact, reconstruct, score_only, or one of include/shearwater/solver_engine.h:
+// search, dense, windowed, simd_batch, approximate) on a background thread and compares answers and
+// latencies (include/shearwater/shadow_comparator.h). Mismatching courses are written to
+// --shadow-log FILE (default stderr); a summary is printed on stderr at exit.
+//
+// --isa baseline|avx2|avx512 runs the parse, solve and format kernels at that instruction set level
+// instead of the best one the CPU supports (include/shearwater/cpu_dispatch.h); so does the
+// SHEARWATER_CPU_LEVEL environment variable.
+//
+// The machine's tuning profile (include/shearwater/tuning_profile.h), written by shearwater_tune,
+// is read from SHEARWATER_TUNING_PROFILE or /etc/shearwater/tuning.profile. It sets the kernel
+// level, the worker count when --threads is not given, and the engine parameters; --isa and
+// --threads override it.
+//
+// --speed S, --stop T and --field F solve under another cost model (include/shearwater/cost_model.h):
+// S m/s, T seconds per stop and the finish at (F,F), by default the challenge's 2, 10 and 100. Any
+// other model is solved on one thread by the runtime-parameterized optimizer, with none of the
+// caches, --journal, --memory-budget-mb, --shadow, --realtime, --capture, --stats or --perf.
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shearwater/batch_journal.h"
+#include "shearwater/batch_solver.h"
+#include "shearwater/capture_log.h"
+#include "shearwater/course_io.h"
+#include "shearwater/cpu_dispatch.h"
+#include "shearwater/disk_cache.h"
+#include "shearwater/latency_histogram.h"
+#include "shearwater/metrics_exporter.h"
+#include "shearwater/perf_counters.h"
+#include "shearwater/realtime.h"
+#include "shearwater/shadow_comparator.h"
+#include "shearwater/solver_stats.h"
+#include "shearwater/trace.h"
+#include "shearwater/tuning_profile.h"
+
+static void usage()
+{
+    std::cerr << "usage: shearwater_solve [--stats json|csv] [--stats-file FILE] [--perf] [--trace FILE]"
+              << " [--threads T] [--latency] [--capture FILE]"
+              << " [--metrics-file FILE] [--cache-mb M] [--disk-cache FILE]"
+              << " [--journal FILE [--journal-sync-ms M]] [--memory-budget-mb M]"
+              << " [--shadow ENGINE [--shadow-rate R] [--shadow-log FILE]] [--isa LEVEL]"
+              << " [--realtime MAX [--cpu C]] [--speed S] [--stop T] [--field F] < input" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    // Before --isa, which must win over the profile's cpu_level.
+    const StartupTuning &tuning = startupTuning();
+    if (!tuning.error.empty())
+    {
+        std::cerr << "tuning profile: " << tuning.error << std::endl;
+    }
+
+    std::string stats_format;
+    std::string stats_path;
+    bool perf = false;
+    std::string trace_path;
+    int threads = 0; // not given: the tuning profile's
+    bool latency = false;
+    std::string capture_path;
+    std::string metrics_path;
+    int realtime_max = 0;
+    int cpu = -1;
+    size_t cache_bytes = 0;
+    std::string disk_cache_path;
+    std::string journal_path;
+    long journal_sync_ms = 1000;
+    size_t memory_budget = 0;
+    std::string shadow_engine;
+    std::string shadow_log_path;
+    ShadowOptions shadow_options;
+    RuntimeCostModel model;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--perf")
+        {
+            perf = true;
+            continue;
+        }
+        if (arg == "--latency")
+        {
+            latency = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--stats" && (value == "json" || value == "csv"))
+        {
+            stats_format = value;
+        }
+        else if (arg == "--stats-file")
+        {
+            stats_path = value;
+        }
+        else if (arg == "--trace")
+        {
+            trace_path = value;
+        }
+        else if (arg == "--capture")
+        {
+            capture_path = value;
+        }
+        else if (arg == "--metrics-file")
+        {
+            metrics_path = value;
+        }
+        else if (arg == "--realtime")
+        {
+            realtime_max = std::atoi(value.c_str());
+        }
+        else if (arg == "--cpu")
+        {
+            cpu = std::atoi(value.c_str());
+        }
+        else if (arg == "--cache-mb")
+        {
+            cache_bytes = std::strtoul(value.c_str(), nullptr, 10) << 20;
+        }
+        else if (arg == "--disk-cache")
+        {
+            disk_cache_path = value;
+        }
+        else if (arg == "--journal")
+        {
+            journal_path = value;
+        }
+        else if (arg == "--journal-sync-ms")
+        {
+            journal_sync_ms = std::atol(value.c_str());
+        }
+        else if (arg == "--memory-budget-mb")
+        {
+            memory_budget = static_cast<size_t>(std::atof(value.c_str()) * (1 << 20));
+        }
+        else if (arg == "--shadow")
+        {
+            shadow_engine = value;
+        }
+        else if (arg == "--shadow-rate")
+        {
+            shadow_options.sample_rate = std::atof(value.c_str());
+        }
+        else if (arg == "--shadow-log")
+        {
+            shadow_log_path = value;
+        }
+        else if (arg == "--speed")
+        {
+            model.speed_mps = std::atof(value.c_str());
+        }
+        else if (arg == "--stop")
+        {
+            model.stop_seconds = std::atof(value.c_str());
+        }
+        else if (arg == "--field")
+        {
+            model.field_size = std::atoi(value.c_str());
+        }
+        else if (arg == "--threads")
+        {
+            threads = std::atoi(value.c_str());
+        }
+        else if (arg == "--isa")
+        {
+            CpuLevel level;
+            if (!parseCpuLevel(value, level) || !selectCpuLevel(level))
+            {
+                std::cerr << "--isa " << value << " is not a level this CPU supports (up to " << cpuLevelName(detectCpuLevel())
+                          << ")" << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    const bool custom_model = !model.isStandard();
+    if (threads == 0)
+    {
+        threads = perf || realtime_max > 0 || custom_model ? 1 : tuning.profile.threads;
+    }
+    if (!stats_format.empty() && !kSolverStatsEnabled)
+    {
+        std::cerr << "--stats needs a build with -DSHEARWATER_STATS" << std::endl;
+        return 1;
+    }
+    if (!trace_path.empty() && kTraceLevel == 0)
+    {
+        std::cerr << "--trace needs a build with -DSHEARWATER_TRACE_LEVEL=1 or 2" << std::endl;
+        return 1;
+    }
+    if (perf && threads > 1)
+    {
+        std::cerr << "--perf counts the calling thread only; use --threads 1" << std::endl;
+        return 1;
+    }
+    if (realtime_max > 0 && (threads > 1 || !stats_format.empty() || perf || cache_bytes > 0 || !disk_cache_path.empty() ||
+                              !journal_path.empty() || memory_budget > 0 || !shadow_engine.empty()))
+    {
+        std::cerr << "--realtime solves on one thread with none of --stats, --perf, caches, --journal, --memory-budget-mb"
+                  << " or --shadow" << std::endl;
+        return 1;
+    }
+    if (!model.valid())
+    {
+        std::cerr << "--speed must be positive and --stop non-negative" << std::endl;
+        return 1;
+    }
+    if (custom_model && (threads > 1 || !stats_format.empty() || perf || cache_bytes > 0 || !disk_cache_path.empty() ||
+                         !journal_path.empty() || memory_budget > 0 || !shadow_engine.empty() || realtime_max > 0 ||
+                         !capture_path.empty()))
+    {
+        std::cerr << "--speed, --stop and --field solve on one thread with none of --stats, --perf, caches, --journal,"
+                  << " --memory-budget-mb, --shadow, --realtime or --capture" << std::endl;
+        return 1;
+    }
+
+    std::ofstream stats_file;
+    if (!stats_path.empty())
+    {
+        stats_file.open(stats_path);
+    }
+    std::ostream &stats_output = stats_path.empty() ? std::cerr : stats_file;
+    if (stats_format == "csv")
+    {
+        writeStatsCsvHeader(stats_output);
+    }
+
+    std::unique_ptr<PhaseCounters> phases;
+    if (perf)
+    {
+        phases = std::make_unique<PhaseCounters>();
+        phases->enter(SolvePhase::Parse);
+    }
+
+    std::ofstream capture_file;
+    std::unique_ptr<CaptureWriter> capture;
+    if (!capture_path.empty())
+    {
+        std::error_code error;
+        bool fresh = !std::filesystem::exists(capture_path, error) || std::filesystem::file_size(capture_path, error) == 0;
+        capture_file.open(capture_path, std::ios::binary | std::ios::app);
+        if (!capture_file)
+        {
+            std::cerr << "cannot open capture log " << capture_path << std::endl;
+            return 1;
+        }
+        capture = std::make_unique<CaptureWriter>(capture_file);
+        if (fresh)
+        {
+            capture->writeHeader();
+        }
+    }
+
+    LatencyRecorder latencies;
+    auto now = []
+    { return std::chrono::steady_clock::now(); };
+    auto elapsedNs = [](std::chrono::steady_clock::time_point start)
+    { return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()); };
+
+    std::ios::sync_with_stdio(false);
+    std::vector<std::vector<Waypoint>> courses;
+    {
+        SHEARWATER_TRACE_SPAN("parse", 0);
+        auto start = now();
+        std::vector<Waypoint> course;
+        auto accept = [&]
+        {
+            if (latency)
+            {
+                latencies.record(SolvePhase::Parse, courses.size(), course.size() - 2, elapsedNs(start));
+            }
+            // Flushed per course so the log survives a crash mid-batch.
+            if (capture && !(capture->append(captureClockNs(), course) && capture_file.flush()))
+            {
+                std::cerr << "capture log write failed; capture disabled" << std::endl;
+                capture.reset();
+            }
+            courses.push_back(std::move(course));
+            start = now();
+        };
+        if (capture)
+        {
+            // Stamped on arrival: read course by course rather than the whole input first.
+            while (readCourse(std::cin, course, model))
+            {
+                accept();
+            }
+        }
+        else
+        {
+            const std::string input{std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>()};
+            CourseParser parser(input.data(), input.size(), model);
+            while (parser.next(course))
+            {
+                accept();
+            }
+        }
+    }
+
+    DiskResultCache disk_cache;
+    if (!disk_cache_path.empty())
+    {
+        if (!disk_cache.open(disk_cache_path))
+        {
+            std::cerr << disk_cache.error() << "; disk cache disabled" << std::endl;
+        }
+        else if (!disk_cache.writable())
+        {
+            std::cerr << disk_cache_path << " is being written by another process; using it read-only" << std::endl;
+        }
+    }
+
+    BatchJournal journal;
+    if (!journal_path.empty())
+    {
+        if (!journal.open(journal_path, courses, std::chrono::milliseconds(journal_sync_ms)))
+        {
+            std::cerr << journal.error() << std::endl;
+            return 1;
+        }
+        if (journal.finishedCount() > 0)
+        {
+            std::cerr << "resuming: " << journal.finishedCount() << " of " << courses.size() << " courses already solved" << std::endl;
+        }
+    }
+
+    std::ofstream shadow_log_file;
+    std::unique_ptr<ShadowComparator> shadow;
+    if (!shadow_engine.empty())
+    {
+        ShadowEngine engine;
+        if (!shadowEngineByName(shadow_engine, engine))
+        {
+            std::cerr << "unknown --shadow engine " << shadow_engine << std::endl;
+            return 1;
+        }
+        if (!shadow_log_path.empty())
+        {
+            shadow_log_file.open(shadow_log_path, std::ios::app);
+        }
+        shadow = std::make_unique<ShadowComparator>(engine, shadow_options, shadow_log_path.empty() ? &std::cerr : &shadow_log_file);
+    }
+
+    SolverMetrics metrics;
+    BatchSolver solver(threads);
+    solver.setMetrics(&metrics);
+    solver.setDiskCache(disk_cache_path.empty() ? nullptr : &disk_cache);
+    std::vector<double> answers;
+    if (custom_model)
+    {
+        BasicOptimizer<RuntimeCostModel> optimizer(model);
+        answers.resize(courses.size());
+        for (size_t c = 0; c < courses.size(); ++c)
+        {
+            auto start = now();
+            answers[c] = optimizer.findLowestTime(courses[c]);
+            uint64_t ns = elapsedNs(start);
+            metrics.recordSolve(courses[c].size() - 2, ns, optimizer.stats());
+            if (latency)
+            {
+                latencies.record(SolvePhase::Solve, c, courses[c].size() - 2, ns);
+            }
+        }
+    }
+    else if (realtime_max > 0)
+    {
+        RealtimeOptions options;
+        options.max_waypoints = realtime_max;
+        options.cpu = cpu;
+        RealtimeSolver realtime;
+        std::cerr << realtime.prepare(options).problems;
+        answers.resize(courses.size());
+        for (size_t c = 0; c < courses.size(); ++c)
+        {
+            auto start = now();
+            if (!realtime.solve(courses[c], answers[c]))
+            {
+                metrics.recordError(SolveError::Oversized);
+                if (!metrics_path.empty())
+                {
+                    writeMetricsTextfile(metrics, metrics_path);
+                }
+                std::cerr << "course " << c << " has " << courses[c].size() - 2 << " waypoints, over --realtime " << realtime_max << std::endl;
+                return 1;
+            }
+            uint64_t ns = elapsedNs(start);
+            metrics.recordSolve(courses[c].size() - 2, ns, realtime.solver().stats());
+            if (latency)
+            {
+                latencies.record(SolvePhase::Solve, c, courses[c].size() - 2, ns);
+            }
+        }
+    }
+    else
+    {
+        solver.setPhaseCounters(phases.get());
+        solver.setLatencyRecorder(latency ? &latencies : nullptr);
+        solver.enableCache(cache_bytes);
+        solver.setJournal(journal_path.empty() ? nullptr : &journal);
+        solver.setMemoryBudget(memory_budget);
+        solver.setShadow(shadow.get());
+        answers = solver.solve(courses);
+        bool refused = false;
+        for (size_t c = 0; c < solver.memoryPlans().size(); ++c)
+        {
+            const MemoryPlan &plan = solver.memoryPlans()[c];
+            if ((plan.strategy != MemoryStrategy::Full && !plan.faster) || !plan.fits)
+            {
+                std::cerr << "course " << c << " (" << courses[c].size() - 2 << " waypoints): " << plan.describe() << std::endl;
+            }
+            refused |= !plan.fits;
+        }
+        if (refused)
+        {
+            return 1;
+        }
+        if (cache_bytes > 0)
+        {
+            ResultCacheStats cache = solver.cacheStats();
+            std::cerr << "cache hits=" << cache.hits << " misses=" << cache.misses << " collisions=" << cache.collisions
+                      << " evictions=" << cache.evictions << " entries=" << cache.entries << " bytes=" << cache.bytes << std::endl;
+        }
+        if (!disk_cache_path.empty())
+        {
+            DiskCacheStats disk = disk_cache.stats();
+            std::cerr << "disk cache hits=" << disk.hits << " misses=" << disk.misses << " inserts=" << disk.inserts
+                      << " entries=" << disk.entries << std::endl;
+        }
+    }
+    if (phases)
+    {
+        phases->enter(SolvePhase::Format);
+    }
+
+    // One batch through the formatter kernel unless per-course format latency is wanted.
+    std::string output;
+    if (!latency)
+    {
+        appendAnswers(answers.data(), answers.size(), output);
+    }
+    for (size_t c = 0; c < courses.size(); ++c)
+    {
+        SHEARWATER_TRACE_SPAN("format", c);
+        if (latency)
+        {
+            auto start = now();
+            appendAnswers(&answers[c], 1, output);
+            latencies.record(SolvePhase::Format, c, courses[c].size() - 2, elapsedNs(start));
+        }
+        if (stats_format == "json")
+        {
+            writeStatsJson(stats_output, c, courses[c].size() - 2, solver.stats()[c]);
+        }
+        else if (stats_format == "csv")
+        {
+            writeStatsCsvRow(stats_output, c, courses[c].size() - 2, solver.stats()[c]);
+        }
+    }
+    std::cout << output;
+    std::cout.flush();
+
+    if (phases)
+    {
+        phases->stop();
+        phases->report(std::cerr);
+    }
+    if (latency)
+    {
+        latencies.report(std::cerr);
+    }
+
+    if (shadow)
+    {
+        shadow->drain();
+        shadow->report(std::cerr);
+    }
+
+    if (!metrics_path.empty())
+    {
+        writeMetricsTextfile(metrics, metrics_path);
+    }
+
+    if (!trace_path.empty())
+    {
+        std::ofstream trace(trace_path);
+        TraceRecorder::instance().writeChromeTrace(trace);
+    }
+    return 0;
+}
@@ -0,0 +1,219 @@
+// Measures the engine parameters of include/shearwater/tuning_profile.h on this machine and writes
+// the profile that every solver process loads at startup, as in
+//
+//   shearwater_tune --output /etc/shearwater/tuning.profile
+//
+// Each parameter is tuned in turn on seeded synthetic courses, keeping the ones already chosen:
+// the course size from which the forward DP beats the heap search, the kernel instruction set
+// level, the leg chunk size, the worker thread count and the batch claim size. Every trial is the
+// best of --repeats runs of at least --trial-ms milliseconds (defaults 3 and 100); the whole run
+// takes 15 seconds on one core with the defaults. The trials are reported on stderr.
+//
+// --max-threads T caps the thread counts tried (default: the hardware concurrency). Without
+// --output the profile goes to stdout. Tune on an otherwise idle machine.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shearwater/batch_solver.h"
+#include "shearwater/course_generator.h"
+#include "shearwater/cpu_dispatch.h"
+#include "shearwater/tuning_profile.h"
+
+using Courses = std::vector<std::vector<Waypoint>>;
+
+static void usage()
+{
+    std::cerr << "usage: shearwater_tune [--output FILE] [--trial-ms MS] [--repeats R] [--max-threads T]" << std::endl;
+}
+
+static int trial_ms = 100;
+static int repeats = 3;
+
+// Courses of every generator profile, waypoints each, about total_waypoints in all.
+static Courses corpus(int waypoints, int total_waypoints, uint64_t seed)
+{
+    CourseGenerator generator(seed);
+    Courses courses;
+    const int count = std::max<int>(std::size(kAllCourseProfiles), total_waypoints / waypoints);
+    for (int c = 0; c < count; ++c)
+    {
+        courses.push_back(generator.generate(kAllCourseProfiles[c % std::size(kAllCourseProfiles)], waypoints));
+    }
+    return courses;
+}
+
+// Seconds per pass over courses: the best of the repeats, each as many passes as fill trial_ms.
+static double secondsPerPass(const Courses &courses, const TuningProfile &profile)
+{
+    BatchSolver solver(profile.threads);
+    solver.setTuning(profile);
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r)
+    {
+        int passes = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        do
+        {
+            solver.solve(courses);
+            ++passes;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed * 1000 < trial_ms);
+        best = std::min(best, elapsed / passes);
+    }
+    return best;
+}
+
+static std::ostream &operator<<(std::ostream &out, CpuLevel level)
+{
+    return out << cpuLevelName(level);
+}
+
+// Sets *field to the fastest candidate value; a later candidate must be 2% faster to win, so
+// candidates go from the preferred (cheaper, simpler) to the less preferred.
+template <typename T>
+static void pick(const char *name, T TuningProfile::*field, const std::vector<T> &candidates, const Courses &courses,
+                 TuningProfile &profile, void (*apply)(T) = nullptr)
+{
+    double best_seconds = 1e300;
+    T best = profile.*field;
+    for (T candidate : candidates)
+    {
+        TuningProfile trial = profile;
+        trial.*field = candidate;
+        if (apply)
+        {
+            apply(candidate);
+        }
+        const double seconds = secondsPerPass(courses, trial);
+        std::cerr << "  " << name << " " << candidate << ": " << seconds * 1000 << " ms" << std::endl;
+        if (seconds < best_seconds * 0.98)
+        {
+            best_seconds = seconds;
+            best = candidate;
+        }
+    }
+    profile.*field = best;
+    if (apply)
+    {
+        apply(best);
+    }
+    std::cerr << name << " = " << best << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string output_path;
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--output")
+        {
+            output_path = value;
+        }
+        else if (arg == "--trial-ms")
+        {
+            trial_ms = std::max(1, std::atoi(value.c_str()));
+        }
+        else if (arg == "--repeats")
+        {
+            repeats = std::max(1, std::atoi(value.c_str()));
+        }
+        else if (arg == "--max-threads")
+        {
+            max_threads = std::max(1, std::atoi(value.c_str()));
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    // Tune from the defaults, not from whatever profile this machine already has.
+    TuningProfile profile;
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+    profile.host = host;
+
+    const Courses mixed = corpus(300, 30000, 73);
+
+    // The crossover first, as it decides which engine the other trials time: the smallest measured
+    // size from which the forward DP wins at every larger measured size; 0 if it does not win at
+    // the largest.
+    const std::vector<int> sizes = {1, 5, 10, 25, 50, 100, 200, 400, 800, 1600};
+    std::vector<bool> forward_wins;
+    for (int n : sizes)
+    {
+        const Courses courses = corpus(n, 20000, 73 + n);
+        TuningProfile search = profile;
+        search.forward_min_waypoints = 0;
+        TuningProfile forward = profile;
+        forward.forward_min_waypoints = 1;
+        const double search_seconds = secondsPerPass(courses, search);
+        const double forward_seconds = secondsPerPass(courses, forward);
+        forward_wins.push_back(forward_seconds < search_seconds);
+        std::cerr << "  " << n << " waypoints: search " << search_seconds * 1000 << " ms, forward " << forward_seconds * 1000
+                  << " ms" << std::endl;
+    }
+    profile.forward_min_waypoints = 0;
+    for (int s = static_cast<int>(sizes.size()) - 1; s >= 0 && forward_wins[s]; --s)
+    {
+        profile.forward_min_waypoints = sizes[s];
+    }
+    std::cerr << "forward_min_waypoints = " << profile.forward_min_waypoints << std::endl;
+
+    std::vector<CpuLevel> levels;
+    for (int l = 0; l <= static_cast<int>(detectCpuLevel()); ++l)
+    {
+        levels.push_back(static_cast<CpuLevel>(l));
+    }
+    pick<CpuLevel>("cpu_level", &TuningProfile::cpu_level, levels, mixed, profile, [](CpuLevel level)
+                   { selectCpuLevel(level); });
+
+    pick<int>("leg_chunk", &TuningProfile::leg_chunk, {64, 32, 128, 16, 256}, mixed, profile);
+
+    std::vector<int> thread_counts;
+    for (int t = 1; t < max_threads; t *= 2)
+    {
+        thread_counts.push_back(t);
+    }
+    thread_counts.push_back(max_threads);
+    pick<int>("threads", &TuningProfile::threads, thread_counts, mixed, profile);
+
+    // Claims matter for many small courses on several threads.
+    if (profile.threads > 1)
+    {
+        pick<int>("claim_size", &TuningProfile::claim_size, {1, 2, 4, 8, 16, 32, 64}, corpus(10, 200000, 74), profile);
+    }
+
+    std::string error;
+    if (output_path.empty())
+    {
+        std::cout << profile.format();
+    }
+    else if (!profile.save(output_path, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    return 0;
+}